@@ -10,6 +10,11 @@
 #include <sstream>
 #include <thread>
 #include <random>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <cmath>
+#include <algorithm>
 
 #include "MM_UnitTestFramework/MM_UnitTestFramework.h"
 #include "CacheStatusManager_v1.h"
@@ -64,13 +69,13 @@ namespace mm {
 			int val_;
 		};
 
+		template<typename CacheType>
 		void testCacheStatusManager(bool generateRandomKey)
 		{
 			bool ready = false;
 			std::mutex mu;
 			std::condition_variable cv;
 
-			using CacheType = Cache<MyKey, std::shared_ptr<MyValue>, Hash<MyKey>>;
 			using CacheStatusMgrType = CacheStatusManager<CacheType, MyKey, std::shared_ptr<MyValue>, Hash<MyKey>>;
 			auto threadFunction = [&](CacheStatusMgrType& cacheStatusMgr, int numIterations, size_t timeoutMilliSec) {
 
@@ -172,6 +177,302 @@ namespace mm {
 			cacheMgr.clear();
 		}
 
+		//Benchmark version of testCacheStatusManager: no exceptions, time outs or infinite loops, just numThreads threads asking for
+		//random keys out of numKeys, and the thread with write access preparing the value for a few milliseconds while the others wait.
+		//Returns the stats: how many waiters were woken up per value set, against how many a single notify_all() for all the keys would have woken.
+		template<typename CacheType>
+		CacheStatusManagerStats testCacheStatusManagerWakeups(int numThreads, int numKeys, int numIterations)
+		{
+			using CacheStatusMgrType = CacheStatusManager<CacheType, MyKey, std::shared_ptr<MyValue>, Hash<MyKey>>;
+			const size_t timeoutMilliSec = 200;
+
+			CacheType cache;
+			CacheStatusMgrType cacheMgr{ cache };
+
+			std::vector<std::thread> threadPool;
+			threadPool.reserve(numThreads);
+			for (int i = 0; i < numThreads; ++i)
+			{
+				threadPool.push_back(std::thread{ [&, i]() {
+					std::mt19937 mt(i);
+					std::uniform_int_distribution<int> distKey(1, numKeys);
+					std::uniform_int_distribution<int> distPrepareMs(2, 10);
+					for (int iter = 0; iter < numIterations; ++iter)
+					{
+						MyKey key{ distKey(mt) };
+						const int prepareMs = distPrepareMs(mt);
+						cacheMgr.setAndGet(key, 3, true, timeoutMilliSec, [prepareMs](int val) {
+							std::this_thread::sleep_for(std::chrono::milliseconds{ prepareMs });
+							return std::make_shared<MyValue>(val);
+						}, key.val_);
+					}
+				} });
+			}
+
+			for (std::thread& t : threadPool)
+				t.join();
+
+			const CacheStatusManagerStats stats = cacheMgr.getStats();
+			cacheMgr.clear();
+			return stats;
+		}
+
+		void testCacheStatusManagerWakeups()
+		{
+			using CacheType = StripedCache<MyKey, std::shared_ptr<MyValue>, Hash<MyKey>>;
+			const int numThreads = 200;
+			const int numIterations = 20;
+			const std::vector<int> allNumKeys{ 10, 100, 1000 };
+
+			//Print the results after all the runs, the log lines of the runs would bury them
+			std::vector<CacheStatusManagerStats> allStats;
+			for (int numKeys : allNumKeys)
+				allStats.push_back(testCacheStatusManagerWakeups<CacheType>(numThreads, numKeys, numIterations));
+
+			std::cout << "\n\n----testCacheStatusManagerWakeups (each key has its own condition variable) ----\n";
+			for (size_t i = 0; i < allStats.size(); ++i)
+			{
+				const CacheStatusManagerStats& stats = allStats[i];
+				std::cout << std::fixed << std::setprecision(2)
+					<< "\n" << std::setw(10) << "keys: " << std::setw(6) << allNumKeys[i]
+					<< "   threads: " << std::setw(4) << numThreads
+					<< "   sets: " << std::setw(6) << stats.numSets
+					<< "   wakeups: " << std::setw(8) << stats.numWakeups
+					<< "   wakeups/set: " << std::setw(8) << (stats.numSets > 0 ? double(stats.numWakeups) / stats.numSets : 0.0)
+					<< "   all waiters/set (single notify_all): " << std::setw(8) << (stats.numSets > 0 ? double(stats.numWaitersAtSets) / stats.numSets : 0.0);
+			}
+			std::cout.unsetf(std::ios_base::floatfield);
+			std::cout << std::endl;
+		}
+
+		//numThreads threads look up skewed random keys out of numKeys (log-uniform, close to Zipf: key k is asked about 1/k as often as key 1),
+		//and set the key on a miss, as a cache in front of something slow would. Reports hit rate, evictions and their cost, and the size.
+		void testStripedCacheEviction(size_t capacity, int numKeys, int numThreads, int numIterations)
+		{
+			using CacheType = StripedCache<MyKey, std::shared_ptr<MyValue>, Hash<MyKey>>;
+			CacheType cache{ 16, capacity };
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			std::vector<std::thread> threadPool;
+			threadPool.reserve(numThreads);
+			for (int i = 0; i < numThreads; ++i)
+			{
+				threadPool.push_back(std::thread{ [&, i]() {
+					std::mt19937 mt(i);
+					std::uniform_real_distribution<double> dist(0.0, 1.0);
+					for (int iter = 0; iter < numIterations; ++iter)
+					{
+						const int key = static_cast<int>(std::pow(double(numKeys), dist(mt))) - 1;
+						if (!cache.get(MyKey{ key }))
+							cache.set(MyKey{ key }, std::make_shared<MyValue>(key));
+					}
+				} });
+			}
+			for (std::thread& t : threadPool)
+				t.join();
+			std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+			const StripedCacheStats stats = cache.getStats();
+			const size_t numOps = size_t(numThreads) * numIterations;
+			std::cout << std::fixed << std::setprecision(2)
+				<< "\n" << std::setw(12) << "capacity: " << std::setw(9)
+				<< (cache.getCapacity() == CacheType::unboundedCapacity ? std::string{ "unbounded" } : std::to_string(cache.getCapacity()))
+				<< "   keys: " << std::setw(8) << numKeys
+				<< "   hit rate: " << std::setw(6) << 100.0 * stats.numHits / (stats.numHits + stats.numMisses) << " %"
+				<< "   evictions: " << std::setw(8) << stats.numEvictions
+				<< "   steps/eviction: " << std::setw(5) << (stats.numEvictions > 0 ? double(stats.numEvictionSteps) / stats.numEvictions : 0.0)
+				<< "   ns/op: " << std::setw(6) << double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()) / numOps
+				<< "   size: " << std::setw(8) << stats.size;
+			std::cout.unsetf(std::ios_base::floatfield);
+		}
+
+		//The key space of CacheStatusManager is unbounded here: every iteration asks for a new key. Both the cache and the status entries stay bounded.
+		void testCacheStatusManagerBoundedMemory(size_t capacity, size_t maxStatusEntries, int numThreads, int numIterations)
+		{
+			using CacheType = StripedCache<MyKey, std::shared_ptr<MyValue>, Hash<MyKey>>;
+			using CacheStatusMgrType = CacheStatusManager<CacheType, MyKey, std::shared_ptr<MyValue>, Hash<MyKey>>;
+			CacheType cache{ 16, capacity };
+			CacheStatusMgrType cacheMgr{ cache, maxStatusEntries };
+
+			std::vector<std::thread> threadPool;
+			threadPool.reserve(numThreads);
+			for (int i = 0; i < numThreads; ++i)
+			{
+				threadPool.push_back(std::thread{ [&, i]() {
+					for (int iter = 0; iter < numIterations; ++iter)
+					{
+						MyKey key{ i * numIterations + iter };
+						cacheMgr.setAndGet(key, 3, true, 200, [](int val) { return std::make_shared<MyValue>(val); }, key.val_);
+					}
+				} });
+			}
+			for (std::thread& t : threadPool)
+				t.join();
+
+			const StripedCacheStats stats = cache.getStats();
+			std::cout << "\n\n----testCacheStatusManagerBoundedMemory----\n"
+				<< "\n" << std::setw(12) << "keys: " << std::setw(8) << numThreads * numIterations
+				<< "   cache capacity: " << std::setw(8) << cache.getCapacity()
+				<< "   cache size: " << std::setw(8) << stats.size
+				<< "   evictions: " << std::setw(8) << stats.numEvictions
+				<< "   max status entries: " << std::setw(8) << maxStatusEntries
+				<< "   status entries: " << std::setw(8) << cacheMgr.getNumStatusEntries();
+			cacheMgr.clear();
+		}
+
+		void testStripedCacheEviction()
+		{
+			testCacheStatusManagerBoundedMemory(1000, 1000, 20, 500);
+
+			std::cout << "\n\n----testStripedCacheEviction (CLOCK per shard, 16 shards, 8 threads) ----\n";
+			for (size_t capacity : { 100, 1000, 10000, 100000 })
+				testStripedCacheEviction(capacity, 1000000, 8, 200000);
+			testStripedCacheEviction(StripedCache<MyKey, std::shared_ptr<MyValue>, Hash<MyKey>>::unboundedCapacity, 1000000, 8, 200000);
+			std::cout << std::endl;
+		}
+
+		//numThreads threads keep asking for random keys out of numKeys (one call per millisecond each) for durationMs, preparing a value takes
+		//prepareMs. Reports the latency of setAndGet() and how often the values were prepared.
+		void testCacheStatusManagerTtl(const std::string& msg, CacheTtl ttl, int numThreads, int numKeys, int prepareMs, int durationMs)
+		{
+			using CacheType = StripedCache<MyKey, std::shared_ptr<MyValue>, Hash<MyKey>>;
+			using CacheStatusMgrType = CacheStatusManager<CacheType, MyKey, std::shared_ptr<MyValue>, Hash<MyKey>>;
+			CacheType cache;
+			std::vector<std::vector<int64_t>> latenciesNs(numThreads);
+			std::atomic<size_t> numPrepares{ 0 };
+			CacheStatusManagerStats stats;
+			{
+				CacheStatusMgrType cacheMgr{ cache, CacheStatusMgrType::defaultMaxStatusEntries, ttl };
+				std::atomic<bool> stop{ false };
+				std::vector<std::thread> threadPool;
+				threadPool.reserve(numThreads);
+				for (int i = 0; i < numThreads; ++i)
+				{
+					threadPool.push_back(std::thread{ [&, i]() {
+						std::mt19937 mt(i);
+						std::uniform_int_distribution<int> distKey(0, numKeys - 1);
+						auto prepareDataToCache = [&numPrepares, prepareMs](int val) {
+							++numPrepares;
+							std::this_thread::sleep_for(std::chrono::milliseconds{ prepareMs });
+							return std::make_shared<MyValue>(val);
+						};
+						while (!stop.load(std::memory_order_relaxed))
+						{
+							MyKey key{ distKey(mt) };
+							std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+							cacheMgr.setAndGet(key, 3, true, 1000, prepareDataToCache, key.val_);
+							std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+							latenciesNs[i].push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+							std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+						}
+					} });
+				}
+
+				std::this_thread::sleep_for(std::chrono::milliseconds(durationMs));
+				stop.store(true);
+				for (std::thread& t : threadPool)
+					t.join();
+				stats = cacheMgr.getStats();
+			}
+
+			std::vector<int64_t> all;
+			for (const std::vector<int64_t>& latencies : latenciesNs)
+				all.insert(all.end(), latencies.begin(), latencies.end());
+			std::sort(all.begin(), all.end());
+			auto getPercentileUs = [&all](double percentile) {
+				return all.empty() ? int64_t{ 0 } : all[std::min(all.size() - 1, static_cast<size_t>(percentile / 100.0 * all.size()))] / 1000;
+			};
+
+			std::cout << "\n" << std::setw(45) << msg
+				<< "   calls: " << std::setw(8) << all.size()
+				<< "   prepares: " << std::setw(6) << numPrepares.load()
+				<< "   refreshes: " << std::setw(6) << stats.numRefreshes
+				<< "   stale hits: " << std::setw(8) << stats.numStaleHits
+				<< "   latency p50: " << std::setw(6) << getPercentileUs(50.0)
+				<< " p99: " << std::setw(6) << getPercentileUs(99.0)
+				<< " p99.9: " << std::setw(6) << getPercentileUs(99.9)
+				<< " max: " << std::setw(6) << getPercentileUs(100.0) << " us";
+		}
+
+		void testCacheStatusManagerTtl()
+		{
+			const int numThreads = 200;
+			const int numKeys = 100;
+			const int prepareMs = 20;
+			const int durationMs = 3000;
+			const std::chrono::milliseconds softTtl{ 500 };
+			const std::chrono::milliseconds hardTtl{ 10000 };
+
+			getVerboseLog().store(false);
+			std::cout << "\n\n----testCacheStatusManagerTtl (" << numThreads << " threads, " << numKeys << " keys, preparing takes " << prepareMs << " ms) ----\n";
+			testCacheStatusManagerTtl("hard TTL only (like clear() every 500 ms)", CacheTtl{ softTtl, softTtl, false }, numThreads, numKeys, prepareMs, durationMs);
+			testCacheStatusManagerTtl("stale-while-revalidate", CacheTtl{ softTtl, hardTtl, false }, numThreads, numKeys, prepareMs, durationMs);
+			testCacheStatusManagerTtl("stale-while-revalidate, background refresh", CacheTtl{ softTtl, hardTtl, true }, numThreads, numKeys, prepareMs, durationMs);
+			std::cout << std::endl;
+			getVerboseLog().store(true);
+		}
+
+		//numThreads threads call get() (9 out of 10) and set() on random keys for one second, without the logging of Cache
+		void testStripedCacheThroughput(size_t numShards, int numThreads)
+		{
+			using CacheType = StripedCache<MyKey, std::shared_ptr<MyValue>, Hash<MyKey>>;
+			constexpr const int numKeys = 10000;
+			constexpr const int durationMs = 1000;
+
+			CacheType cache{ numShards };
+			std::vector<std::shared_ptr<MyValue>> values;
+			values.reserve(numKeys);
+			for (int i = 0; i < numKeys; ++i)
+			{
+				values.push_back(std::make_shared<MyValue>(i));
+				cache.set(MyKey{ i }, values.back());
+			}
+
+			std::atomic<bool> stop{ false };
+			std::vector<size_t> numOps(numThreads, 0);
+			std::vector<std::thread> threadPool;
+			threadPool.reserve(numThreads);
+			for (int i = 0; i < numThreads; ++i)
+			{
+				threadPool.push_back(std::thread{ [&, i]() {
+					std::mt19937 mt(i);
+					std::uniform_int_distribution<int> distKey(0, numKeys - 1);
+					size_t ops = 0;
+					for (; !stop.load(std::memory_order_relaxed); ++ops)
+					{
+						const int key = distKey(mt);
+						if (ops % 10 == 0)
+							cache.set(MyKey{ key }, values[key]);
+						else if (!cache.get(MyKey{ key }))
+							log("CRIT", "StripedCache: value missing: key: ", key);
+					}
+					numOps[i] = ops;
+				} });
+			}
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(durationMs));
+			stop.store(true);
+			for (std::thread& t : threadPool)
+				t.join();
+
+			size_t totalOps = 0;
+			for (size_t n : numOps)
+				totalOps += n;
+
+			std::cout << "\n" << std::setw(10) << "shards: " << std::setw(4) << cache.getNumShards()
+				<< "   threads: " << std::setw(4) << numThreads
+				<< "   ops/sec: " << std::setw(15) << totalOps * 1000 / durationMs;
+		}
+
+		void testStripedCacheThroughput()
+		{
+			std::cout << "\n\n----testStripedCacheThroughput (1 shard is the single mutex of Cache) ----\n";
+			const int numThreads = 200;
+			for (size_t numShards : { 1, 2, 4, 8, 16, 64, 256 })
+				testStripedCacheThroughput(numShards, numThreads);
+			std::cout << std::endl;
+		}
+
 	}
 
 
@@ -179,8 +480,48 @@ namespace mm {
 
 	MM_UNIT_TEST(CacheStatusManager_v1_Test, CacheStatusManager_v1)
 	{
-		cacheStatusManager_v1::testCacheStatusManager(false);
-		//cacheStatusManager_v1::testCacheStatusManager(true);
+		using CacheType = cacheStatusManager_v1::Cache<cacheStatusManager_v1::MyKey, std::shared_ptr<cacheStatusManager_v1::MyValue>,
+			cacheStatusManager_v1::Hash<cacheStatusManager_v1::MyKey>>;
+		cacheStatusManager_v1::testCacheStatusManager<CacheType>(false);
+		//cacheStatusManager_v1::testCacheStatusManager<CacheType>(true);
+
+		using StripedCacheType = cacheStatusManager_v1::StripedCache<cacheStatusManager_v1::MyKey, std::shared_ptr<cacheStatusManager_v1::MyValue>,
+			cacheStatusManager_v1::Hash<cacheStatusManager_v1::MyKey>>;
+		cacheStatusManager_v1::testCacheStatusManager<StripedCacheType>(false);
+	}
+
+	MM_DECLARE_FLAG(CacheStatusManager_v1_Ttl);
+
+	MM_UNIT_TEST(CacheStatusManager_v1_Ttl_Test, CacheStatusManager_v1_Ttl)
+	{
+		std::cout.imbue(std::locale{ "" });
+
+		cacheStatusManager_v1::testCacheStatusManagerTtl();
+	}
+
+	MM_DECLARE_FLAG(CacheStatusManager_v1_Eviction);
+
+	MM_UNIT_TEST(CacheStatusManager_v1_Eviction_Test, CacheStatusManager_v1_Eviction)
+	{
+		std::cout.imbue(std::locale{ "" });
+
+		cacheStatusManager_v1::testStripedCacheEviction();
+	}
+
+	MM_DECLARE_FLAG(CacheStatusManager_v1_Wakeups);
+
+	MM_UNIT_TEST(CacheStatusManager_v1_Wakeups_Test, CacheStatusManager_v1_Wakeups)
+	{
+		cacheStatusManager_v1::testCacheStatusManagerWakeups();
+	}
+
+	MM_DECLARE_FLAG(CacheStatusManager_v1_StripedCache);
+
+	MM_UNIT_TEST(CacheStatusManager_v1_StripedCache_Test, CacheStatusManager_v1_StripedCache)
+	{
+		std::cout.imbue(std::locale{ "" });
+
+		cacheStatusManager_v1::testStripedCacheThroughput();
 	}
 }
 
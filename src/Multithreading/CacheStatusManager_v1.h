@@ -10,6 +10,14 @@
 #include <sstream>
 #include <mutex>
 #include <condition_variable>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <limits>
+#include <algorithm>
 
 #include "MM_UnitTestFramework/MM_UnitTestFramework.h"
 
@@ -55,9 +63,19 @@ namespace mm {
 			log(out, std::forward<Args>(args)...);
 		}
 
+		//The benchmarks turn off the DEBG and INFO lines: every log line goes through std::cout, which serializes the threads
+		std::atomic<bool>& getVerboseLog()
+		{
+			static std::atomic<bool> verbose{ true };
+			return verbose;
+		}
+
 		template<typename... Args>
 		void log(const std::string& level, Args&&... args)
 		{
+			if ((level == "DEBG" || level == "INFO") && !getVerboseLog().load(std::memory_order_relaxed))
+				return;
+
 			std::stringstream ss;
 			ss << "\n" << level << " [" << getThreadId() << "] ";
 			//using expander = int[];
@@ -106,6 +124,216 @@ namespace mm {
 			std::mutex mu_;
 		};
 
+		struct StripedCacheStats
+		{
+			size_t numHits;
+			size_t numMisses;
+			size_t numEvictions;
+			size_t numEvictionSteps; //slots the CLOCK hand passed to find the victims, the cost of the evictions
+			size_t size;
+		};
+
+		/*
+		Lock striped cache: same interface as Cache, but the map is split into numShards shards, each with its own mutex.
+		A key always goes to the shard chosen by its hash, so operations on keys of different shards do not wait for each other,
+		and with N shards about N threads can use the cache at the same time instead of one.
+		Each shard is aligned to the cache line (alignas(64), new Shard[] honours it since C++17), so that the mutexes of neighbouring shards do not share a cache line.
+		get() and set() do not log: every log line goes through std::cout, which would serialize them again.
+
+		Capacity: each shard holds at most capacity / numShards (rounded up) entries, and evicts by CLOCK (approximate LRU) when it is full.
+		The entries of a shard are a ring of slots with a referenced bit, and a map from the key to the slot:
+			get():  a hit sets the referenced bit of the slot.
+			set():  a new key takes a free slot if there is one. Else the hand goes round the ring: a referenced slot gets a second chance (the bit
+			        is cleared), the first slot which is not referenced is the victim, and the new key takes it over.
+			        A new key starts not referenced, so a key which is never read again is evicted before the keys which were.
+		Both are O(1): the hand clears every bit it passes, so it finds a victim within one round, and on average after a few slots.
+		The default capacity is unbounded (no eviction), like Cache.
+		*/
+		template<
+			typename KeyType, typename ValueType,
+			typename Hasher = std::hash<KeyType>, typename KeyEqual = std::equal_to<KeyType>,
+			typename std::enable_if<is_shared_ptr<ValueType>::value>::type* = nullptr>
+		class StripedCache
+		{
+		public:
+			enum : size_t
+			{
+				defaultNumShards = 64,
+				unboundedCapacity = std::numeric_limits<size_t>::max()
+			};
+
+			explicit StripedCache(size_t numShards = defaultNumShards, size_t capacity = unboundedCapacity)
+				: numShards_{ numShards > 0 ? numShards : 1 },
+				shardCapacity_{ capacity == unboundedCapacity ? capacity : std::max<size_t>(capacity / numShards_ + (capacity % numShards_ != 0 ? 1 : 0), 1) },
+				shards_{ new Shard[numShards_] }
+			{
+			}
+
+			StripedCache(const StripedCache&) = delete;
+			StripedCache& operator=(const StripedCache&) = delete;
+
+			void set(const KeyType& key, ValueType value)
+			{
+				Shard& shard = getShard(key);
+				std::unique_lock<std::mutex> lock{ shard.mu_ };
+				auto it = shard.index_.find(key);
+				if (it != shard.index_.end())
+				{
+					shard.slots_[it->second].value_ = value;
+					return;
+				}
+
+				if (shard.slots_.size() < shardCapacity_)
+				{
+					shard.index_.emplace(key, shard.slots_.size());
+					shard.slots_.push_back(Slot{ key, value, false });
+					return;
+				}
+
+				const size_t victimIndex = findVictim(shard);
+				Slot& victim = shard.slots_[victimIndex];
+				shard.index_.erase(victim.key_);
+				++shard.stats_.numEvictions;
+				victim.key_ = key;
+				victim.value_ = value;
+				victim.referenced_ = false;
+				shard.index_.emplace(key, victimIndex);
+			}
+
+			ValueType get(const KeyType& key)
+			{
+				Shard& shard = getShard(key);
+				std::unique_lock<std::mutex> lock{ shard.mu_ };
+				auto it = shard.index_.find(key);
+				if (it != shard.index_.end())
+				{
+					++shard.stats_.numHits;
+					Slot& slot = shard.slots_[it->second];
+					slot.referenced_ = true;
+					return slot.value_;
+				}
+
+				++shard.stats_.numMisses;
+				return nullptr;
+			}
+
+			//Not atomic across the shards: a set() running at the same time may survive in a shard which was already cleared
+			void clear()
+			{
+				log("INFO", "StripedCache: Clearing cache");
+				for (size_t i = 0; i < numShards_; ++i)
+				{
+					std::unique_lock<std::mutex> lock{ shards_[i].mu_ };
+					shards_[i].index_.clear();
+					shards_[i].slots_.clear();
+					shards_[i].hand_ = 0;
+				}
+			}
+
+			size_t getNumShards() const
+			{
+				return numShards_;
+			}
+
+			size_t getCapacity() const
+			{
+				return shardCapacity_ == unboundedCapacity ? unboundedCapacity : shardCapacity_ * numShards_;
+			}
+
+			StripedCacheStats getStats()
+			{
+				StripedCacheStats total{};
+				for (size_t i = 0; i < numShards_; ++i)
+				{
+					std::unique_lock<std::mutex> lock{ shards_[i].mu_ };
+					const StripedCacheStats& stats = shards_[i].stats_;
+					total.numHits += stats.numHits;
+					total.numMisses += stats.numMisses;
+					total.numEvictions += stats.numEvictions;
+					total.numEvictionSteps += stats.numEvictionSteps;
+					total.size += shards_[i].slots_.size();
+				}
+				return total;
+			}
+
+		private:
+			struct Slot
+			{
+				KeyType key_;
+				ValueType value_;
+				bool referenced_;
+			};
+
+			using MapType = std::unordered_map<KeyType, size_t, Hasher, KeyEqual>;
+
+			struct alignas(64) Shard
+			{
+				std::mutex mu_;
+				MapType index_;
+				std::vector<Slot> slots_;
+				size_t hand_{ 0 };
+				StripedCacheStats stats_{};
+			};
+
+			Shard& getShard(const KeyType& key)
+			{
+				//The maps use the same hash, mix it (splitmix64 finalizer) so that the shard index does not depend on the same bits as the
+				//bucket index of the map inside the shard, e.g. for std::hash<int>, which is the identity
+				uint64_t hash = static_cast<uint64_t>(Hasher{}(key));
+				hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ULL;
+				hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBULL;
+				hash ^= hash >> 31;
+				return shards_[hash % numShards_];
+			}
+
+			//Called with the shard locked and full
+			size_t findVictim(Shard& shard)
+			{
+				while (true)
+				{
+					const size_t index = shard.hand_;
+					shard.hand_ = (shard.hand_ + 1) % shard.slots_.size();
+					++shard.stats_.numEvictionSteps;
+					Slot& slot = shard.slots_[index];
+					if (!slot.referenced_)
+						return index;
+					slot.referenced_ = false;
+				}
+			}
+
+			const size_t numShards_;
+			const size_t shardCapacity_;
+			std::unique_ptr<Shard[]> shards_;
+		};
+
+		struct CacheStatusManagerStats
+		{
+			size_t numSets;           //values set by the thread which had write access
+			size_t numWakeups;        //returns from a wait on a condition variable (notified, spurious or timed out)
+			size_t numWaitersAtSets;  //threads waiting for any key when the values were set, i.e. the wakeups of a single notify_all() for all keys
+			size_t numStaleHits;      //stale values returned while one thread was refreshing them
+			size_t numRefreshes;      //refreshes started after a soft expiry
+		};
+
+		/*
+		Expiry of the cached values, checked lazily when a key is asked for:
+			softTtl: after it, the value is stale. The next caller of setAndGet() gets write access and refreshes it, and everyone else
+			         keeps getting the stale value without waiting (stale-while-revalidate). Zero: the values never expire.
+			hardTtl: after it, the value is not returned any more, callers wait for the new one as if there was none. Zero: only soft expiry.
+			         Should be longer than softTtl, so that a refresh has time to finish before the value has to go.
+			backgroundRefresh: the refresh runs on a background thread of the manager instead of the thread which found the stale value,
+			         so that no caller waits for it, not even the one which got write access. There is one refresher thread, so the refreshes
+			         run one after the other: if they take longer on the whole than softTtl, the values stay stale for longer.
+		Both TTLs start when the value is set. Expiring only the keys which are asked for, one refresh per key, replaces the clear() of
+		the whole cache to pick up new data, after which every thread would rebuild at once.
+		*/
+		struct CacheTtl
+		{
+			std::chrono::milliseconds softTtl{ 0 };
+			std::chrono::milliseconds hardTtl{ 0 };
+			bool backgroundRefresh{ false };
+		};
+
 		template<
 			//template<typename... Args> typename CacheType,
 			typename CacheType,
@@ -115,8 +343,34 @@ namespace mm {
 		class CacheStatusManager
 		{
 		public:
-			CacheStatusManager(CacheType& cache) : cache_{ cache } {}
-			~CacheStatusManager() = default;
+			enum : size_t
+			{
+				defaultMaxStatusEntries = 1 << 16
+			};
+
+			//maxStatusEntries: the status entries of the keys are pruned once there are more of them, see pruneStatusEntries()
+			CacheStatusManager(CacheType& cache, size_t maxStatusEntries = defaultMaxStatusEntries, CacheTtl ttl = CacheTtl{})
+				: cache_{ cache },
+				maxStatusEntries_{ maxStatusEntries },
+				pruneThreshold_{ maxStatusEntries },
+				ttl_{ ttl }
+			{
+				if (ttl_.backgroundRefresh)
+					refresher_ = std::thread{ [this]() { runRefresher(); } };
+			}
+
+			//The refreshes which did not start yet are dropped
+			~CacheStatusManager()
+			{
+				if (!refresher_.joinable())
+					return;
+
+				std::unique_lock<std::mutex> lock{ muRefresh_ };
+				stopRefresher_ = true;
+				lock.unlock();
+				cvRefresh_.notify_one();
+				refresher_.join();
+			}
 
 			template<typename Fun, typename... Args>
 			ValueType setAndGet(const KeyType& key, int numRetries, bool wait, size_t timeoutMilliSec, Fun funToCreateValue, Args... args)
@@ -126,7 +380,14 @@ namespace mm {
 				{
 					log("DEBG", "CacheStatusManager: setOrGet: tries: ", tries);
 					WriteAccess wa = getWriteAccess(key);
-					if (wa.accessGranted())
+					if (wa.accessGranted() && wa.isRefresh() && ttl_.backgroundRefresh)
+					{
+						//Hand the refresh over to the refresher thread, and return the stale value meanwhile
+						addRefresh(key, [funToCreateValue, args...]() mutable { return funToCreateValue(args...); });
+						wa.handOver();
+						value = get(key, false, 0);
+					}
+					else if (wa.accessGranted())
 					{
 						value = funToCreateValue(std::forward<Args>(args)...); //this function may throw
 						wa.set(value);
@@ -141,11 +402,13 @@ namespace mm {
 			ValueType get(const KeyType& key, bool wait, size_t timeoutMilliSec)
 			{
 				std::unique_lock<std::mutex> lock{ muStatus_ };
-				//No other thread deletes the entry from cache, so we can rely on reference to status without searching again and again
-				CacheStatus& status = cacheStatus_[key];
+				//The entry is not pruned while it is preparing or has waiters, so we can rely on reference to status without searching again and again
+				StatusEntry& entry = getStatusEntry(key);
+				CacheStatus& status = entry.status_;
 
 				std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
-				while (status == CacheStatus::preparing)
+				//A stale value is returned while it is refreshed, unless it is past its hard TTL
+				while (status == CacheStatus::preparing || (status == CacheStatus::refreshing && isHardExpired(entry, std::chrono::steady_clock::now())))
 				{
 					if (!wait) return nullptr;
 
@@ -153,27 +416,36 @@ namespace mm {
 					std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
 					std::chrono::milliseconds elaspedTime = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
 					std::chrono::milliseconds remainingTimeout = std::chrono::milliseconds{ timeoutMilliSec } -elaspedTime;
-					if (remainingTimeout.count() <= 0 || cvStatus_.wait_for(lock, remainingTimeout) == std::cv_status::timeout)
+					if (remainingTimeout.count() <= 0 || waitFor(lock, entry, remainingTimeout) == std::cv_status::timeout)
 					{
 						//The thread which was preparing data could not finish within time limit, reason may be exception, infinite loop etc.
 						log("CRIT", "CacheStatusManager: get: timed out: key: ", key);
-						if (status != CacheStatus::available) //If no other thread has yet pushed data in cache
+						if (status == CacheStatus::preparing) //If no other thread has yet pushed data in cache
 						{
 							status = CacheStatus::unavailable;
-							lock.unlock();
-							cvStatus_.notify_all();
+							entry.cv_.notify_all();
 							return nullptr;
 						}
-
+						//A refresh is still in progress: it keeps the write access and resets the status itself when it is over,
+						//but the stale value is past its hard TTL, so there is nothing to return meanwhile
+						if (status == CacheStatus::refreshing)
+							return nullptr;
 					}
 				}
 
-				if (status == CacheStatus::available)
-					return cache_.get(key);
-
-				return nullptr;
+				//The value may have been evicted from the cache or have expired since it was set, then the next getWriteAccess() prepares it again
+				ValueType value = isHardExpired(entry, std::chrono::steady_clock::now()) ? nullptr : cache_.get(key);
+				if (status == CacheStatus::refreshing)
+				{
+					if (value)
+						++stats_.numStaleHits;
+				}
+				else
+					status = value ? CacheStatus::available : CacheStatus::unavailable;
+				return value;
 			}
 
+			//No thread may be waiting in get(): the condition variables of the keys are destroyed with the status entries
 			void clear()
 			{
 				log("INFO", "CacheStatusManager: clear: ");
@@ -182,8 +454,18 @@ namespace mm {
 				lock.unlock();
 
 				cache_.clear();
+			}
+
+			CacheStatusManagerStats getStats()
+			{
+				std::unique_lock<std::mutex> lock{ muStatus_ };
+				return stats_;
+			}
 
-				cvStatus_.notify_all(); //in case any thread is still waiting on cv. (THIS SHOULD NOT HAPPEN)
+			size_t getNumStatusEntries()
+			{
+				std::unique_lock<std::mutex> lock{ muStatus_ };
+				return cacheStatus_.size();
 			}
 
 		private:
@@ -191,10 +473,11 @@ namespace mm {
 			class WriteAccess
 			{
 			public:
-				WriteAccess(CacheStatusManager& cacheStatusMgr, const KeyType& key, bool accessGranted) :
+				WriteAccess(CacheStatusManager& cacheStatusMgr, const KeyType& key, bool accessGranted, bool isRefresh = false) :
 					cacheStatusMgr_{ cacheStatusMgr },
 					key_{ key },
-					accessGranted_{ accessGranted }
+					accessGranted_{ accessGranted },
+					isRefresh_{ isRefresh }
 				{}
 
 				//Do not allow copy
@@ -224,24 +507,44 @@ namespace mm {
 				}
 
 				bool accessGranted() { return accessGranted_; }
+				//The key has a stale value, which the other threads get until this one sets the new value
+				bool isRefresh() { return isRefresh_; }
+
+				//Another thread (the refresher) sets the value or resets the status, so do not reset it on destruction
+				void handOver() { accessGranted_ = false; }
 
 			private:
 				CacheStatusManager& cacheStatusMgr_;
 				KeyType key_;
 				bool accessGranted_{ false };
+				bool isRefresh_{ false };
 			};
 
 			WriteAccess getWriteAccess(const KeyType& key)
 			{
 				std::unique_lock<std::mutex> lock{ muStatus_ };
 
-				CacheStatus& status = cacheStatus_[key];
+				StatusEntry& entry = getStatusEntry(key);
+				CacheStatus& status = entry.status_;
+				//Unless some thread is preparing or refreshing it, the status follows the cache: the value may have been evicted,
+				//or the entry pruned, or the value may have expired
+				const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+				if (status == CacheStatus::available || status == CacheStatus::unavailable)
+					status = !isHardExpired(entry, now) && cache_.get(key) ? CacheStatus::available : CacheStatus::unavailable;
+
 				if (status == CacheStatus::unavailable)
 				{
 					log("INFO", "CacheStatusManager: getWriteAccess: access granted: key: ", key);
 					status = CacheStatus::preparing;
 					return WriteAccess{ *this, key, true };
 				}
+				else if (status == CacheStatus::available && isSoftExpired(entry, now))
+				{
+					log("INFO", "CacheStatusManager: getWriteAccess: refresh access granted: key: ", key);
+					status = CacheStatus::refreshing;
+					++stats_.numRefreshes;
+					return WriteAccess{ *this, key, true, true };
+				}
 				else
 					return WriteAccess{ *this, key, false };
 			}
@@ -249,18 +552,22 @@ namespace mm {
 			void set(const KeyType& key, ValueType value)
 			{
 				std::unique_lock<std::mutex> lock{ muStatus_ };
-				CacheStatus& status = cacheStatus_[key];
-				status = CacheStatus::available;
+				StatusEntry& entry = getStatusEntry(key);
+				entry.status_ = CacheStatus::available;
+				const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+				entry.softExpiry_ = now + ttl_.softTtl;
+				entry.hardExpiry_ = now + ttl_.hardTtl;
 				cache_.set(key, value); //update the cache under cacheStatus lock
-				lock.unlock();
-
-				cvStatus_.notify_all();
+				++stats_.numSets;
+				stats_.numWaitersAtSets += numWaiters_;
+				entry.cv_.notify_all();
 			}
 
 			void resetStatusIfStillPreparing(const KeyType& key)
 			{
 				std::unique_lock<std::mutex> lock{ muStatus_ };
-				CacheStatus& status = cacheStatus_[key];
+				StatusEntry& entry = getStatusEntry(key);
+				CacheStatus& status = entry.status_;
 				if (status == CacheStatus::preparing)
 				{
 					//If the status is still not 'available', probably due to exception or infinite loop etc in data preparing function,
@@ -269,8 +576,15 @@ namespace mm {
 					log("CRIT", "CacheStatusManager: resetStatusIfStillPreparing: data is still not cached");
 
 					status = CacheStatus::unavailable;
-					lock.unlock();
-					cvStatus_.notify_all();
+					entry.cv_.notify_all();
+				}
+				else if (status == CacheStatus::refreshing)
+				{
+					//The refresh failed, keep the stale value. The next caller tries to refresh it again.
+					log("CRIT", "CacheStatusManager: resetStatusIfStillPreparing: data is still not refreshed");
+
+					status = CacheStatus::available;
+					entry.cv_.notify_all(); //in case the value hard expired meanwhile and some threads wait for it
 				}
 			}
 
@@ -278,13 +592,134 @@ namespace mm {
 			{
 				unavailable = 0,
 				preparing,
-				available
+				available,
+				refreshing  //available, but stale, and one thread is preparing the new value
+			};
+
+			//Each key has its own condition variable, so that setting the value of a key wakes up only the threads waiting for that key,
+			//not the waiters of all the other keys (which would only lock muStatus_ and go back to sleep).
+			//An entry with waiters is never pruned, so a waiter can keep a reference to its entry while it waits.
+			//The condition variables are notified with muStatus_ held: once it is unlocked, the entry could be pruned or cleared.
+			//The expiries of a new entry are in the past, so a value which is still in the cache after its entry was pruned counts as expired
+			struct StatusEntry
+			{
+				CacheStatus status_{ CacheStatus::unavailable };
+				size_t numWaiters_{ 0 };
+				std::chrono::steady_clock::time_point softExpiry_;
+				std::chrono::steady_clock::time_point hardExpiry_;
+				std::condition_variable cv_;
+			};
+
+			bool isSoftExpired(const StatusEntry& entry, std::chrono::steady_clock::time_point now) const
+			{
+				return ttl_.softTtl.count() > 0 && now >= entry.softExpiry_;
+			}
+
+			bool isHardExpired(const StatusEntry& entry, std::chrono::steady_clock::time_point now) const
+			{
+				return ttl_.hardTtl.count() > 0 && now >= entry.hardExpiry_;
+			}
+
+			//Called with muStatus_ locked
+			StatusEntry& getStatusEntry(const KeyType& key)
+			{
+				auto it = cacheStatus_.find(key);
+				if (it != cacheStatus_.end())
+					return it->second;
+
+				if (cacheStatus_.size() >= pruneThreshold_)
+					pruneStatusEntries();
+				return cacheStatus_[key];
+			}
+
+			//Erases the entries which are not preparing or refreshing and have no waiters. They can be made again from the cache (see getWriteAccess()),
+			//so the number of entries stays around maxStatusEntries_, however many keys come and go.
+			//With a hard TTL the available entries are kept until they expire: a new entry counts as hard expired, which would drop the value.
+			//The next prune happens when the map has doubled again, so that the O(n) sweep is amortized O(1) per new key even if most of
+			//the entries are in use.
+			void pruneStatusEntries()
+			{
+				const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+				for (auto it = cacheStatus_.begin(); it != cacheStatus_.end();)
+				{
+					const StatusEntry& entry = it->second;
+					const bool inUse = entry.status_ == CacheStatus::preparing || entry.status_ == CacheStatus::refreshing || entry.numWaiters_ > 0;
+					const bool isFresh = entry.status_ == CacheStatus::available && ttl_.hardTtl.count() > 0 && !isHardExpired(entry, now);
+					if (!inUse && !isFresh)
+						it = cacheStatus_.erase(it);
+					else
+						++it;
+				}
+				pruneThreshold_ = std::max(maxStatusEntries_, 2 * cacheStatus_.size());
+			}
+
+			std::cv_status waitFor(std::unique_lock<std::mutex>& lock, StatusEntry& entry, std::chrono::milliseconds timeout)
+			{
+				++numWaiters_;
+				++entry.numWaiters_;
+				const std::cv_status result = entry.cv_.wait_for(lock, timeout);
+				--entry.numWaiters_;
+				--numWaiters_;
+				++stats_.numWakeups;
+				return result;
+			}
+
+			void addRefresh(const KeyType& key, std::function<ValueType()> prepare)
+			{
+				std::unique_lock<std::mutex> lock{ muRefresh_ };
+				refreshes_.push_back(Refresh{ key, std::move(prepare) });
+				lock.unlock();
+				cvRefresh_.notify_one();
+			}
+
+			void runRefresher()
+			{
+				while (true)
+				{
+					std::unique_lock<std::mutex> lock{ muRefresh_ };
+					cvRefresh_.wait(lock, [this]() { return stopRefresher_ || !refreshes_.empty(); });
+					if (stopRefresher_)
+						return;
+					Refresh refresh = std::move(refreshes_.front());
+					refreshes_.pop_front();
+					lock.unlock();
+
+					try
+					{
+						set(refresh.key_, refresh.prepare_());
+					}
+					catch (std::exception& e)
+					{
+						log("CRIT", "CacheStatusManager: refresher: exception: ", e.what(), " key: ", refresh.key_);
+					}
+					catch (...)
+					{
+						log("CRIT", "CacheStatusManager: refresher: unknown exception: key: ", refresh.key_);
+					}
+					resetStatusIfStillPreparing(refresh.key_); //restores the stale status if the refresh failed
+				}
+			}
+
+			struct Refresh
+			{
+				KeyType key_;
+				std::function<ValueType()> prepare_;
 			};
 
 			CacheType& cache_;
-			std::unordered_map<KeyType, CacheStatus, Hasher, KeyEqual> cacheStatus_;
+			std::unordered_map<KeyType, StatusEntry, Hasher, KeyEqual> cacheStatus_;
 			std::mutex muStatus_;
-			std::condition_variable cvStatus_;
+			const size_t maxStatusEntries_;
+			size_t pruneThreshold_;
+			size_t numWaiters_{ 0 };
+			CacheStatusManagerStats stats_{};
+			const CacheTtl ttl_;
+
+			std::mutex muRefresh_;
+			std::condition_variable cvRefresh_;
+			std::deque<Refresh> refreshes_;
+			bool stopRefresher_{ false };
+			std::thread refresher_; //only with ttl_.backgroundRefresh
 		};
 
 	}
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <cstdint>
+#include <atomic>
+
+#include "MM_UnitTestFramework/MM_UnitTestFramework.h"
+#include "NumaTopology.h"
+#include "SpinPolicy.h"
+#include "TryLockUntil.h"
+
+/*
+Cohort lock (NUMA-aware mutex).
+Reference: Dice, Marathe, Shavit, "Lock Cohorting: A General Technique for Designing NUMA Locks" (PPoPP 2012), C-TKT-TKT variant
+
+On a multi-socket machine, handing a lock (and the data it protects) to a thread on another node costs several times more than handing it to
+a thread on the same node, and none of the other locks in this repo know which node a thread is on.
+The cohort lock is a global lock plus one local lock per NUMA node (see NumaTopology.h):
+	lock():   acquire the local lock of the current node, then the global lock, unless the previous holder of the local lock has left it
+	          to this thread (then this cohort still owns the global lock).
+	unlock(): if another thread of the same node is waiting for the local lock, and the global lock has not been passed locally
+	          maxLocalHandoffs times in a row yet, release only the local lock and leave the global lock to it. Else release both.
+So the lock moves between the nodes at most once per maxLocalHandoffs + 1 critical sections when the threads of several nodes compete,
+and the limit keeps one node from starving the others.
+
+The global lock is released by whichever thread of the cohort holds it last, not by the one which acquired it, so it must be thread-oblivious:
+both locks are ticket locks (FIFO within a node, and FIFO between the nodes). unlock() does not need the current node, the node of the
+holder is stored in the lock, so a thread which is moved to another cpu inside the critical section still releases the right local lock.
+
+Ticket lock waiters can not give up their ticket, so try_lock() takes a ticket only if the lock is free, and try_lock_until() retries
+try_lock() until the deadline.
+
+Waiters spin by spinWaitUntil() (see SpinPolicy.h): cpuRelax() for a while and then yield, so that an oversubscribed machine still makes progress.
+*/
+
+namespace mm {
+
+	namespace cohortLock_v1 {
+
+		class TicketLock
+		{
+		public:
+			TicketLock()
+				: nextTicket_{ 0 },
+				nowServing_{ 0 }
+			{
+			}
+
+			TicketLock(const TicketLock&) = delete;
+			TicketLock& operator=(const TicketLock&) = delete;
+
+			void lock()
+			{
+				const uint32_t ticket = nextTicket_.fetch_add(1, std::memory_order_relaxed);
+				spinWaitUntil([this, ticket]() { return nowServing_.load(std::memory_order_acquire) == ticket; });
+			}
+
+			//Takes a ticket only if it is served immediately
+			bool try_lock()
+			{
+				uint32_t ticket = nowServing_.load(std::memory_order_acquire);
+				return nextTicket_.compare_exchange_strong(ticket, ticket + 1, std::memory_order_acquire, std::memory_order_relaxed);
+			}
+
+			void unlock()
+			{
+				nowServing_.store(nowServing_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+			}
+
+			//Only for the holder: is any other thread waiting?
+			bool hasWaiters() const
+			{
+				return nextTicket_.load(std::memory_order_relaxed) - nowServing_.load(std::memory_order_relaxed) > 1;
+			}
+
+		private:
+			std::atomic<uint32_t> nextTicket_;
+			std::atomic<uint32_t> nowServing_;
+		};
+
+		struct CohortLockStats
+		{
+			CohortLockStats()
+				: localHandoffs{ 0 },
+				globalReleases{ 0 }
+			{}
+
+			size_t localHandoffs;   //number of times unlock() passed the global lock to a waiter of the same node
+			size_t globalReleases;  //number of times unlock() released the global lock
+		};
+
+		class CohortLock
+		{
+		public:
+			enum : unsigned int { defaultMaxLocalHandoffs = 64 };
+
+			explicit CohortLock(const NumaTopology& topology = NumaTopology::getDefault(), unsigned int maxLocalHandoffs = defaultMaxLocalHandoffs)
+				: topology_{ topology },
+				maxLocalHandoffs_{ maxLocalHandoffs },
+				cohorts_{ new Cohort[topology_.getNumNodes()] },
+				ownerNode_{ 0 },
+				localHandoffs_{ 0 },
+				globalReleases_{ 0 }
+			{
+			}
+
+			CohortLock(const CohortLock&) = delete;
+			CohortLock& operator=(const CohortLock&) = delete;
+
+			void lock()
+			{
+				const unsigned int node = topology_.getCurrentNode();
+				Cohort& cohort = cohorts_[node];
+				cohort.localLock_.lock();
+				if (!cohort.ownsGlobalLock_)
+				{
+					globalLock_.lock();
+					cohort.ownsGlobalLock_ = true;
+				}
+				ownerNode_ = node;
+			}
+
+			void unlock()
+			{
+				Cohort& cohort = cohorts_[ownerNode_];
+				if (cohort.numLocalHandoffs_ < maxLocalHandoffs_ && cohort.localLock_.hasWaiters())
+				{
+					//The waiter has a ticket and can not give it up, so it is going to take over the global lock
+					++cohort.numLocalHandoffs_;
+					localHandoffs_.store(localHandoffs_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+				}
+				else
+				{
+					cohort.numLocalHandoffs_ = 0;
+					cohort.ownsGlobalLock_ = false;
+					globalReleases_.store(globalReleases_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+					globalLock_.unlock();
+				}
+				cohort.localLock_.unlock();
+			}
+
+			bool try_lock()
+			{
+				const unsigned int node = topology_.getCurrentNode();
+				Cohort& cohort = cohorts_[node];
+				if (!cohort.localLock_.try_lock())
+					return false;
+				if (!cohort.ownsGlobalLock_)
+				{
+					if (!globalLock_.try_lock())
+					{
+						cohort.localLock_.unlock();
+						return false;
+					}
+					cohort.ownsGlobalLock_ = true;
+				}
+				ownerNode_ = node;
+				return true;
+			}
+
+			bool try_lock_until(LockDeadline deadline)
+			{
+				return retryUntil(deadline, [this]() { return try_lock(); });
+			}
+
+			const NumaTopology& getTopology() const
+			{
+				return topology_;
+			}
+
+			CohortLockStats getStats() const
+			{
+				CohortLockStats stats;
+				stats.localHandoffs = localHandoffs_.load(std::memory_order_relaxed);
+				stats.globalReleases = globalReleases_.load(std::memory_order_relaxed);
+				return stats;
+			}
+
+		private:
+			struct Cohort
+			{
+				Cohort()
+					: ownsGlobalLock_{ false },
+					numLocalHandoffs_{ 0 }
+				{}
+
+				TicketLock localLock_;
+				//Accessed only by the holder of localLock_
+				bool ownsGlobalLock_;
+				unsigned int numLocalHandoffs_;
+				char pad[64 - sizeof(TicketLock) - sizeof(bool) - sizeof(unsigned int)];
+			};
+
+			const NumaTopology topology_;
+			const unsigned int maxLocalHandoffs_;
+			std::unique_ptr<Cohort[]> cohorts_;
+			char pad0[64];
+			TicketLock globalLock_;
+			char pad1[64 - sizeof(TicketLock)];
+			//Accessed only by the holder of the lock
+			unsigned int ownerNode_;
+			//Written only by the holder of the lock, atomic only so that getStats() can read them at any time
+			std::atomic<size_t> localHandoffs_;
+			std::atomic<size_t> globalReleases_;
+		};
+
+	}
+
+}
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <iostream>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <atomic>
+#include <cstdint>
+using namespace std;
+
+/*
+EventCount: a condition variable which does not need a mutex to protect the condition, and which does not signal anybody if nobody is waiting.
+Reference: folly::EventCount and Dmitry Vyukov's eventcount:
+https://github.com/facebook/folly/blob/main/folly/experimental/EventCount.h
+
+The state is one 64 bit atomic: the upper 32 bits are the epoch and the lower 32 bits are the number of waiters.
+
+Waiter:
+	while (!condition())
+	{
+		EventCount::Key key = ec.prepareWait(); //register as waiter and remember the epoch
+		if (condition())                        //check again, the notifier may have missed the registration above
+		{
+			ec.cancelWait();
+			break;
+		}
+		ec.commitWait(key, timeout);            //sleep until the epoch changes
+	}
+
+Notifier:
+	makeConditionTrue();
+	ec.notify();                                //only an atomic load if nobody is waiting
+
+There is no lost wakeup: the waiter increments the waiter count before it checks the condition again,
+and the notifier makes the condition true before it reads the waiter count (both seq_cst). So either the waiter sees the condition
+or the notifier sees the waiter. If the notifier sees the waiter, it changes the epoch, and commitWait() returns as soon as the epoch
+is different from the key (it checks the epoch under mutex_, and the notifier locks mutex_ after changing the epoch, so the
+notification can not reach between that check and the wait).
+
+The mutex and condition variable are used only to park the waiters (slow path).
+Stats: signals and wakeups count the slow path only. notifies counts every notify() and notifyAll() call, including the ones which found
+nobody waiting, so notifies - signals is the number of notifications which took the fast path. The fast path must not write a cache line
+shared by all the notifiers, so notifies is a striped counter: each thread adds to the stripe of its own thread index.
+*/
+
+namespace mm {
+
+	struct EventCountStats
+	{
+		EventCountStats()
+			: notifies{ 0 },
+			signals{ 0 },
+			wakeups{ 0 }
+		{}
+
+		size_t notifies; //number of notify() or notifyAll() calls, whether they found a waiter or not
+		size_t signals; //number of notify() or notifyAll() calls which found a waiter and signalled it
+		size_t wakeups; //number of commitWait() calls which returned due to notification (not due to timeout)
+	};
+
+	class EventCount
+	{
+	public:
+		class Key
+		{
+			friend class EventCount;
+			explicit Key(uint32_t epoch) : epoch_{ epoch } {}
+			uint32_t epoch_;
+		};
+
+		EventCount()
+			: state_a{ 0 },
+			signals_a{ 0 },
+			wakeups_a{ 0 }
+		{}
+
+		EventCount(const EventCount&) = delete;
+		EventCount& operator=(const EventCount&) = delete;
+
+		//Wakes up at least one waiter if there is any
+		void notify()
+		{
+			notifyImpl(false);
+		}
+
+		//Wakes up all the waiters
+		void notifyAll()
+		{
+			notifyImpl(true);
+		}
+
+		Key prepareWait()
+		{
+			uint64_t prevState = state_a.fetch_add(oneWaiter, memory_order_seq_cst);
+			return Key{ static_cast<uint32_t>(prevState >> epochShift) };
+		}
+
+		void cancelWait()
+		{
+			state_a.fetch_sub(oneWaiter, memory_order_seq_cst);
+		}
+
+		//Returns false if timeout occurs
+		bool commitWait(const Key& key, const std::chrono::milliseconds& timeout)
+		{
+			bool notified = true;
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				while (getEpoch() == key.epoch_)
+				{
+					if (cv_.wait_for(lock, timeout) == std::cv_status::timeout)
+					{
+						notified = getEpoch() != key.epoch_;
+						break;
+					}
+				}
+			}
+
+			state_a.fetch_sub(oneWaiter, memory_order_seq_cst);
+			if (notified)
+				wakeups_a.fetch_add(1, memory_order_relaxed);
+			return notified;
+		}
+
+		EventCountStats getStats() const
+		{
+			EventCountStats stats;
+			for (int i = 0; i < numNotifyStripes; ++i)
+				stats.notifies += notifies_[i].count_a.load(memory_order_relaxed);
+			stats.signals = signals_a.load(memory_order_relaxed);
+			stats.wakeups = wakeups_a.load(memory_order_relaxed);
+			return stats;
+		}
+
+	private:
+		void notifyImpl(bool all)
+		{
+			notifies_[getThreadIndex() % numNotifyStripes].count_a.fetch_add(1, memory_order_relaxed);
+
+			//The condition is made true before this fence, pairs with the seq_cst fetch_add in prepareWait()
+			std::atomic_thread_fence(memory_order_seq_cst);
+			if ((state_a.load(memory_order_relaxed) & waitersMask) == 0)
+				return; //nobody is waiting
+
+			state_a.fetch_add(oneEpoch, memory_order_seq_cst);
+			{
+				//Acquire mutex_ for a moment, so that the notification can not reach between waiter's epoch check and its wait
+				std::unique_lock<std::mutex> lock(mutex_);
+			}
+			if (all)
+				cv_.notify_all();
+			else
+				cv_.notify_one();
+			signals_a.fetch_add(1, memory_order_relaxed);
+		}
+
+		static unsigned int getThreadIndex()
+		{
+			static std::atomic<unsigned int> nextThreadIndex{ 0 };
+			thread_local const unsigned int threadIndex = nextThreadIndex.fetch_add(1, memory_order_relaxed);
+			return threadIndex;
+		}
+
+		uint32_t getEpoch() const
+		{
+			return static_cast<uint32_t>(state_a.load(memory_order_seq_cst) >> epochShift);
+		}
+
+		static const int epochShift = 32;
+		static const uint64_t oneWaiter = 1;
+		static const uint64_t oneEpoch = uint64_t{ 1 } << epochShift;
+		static const uint64_t waitersMask = oneEpoch - 1;
+		static const int numNotifyStripes = 16;
+
+		struct alignas(64) NotifyStripe
+		{
+			NotifyStripe() : count_a{ 0 } {}
+			atomic<size_t> count_a;
+		};
+
+		atomic<uint64_t> state_a;
+		std::mutex mutex_;
+		std::condition_variable cv_;
+
+		// stats
+		NotifyStripe notifies_[numNotifyStripes];
+		atomic<size_t> signals_a; //slow path only
+		atomic<size_t> wakeups_a; //slow path only
+	};
+
+	inline EventCountStats operator+(const EventCountStats& lhs, const EventCountStats& rhs)
+	{
+		EventCountStats stats;
+		stats.notifies = lhs.notifies + rhs.notifies;
+		stats.signals = lhs.signals + rhs.signals;
+		stats.wakeups = lhs.wakeups + rhs.wakeups;
+		return stats;
+	}
+}
@@ -0,0 +1,286 @@
+#pragma once
+
+#include <iostream>
+#include <memory>
+#include <new>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <utility>
+#include <type_traits>
+
+#include "MM_UnitTestFramework/MM_UnitTestFramework.h"
+
+/*
+Flat combining.
+Reference: Hendler, Incze, Shavit, Tzafrir, "Flat Combining and the Synchronization-Parallelism Tradeoff" (SPAA 2010)
+
+A lock around a sequential container (e.g. ThreadSafeQueue in ReadWriteLockTesting.cpp) makes every thread acquire the lock, touch the container
+and release the lock. Under contention the lock word and the container move from core to core on every operation, and most of the time goes
+into the hand-over between the threads rather than into the operations themselves.
+With flat combining a thread does not operate on the container itself. It publishes its operation in its publication slot and then:
+	- if no other thread is the combiner, it becomes the combiner: it scans all the slots and applies all the pending operations (including its own)
+	  to the container in one batch, posting the result of each operation back into its slot
+	- else it waits until the combiner has posted its result (or until the combiner role is free, and then it becomes the combiner itself)
+The container is touched only by the combiner, so it stays in the cache of one core for a whole batch, and the combiner role changes hands
+once per batch instead of once per operation.
+
+apply(operation) works with any container: operation is any callable taking Container&, and apply() returns whatever it returns
+(e.g. [&](std::queue<T>& q) { q.push(x); }, [](std::priority_queue<T>& q) { T top = q.top(); q.pop(); return top; },
+[&](std::unordered_map<K, V>& m) { return ++m[key]; }). If the operation throws, the exception is rethrown by apply() in the calling thread.
+The operation runs in the combiner thread: it must not depend on thread_local state, and must not call apply() on the same object.
+
+Publication slots:
+There is a fixed number of slots, each in its own cache line. Each thread gets a slot index once (round robin) and tries its own slot first.
+If there are more threads than slots, a thread which finds its slot busy takes the next free one, so the slots need not be registered
+or freed when the threads come and go.
+Slot state: free -> claimed (a thread is writing its operation) -> pending (waiting for the combiner) -> done (result posted) -> free.
+The operation lives on the stack of the waiting thread, the slot holds only a pointer to it, so apply() does not allocate.
+
+Waiting threads yield, because on an oversubscribed machine the combiner may need the core of the waiting thread.
+*/
+
+namespace mm {
+
+	namespace flatCombining_v1 {
+
+		struct FlatCombiningStats
+		{
+			FlatCombiningStats()
+				: numBatches{ 0 },
+				numOperations{ 0 }
+			{}
+
+			size_t numBatches;     //number of times a thread took the combiner role and found at least one pending operation
+			size_t numOperations;  //number of operations applied, numOperations / numBatches is the average batch size
+		};
+
+		template<typename Container>
+		class FlatCombining
+		{
+		public:
+			template<typename... Args>
+			explicit FlatCombining(unsigned int numSlots, Args&&... args)
+				: numSlots_{ numSlots > 0 ? numSlots : 1 },
+				slots_{ new Slot[numSlots_] },
+				combinerActive_{ false },
+				numBatches_{ 0 },
+				numOperations_{ 0 },
+				container_(std::forward<Args>(args)...)
+			{
+			}
+
+			FlatCombining()
+				: FlatCombining(defaultNumSlots)
+			{
+			}
+
+			FlatCombining(const FlatCombining&) = delete;
+			FlatCombining& operator=(const FlatCombining&) = delete;
+
+			//Returns the result by value, even if the operation returns a reference (the container may change as soon as the batch is over)
+			template<typename Operation>
+			auto apply(Operation&& operation) -> typename std::decay<decltype(operation(std::declval<Container&>()))>::type
+			{
+				using ResultType = typename std::decay<decltype(operation(std::declval<Container&>()))>::type;
+				Request<typename std::remove_reference<Operation>::type, ResultType> request{ operation };
+				Slot& slot = publish(&request);
+				waitUntilDone(slot);
+				if (request.error)
+					std::rethrow_exception(request.error);
+				return request.getResult();
+			}
+
+			//Only for use while no other thread calls apply() (e.g. to fill the container before starting the threads, or to check it after joining them)
+			Container& getUnsafe()
+			{
+				return container_;
+			}
+
+			FlatCombiningStats getStats() const
+			{
+				FlatCombiningStats stats;
+				stats.numBatches = numBatches_.load(std::memory_order_relaxed);
+				stats.numOperations = numOperations_.load(std::memory_order_relaxed);
+				return stats;
+			}
+
+		private:
+			enum : unsigned int { defaultNumSlots = 64 };
+			enum : int { maxCombinePasses = 4 };   //the combiner scans the slots again while it finds new operations, but at most this many times
+
+			enum SlotState : int
+			{
+				slotFree,
+				slotClaimed,
+				slotPending,
+				slotDone
+			};
+
+			struct RequestBase
+			{
+				virtual void run(Container& container) = 0;
+
+				std::exception_ptr error;
+
+			protected:
+				~RequestBase() = default;
+			};
+
+			template<typename Operation, typename ResultType>
+			struct Request : public RequestBase
+			{
+				Request(Operation& operation)
+					: operation_{ operation },
+					hasResult_{ false }
+				{}
+
+				~Request()
+				{
+					if (hasResult_)
+						reinterpret_cast<ResultType*>(&result_)->~ResultType();
+				}
+
+				void run(Container& container) override
+				{
+					new (&result_) ResultType(operation_(container));
+					hasResult_ = true;
+				}
+
+				ResultType getResult()
+				{
+					return std::move(*reinterpret_cast<ResultType*>(&result_));
+				}
+
+				Operation& operation_;
+				//The result is constructed in place by the combiner, so ResultType needs no default constructor
+				typename std::aligned_storage<sizeof(ResultType), alignof(ResultType)>::type result_;
+				bool hasResult_;
+			};
+
+			template<typename Operation>
+			struct Request<Operation, void> : public RequestBase
+			{
+				Request(Operation& operation)
+					: operation_{ operation }
+				{}
+
+				void run(Container& container) override
+				{
+					operation_(container);
+				}
+
+				void getResult()
+				{
+				}
+
+				Operation& operation_;
+			};
+
+			struct Slot
+			{
+				Slot()
+					: state_{ slotFree },
+					request_{ nullptr }
+				{}
+
+				std::atomic<int> state_;
+				RequestBase* request_;
+				char pad[64 - sizeof(std::atomic<int>) - sizeof(RequestBase*)];
+			};
+
+			Slot& publish(RequestBase* request)
+			{
+				unsigned int index = getThreadIndex() % numSlots_;
+				while (true)
+				{
+					for (unsigned int i = 0; i < numSlots_; ++i, index = (index + 1 == numSlots_ ? 0 : index + 1))
+					{
+						Slot& slot = slots_[index];
+						int state = slotFree;
+						if (slot.state_.load(std::memory_order_relaxed) == slotFree
+							&& slot.state_.compare_exchange_strong(state, slotClaimed, std::memory_order_acquire, std::memory_order_relaxed))
+						{
+							slot.request_ = request;
+							slot.state_.store(slotPending, std::memory_order_release);
+							return slot;
+						}
+					}
+					std::this_thread::yield(); //All the slots are busy, wait until some thread takes its result
+				}
+			}
+
+			void waitUntilDone(Slot& slot)
+			{
+				while (slot.state_.load(std::memory_order_acquire) != slotDone)
+				{
+					if (!combinerActive_.load(std::memory_order_relaxed) && !combinerActive_.exchange(true, std::memory_order_acquire))
+					{
+						combine();
+						combinerActive_.store(false, std::memory_order_release);
+					}
+					else
+						std::this_thread::yield();
+				}
+				slot.request_ = nullptr;
+				slot.state_.store(slotFree, std::memory_order_release);
+			}
+
+			//Called only by the combiner
+			void combine()
+			{
+				size_t numOperations = 0;
+				for (int pass = 0; pass < maxCombinePasses; ++pass)
+				{
+					size_t numOperationsInPass = 0;
+					for (unsigned int i = 0; i < numSlots_; ++i)
+					{
+						Slot& slot = slots_[i];
+						if (slot.state_.load(std::memory_order_acquire) != slotPending)
+							continue;
+
+						RequestBase* request = slot.request_;
+						try
+						{
+							request->run(container_);
+						}
+						catch (...)
+						{
+							request->error = std::current_exception();
+						}
+						slot.state_.store(slotDone, std::memory_order_release);
+						++numOperationsInPass;
+					}
+					if (numOperationsInPass == 0)
+						break;
+					numOperations += numOperationsInPass;
+				}
+
+				if (numOperations > 0)
+				{
+					numBatches_.store(numBatches_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+					numOperations_.store(numOperations_.load(std::memory_order_relaxed) + numOperations, std::memory_order_relaxed);
+				}
+			}
+
+			static unsigned int getThreadIndex()
+			{
+				static std::atomic<unsigned int> nextThreadIndex{ 0 };
+				thread_local const unsigned int threadIndex = nextThreadIndex.fetch_add(1, std::memory_order_relaxed);
+				return threadIndex;
+			}
+
+			const unsigned int numSlots_;
+			std::unique_ptr<Slot[]> slots_;
+			char pad0[64];
+			std::atomic<bool> combinerActive_;
+			char pad1[64 - sizeof(std::atomic<bool>)];
+			//Written only by the combiner, atomic only so that getStats() can read them at any time
+			std::atomic<size_t> numBatches_;
+			std::atomic<size_t> numOperations_;
+			Container container_;
+		};
+
+	}
+
+}
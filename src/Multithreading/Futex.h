@@ -0,0 +1,96 @@
+#pragma once
+
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <atomic>
+
+/*
+Minimal futex shim: block on a 32 bit atomic word until it is woken, without a mutex and a condition variable.
+	futexWait(word, expected): blocks only if word still has the value expected (checked atomically by the kernel), until futexWake*() on the same word.
+	                           It may return spuriously, so always call it in a loop which re-checks the condition.
+	futexWaitFor(word, expected, timeout): same, gives up after timeout (returns false if timed out).
+	futexWakeOne(word) / futexWakeAll(word): wakes one / all the threads blocked on word.
+Linux: futex(2) with FUTEX_PRIVATE_FLAG (the word is not shared among processes).
+Windows: WaitOnAddress() / WakeByAddressSingle() / WakeByAddressAll() (Windows 8 and later).
+Other platforms: futexWait() only yields, so the callers degrade to yield spinning but remain correct.
+*/
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <ctime>
+#include <climits>
+#include <cerrno>
+#elif defined(_WIN32)
+#include <Windows.h>
+#undef max
+#undef min
+#pragma comment(lib, "Synchronization.lib")
+#endif
+
+namespace mm {
+
+	static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "The futex word must be a plain 32 bit word");
+
+	inline void futexWait(std::atomic<uint32_t>& word, uint32_t expected)
+	{
+#if defined(__linux__)
+		syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#elif defined(_WIN32)
+		WaitOnAddress(reinterpret_cast<volatile VOID*>(&word), &expected, sizeof(uint32_t), INFINITE);
+#else
+		if (word.load(std::memory_order_relaxed) == expected)
+			std::this_thread::yield();
+#endif
+	}
+
+	//Returns false if timeout occurs (it may also return true spuriously, same as futexWait())
+	inline bool futexWaitFor(std::atomic<uint32_t>& word, uint32_t expected, std::chrono::nanoseconds timeout)
+	{
+		if (timeout <= std::chrono::nanoseconds::zero())
+			return false;
+
+#if defined(__linux__)
+		struct timespec ts;
+		ts.tv_sec = static_cast<time_t>(timeout.count() / 1000000000);
+		ts.tv_nsec = static_cast<long>(timeout.count() % 1000000000);
+		if (syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_PRIVATE, expected, &ts, nullptr, 0) == -1 && errno == ETIMEDOUT)
+			return false;
+		return true;
+#elif defined(_WIN32)
+		const DWORD ms = static_cast<DWORD>(std::chrono::duration_cast<std::chrono::milliseconds>(timeout).count());
+		if (!WaitOnAddress(reinterpret_cast<volatile VOID*>(&word), &expected, sizeof(uint32_t), ms > 0 ? ms : 1) && GetLastError() == ERROR_TIMEOUT)
+			return false;
+		return true;
+#else
+		if (word.load(std::memory_order_relaxed) == expected)
+			std::this_thread::yield();
+		return true;
+#endif
+	}
+
+	inline void futexWakeOne(std::atomic<uint32_t>& word)
+	{
+#if defined(__linux__)
+		syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#elif defined(_WIN32)
+		WakeByAddressSingle(reinterpret_cast<PVOID>(&word));
+#else
+		(void)word;
+#endif
+	}
+
+	inline void futexWakeAll(std::atomic<uint32_t>& word)
+	{
+#if defined(__linux__)
+		syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+#elif defined(_WIN32)
+		WakeByAddressAll(reinterpret_cast<PVOID>(&word));
+#else
+		(void)word;
+#endif
+	}
+
+}
@@ -0,0 +1,270 @@
+#pragma once
+
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <memory>
+#include <functional>
+#include <cstdint>
+#include <atomic>
+using namespace std;
+
+#include "MultiProducersMultiConsumersTryResult.h"
+
+/*
+Elimination backoff layer for the lock free containers.
+Reference: Hendler, Shavit, Yerushalmi, "A Scalable Lock-free Stack Algorithm" (SPAA 2004) and
+Herlihy, Shavit, "The Art of Multiprocessor Programming", chapter 11.4 (EliminationBackoffStack).
+
+At high thread counts most of the CAS operations on the single head pointer fail. A push() followed by a pop() leaves the stack unchanged,
+so a contended pusher and a contended popper can complete each other's operation without touching the container at all:
+the pusher hands its object over to the popper through an exchanger slot.
+
+push():  container.tryPush(). If it is contended, pick a random slot, offer the object there and wait a bit (spinCount iterations)
+         for a popper. If nobody takes it, take it back and try the container again.
+pop():   container.tryPop(). If it is contended or empty, pick a random slot and wait a bit (spinCount iterations) for an offer there.
+         If there is no offer, try the container again. Returns false if timeout occurs.
+
+Adaptive slot count:
+The number of slots in use (activeSlots_a) is between 1 and maxSlots. If a thread finds its slot busy with another thread of the same kind
+(collision), the slot count grows, so that the threads spread out. If a thread times out in the slot without a partner, the slot count shrinks,
+so that pushers and poppers are more likely to meet. activeSlots_a is written only on these slow paths and only if the value changes.
+
+Container requirements: push(T&&), pop(T&, timeout), tryPush(T&&), tryPop(T&) (see MultiProducersMultiConsumersTryResult.h), size() and empty().
+MultiProducersMultiConsumersUnlimitedLockFreeStack_v1 and MultiProducersMultiConsumersUnlimitedLockFreeQueue_v2 support it.
+
+The eliminated pairs are linearizable for a stack (the push is immediately followed by the pop).
+For a FIFO queue it is NOT linearizable: an eliminated object overtakes the objects which are already in the queue.
+The reordering is bounded: an object is handed over only while the pusher waits in the slot, so at most maxSlots objects
+overtake the queue at any time. Use it with the queue only if that is acceptable (e.g. work distribution).
+
+T must be default constructible and move assignable.
+*/
+
+#define CACHE_LINE_SIZE 64
+
+namespace mm {
+
+	struct EliminationStats
+	{
+		EliminationStats()
+			: eliminations{ 0 },
+			collisions{ 0 },
+			timeouts{ 0 }
+		{}
+
+		size_t eliminations; //number of push/pop pairs which did not touch the container
+		size_t collisions;   //number of times a thread found its slot busy with another thread of the same kind
+		size_t timeouts;     //number of times a thread waited in the slot without a partner
+	};
+
+	template <typename T, template <typename> class Container>
+	class MultiProducersMultiConsumersEliminationBackoff_v1
+	{
+	private:
+		enum SlotState : int
+		{
+			empty_ = 0,   //free
+			writing_,     //a pusher is moving its object into the slot, or taking it back
+			offered_,     //the object is waiting for a popper
+			reading_,     //a popper is moving the object out of the slot
+			taken_        //the popper has taken the object, the pusher will make the slot free
+		};
+
+		struct Slot
+		{
+			Slot() : state_a{ empty_ }, value_{}, eliminations_a{ 0 }, collisions_a{ 0 }, timeouts_a{ 0 } { }
+			atomic<int> state_a;
+			T value_;
+			//The stats are counted in the slot, so that the counters do not add one more shared cache line
+			atomic<size_t> eliminations_a;
+			atomic<size_t> collisions_a;
+			atomic<size_t> timeouts_a;
+			char pad[CACHE_LINE_SIZE];
+		};
+
+	public:
+		explicit MultiProducersMultiConsumersEliminationBackoff_v1(size_t maxSlots = std::thread::hardware_concurrency() / 2, size_t spinCount = 256)
+			: maxSlots_{ maxSlots > 0 ? maxSlots : 1 },
+			spinCount_{ spinCount },
+			slots_{ new Slot[maxSlots > 0 ? maxSlots : 1] },
+			activeSlots_a{ 1 }
+		{
+		}
+
+		MultiProducersMultiConsumersEliminationBackoff_v1(const MultiProducersMultiConsumersEliminationBackoff_v1&) = delete;
+		MultiProducersMultiConsumersEliminationBackoff_v1& operator=(const MultiProducersMultiConsumersEliminationBackoff_v1&) = delete;
+
+		void push(T&& obj)
+		{
+			while (true)
+			{
+				if (container_.tryPush(std::move(obj)) == TryResult::success)
+					return;
+
+				if (offer(obj))
+					return;
+			}
+		}
+
+		//Returns false if timeout occurs
+		bool pop(T& outVal, const std::chrono::milliseconds& timeout)
+		{
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+			while (true)
+			{
+				if (container_.tryPop(outVal) == TryResult::success)
+					return true;
+
+				//Both if the container is contended and if it is empty: a contended pusher may be waiting in a slot
+				if (take(outVal))
+					return true;
+
+				std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+				const std::chrono::milliseconds duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+				if (duration >= timeout)
+					return false;
+			}
+		}
+
+		size_t size()
+		{
+			return container_.size();
+		}
+
+		bool empty()
+		{
+			return container_.empty();
+		}
+
+		EliminationStats getEliminationStats() const
+		{
+			EliminationStats stats;
+			for (size_t i = 0; i < maxSlots_; ++i)
+			{
+				stats.eliminations += slots_[i].eliminations_a.load(memory_order_relaxed);
+				stats.collisions += slots_[i].collisions_a.load(memory_order_relaxed);
+				stats.timeouts += slots_[i].timeouts_a.load(memory_order_relaxed);
+			}
+			return stats;
+		}
+
+		Container<T>& getContainer()
+		{
+			return container_;
+		}
+
+	private:
+		//Pusher side. Returns true if a popper took the object, else obj is unchanged.
+		bool offer(T& obj)
+		{
+			Slot& slot = slots_[nextRandom() % activeSlots_a.load(memory_order_relaxed)];
+
+			int expected = empty_;
+			if (!slot.state_a.compare_exchange_strong(expected, writing_, memory_order_acquire, memory_order_relaxed))
+			{
+				onCollision(slot);
+				return false;
+			}
+
+			slot.value_ = std::move(obj);
+			slot.state_a.store(offered_, memory_order_release);
+
+			for (size_t i = 0; i < spinCount_; ++i)
+			{
+				if (slot.state_a.load(memory_order_acquire) == taken_)
+				{
+					slot.state_a.store(empty_, memory_order_release);
+					return true;
+				}
+			}
+
+			//Nobody came, take the object back unless a popper has started reading it just now
+			expected = offered_;
+			if (slot.state_a.compare_exchange_strong(expected, writing_, memory_order_acquire, memory_order_acquire))
+			{
+				obj = std::move(slot.value_);
+				slot.state_a.store(empty_, memory_order_release);
+				onTimeout(slot);
+				return false;
+			}
+
+			while (slot.state_a.load(memory_order_acquire) != taken_)
+			{
+			} // the popper is moving the object out of the slot, it is very short
+			slot.state_a.store(empty_, memory_order_release);
+			return true;
+		}
+
+		//Popper side. Returns true if it took an offered object.
+		bool take(T& outVal)
+		{
+			Slot& slot = slots_[nextRandom() % activeSlots_a.load(memory_order_relaxed)];
+
+			for (size_t i = 0; i < spinCount_; ++i)
+			{
+				int state = slot.state_a.load(memory_order_relaxed);
+				if (state == offered_)
+				{
+					int expected = offered_;
+					if (slot.state_a.compare_exchange_strong(expected, reading_, memory_order_acquire, memory_order_relaxed))
+					{
+						outVal = std::move(slot.value_);
+						slot.eliminations_a.store(slot.eliminations_a.load(memory_order_relaxed) + 1, memory_order_relaxed); //only this thread writes it now
+						slot.state_a.store(taken_, memory_order_release);
+						return true;
+					}
+					onCollision(slot); //another popper took it
+					return false;
+				}
+				else if (state != empty_ && state != writing_)
+				{
+					onCollision(slot); //another popper is in this slot
+					return false;
+				}
+			}
+
+			onTimeout(slot);
+			return false;
+		}
+
+		void onCollision(Slot& slot)
+		{
+			slot.collisions_a.fetch_add(1, memory_order_relaxed);
+			size_t active = activeSlots_a.load(memory_order_relaxed);
+			if (active < maxSlots_)
+				activeSlots_a.compare_exchange_strong(active, active + 1, memory_order_relaxed);
+		}
+
+		void onTimeout(Slot& slot)
+		{
+			slot.timeouts_a.fetch_add(1, memory_order_relaxed);
+			size_t active = activeSlots_a.load(memory_order_relaxed);
+			if (active > 1)
+				activeSlots_a.compare_exchange_strong(active, active - 1, memory_order_relaxed);
+		}
+
+		//xorshift, per thread
+		static uint32_t nextRandom()
+		{
+			thread_local uint32_t state = static_cast<uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id())) | 1;
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			return state;
+		}
+
+		Container<T> container_;
+
+		const size_t maxSlots_;
+		const size_t spinCount_;
+		unique_ptr<Slot[]> slots_;
+
+		char pad0[CACHE_LINE_SIZE];
+
+		// read by every elimination attempt, written only if the value changes
+		atomic<size_t> activeSlots_a;
+		char pad1[CACHE_LINE_SIZE - sizeof(atomic<size_t>)];
+	};
+}
@@ -9,6 +9,8 @@
 #include <cmath>
 using namespace std;
 
+#include "EventCount.h"
+
 //#include "Multithreading\Multithreading_SingleProducerMultipleConsumers_v1.h"
 #include "MM_UnitTestFramework/MM_UnitTestFramework.h"
 
@@ -41,9 +43,12 @@ namespace mm {
 			//while(size_ == maxSize_)
 			while (head_ - tail_ == maxSize_)
 			{
-				//cvProducers_.wait(mlock);
-				if(cvProducers_.wait_for(mlock, timeout) == std::cv_status::timeout)
+				//Register as waiter before releasing the mutex, so that the thread which changes the state next sees it
+				EventCount::Key key = notFull_.prepareWait();
+				mlock.unlock();
+				if (!notFull_.commitWait(key, timeout))
 					return false;
+				mlock.lock();
 			}
 			vec_[head_ % maxSize_] = std::move(obj);
 			++head_;
@@ -51,7 +56,7 @@ namespace mm {
 			//cout << "\nThread " << this_thread::get_id() << " pushed " << obj << " into queue. Queue size: " << size_;
 			mlock.unlock(); //release the lock on mutex, so that the notified thread can acquire that mutex immediately when awakened,
 							//Otherwise waiting thread may try to acquire mutex before this thread releases it.
-			cvConsumers_.notify_one();
+			notEmpty_.notify(); //Does not signal anybody if no consumer is waiting
 			return true;
 		}
 
@@ -62,9 +67,12 @@ namespace mm {
 			//while (size_ == 0)
 			while (head_ == tail_)
 			{
-				//cvConsumers_.wait(mlock);
-				if (cvConsumers_.wait_for(mlock, timeout) == std::cv_status::timeout)
+				//Register as waiter before releasing the mutex, so that the thread which changes the state next sees it
+				EventCount::Key key = notEmpty_.prepareWait();
+				mlock.unlock();
+				if (!notEmpty_.commitWait(key, timeout))
 					return false;
+				mlock.lock();
 			}
 			//OR
 			//cond_.wait(mlock, [this](){ return this->size_ != 0; });
@@ -80,7 +88,7 @@ namespace mm {
 			//cout << "\nThread " << this_thread::get_id() << " popped " << obj << " from queue. Queue size: " << size_;
 
 			mlock.unlock();
-			cvProducers_.notify_one();
+			notFull_.notify(); //Does not signal anybody if no producer is waiting
 			return true;
 		}
 
@@ -92,6 +100,12 @@ namespace mm {
 			return head_ - tail_;
 		}
 
+		//Sum of both the EventCounts
+		EventCountStats getEventCountStats() const
+		{
+			return notFull_.getStats() + notEmpty_.getStats();
+		}
+
 		bool empty()
 		{
 			std::unique_lock<std::mutex> mlock(mutex_);
@@ -107,8 +121,8 @@ namespace mm {
 		size_t head_; //stores the index where next element will be pushed
 		size_t tail_; //stores the index of object which will be popped
 		std::mutex mutex_;
-		std::condition_variable cvProducers_;
-		std::condition_variable cvConsumers_;
+		EventCount notFull_;
+		EventCount notEmpty_;
 	};
 	
 }
\ No newline at end of file
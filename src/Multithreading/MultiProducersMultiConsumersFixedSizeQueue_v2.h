@@ -9,6 +9,8 @@
 #include <cmath>
 using namespace std;
 
+#include "EventCount.h"
+
 //#include "Multithreading\Multithreading_SingleProducerMultipleConsumers_v1.h"
 #include "MM_UnitTestFramework/MM_UnitTestFramework.h"
 
@@ -41,9 +43,12 @@ namespace mm {
 
 			while (nonAtomicSize_ == maxSize_)
 			{
-				//cvProducers_.wait(c_lock);
-				if (cvProducers_.wait_for(p_lock, timeout) == std::cv_status::timeout)
+				//Register as waiter before releasing the mutex, so that the thread which changes the state next sees it
+				EventCount::Key key = notFull_.prepareWait();
+				p_lock.unlock();
+				if (!notFull_.commitWait(key, timeout))
 					return false;
+				p_lock.lock();
 			}
 
 			vec_[head_] = std::move(obj);
@@ -53,7 +58,7 @@ namespace mm {
 			//cout << "\nThread " << this_thread::get_id() << " pushed " << obj << " into queue. Queue size: " << size_;
 			p_lock.unlock(); //release the lock on mutex, so that the notified thread can acquire that mutex immediately when awakened,
 							//Otherwise waiting thread may try to acquire mutex before this thread releases it.
-			cvConsumers_.notify_one();
+			notEmpty_.notify(); //Does not signal anybody if no consumer is waiting
 			return true;
 		}
 
@@ -65,9 +70,12 @@ namespace mm {
 				std::unique_lock<std::mutex> p_lock(mutexProducer_);
 				while (nonAtomicSize_ == 0)
 				{
-					//cvConsumers_.wait(mlock);
-					if (cvConsumers_.wait_for(p_lock, timeout) == std::cv_status::timeout)
+					//Register as waiter before releasing the mutex, so that the thread which changes the state next sees it
+					EventCount::Key key = notEmpty_.prepareWait();
+					p_lock.unlock();
+					if (!notEmpty_.commitWait(key, timeout))
 						return false;
+					p_lock.lock();
 				}
 			}
 			//OR
@@ -85,7 +93,7 @@ namespace mm {
 				--nonAtomicSize_;
 			}
 			c_lock.unlock();
-			cvProducers_.notify_one();
+			notFull_.notify(); //Does not signal anybody if no producer is waiting
 			return true;
 		}
 
@@ -96,6 +104,12 @@ namespace mm {
 			return nonAtomicSize_;
 		}
 
+		//Sum of both the EventCounts
+		EventCountStats getEventCountStats() const
+		{
+			return notFull_.getStats() + notEmpty_.getStats();
+		}
+
 		bool empty()
 		{
 			std::unique_lock<std::mutex> p_lock(mutexProducer_);
@@ -112,8 +126,8 @@ namespace mm {
 		size_t tail_; //stores the index of object which will be popped
 		std::mutex mutexProducer_;
 		std::mutex mutexConsumer_;
-		std::condition_variable cvProducers_;
-		std::condition_variable cvConsumers_;
+		EventCount notFull_;
+		EventCount notEmpty_;
 	};
 	
 }
\ No newline at end of file
@@ -9,6 +9,8 @@
 #include <cmath>
 using namespace std;
 
+#include "EventCount.h"
+
 //#include "Multithreading\Multithreading_SingleProducerMultipleConsumers_v1.h"
 #include "MM_UnitTestFramework/MM_UnitTestFramework.h"
 
@@ -41,9 +43,17 @@ namespace mm {
 
 			while (size_a.load() == maxSize_)
 			{
-				//cvProducers_.wait(c_lock);
-				if (cvProducers_.wait_for(p_lock, timeout) == std::cv_status::timeout)
+				//Consumers decrement size_a without mutexProducer_, so check it again after registering as waiter (see EventCount.h)
+				EventCount::Key key = notFull_.prepareWait();
+				if (size_a.load() != maxSize_)
+				{
+					notFull_.cancelWait();
+					break;
+				}
+				p_lock.unlock();
+				if (!notFull_.commitWait(key, timeout))
 					return false;
+				p_lock.lock();
 			}
 
 			vec_[head_] = std::move(obj);
@@ -53,7 +63,7 @@ namespace mm {
 			//cout << "\nThread " << this_thread::get_id() << " pushed " << obj << " into queue. Queue size: " << size_;
 			p_lock.unlock(); //release the lock on mutex, so that the notified thread can acquire that mutex immediately when awakened,
 							//Otherwise waiting thread may try to acquire mutex before this thread releases it.
-			cvConsumers_.notify_one();
+			notEmpty_.notify(); //Does not signal anybody if no consumer is waiting
 			return true;
 		}
 
@@ -67,9 +77,12 @@ namespace mm {
 				std::unique_lock<std::mutex> p_lock(mutexProducer_);
 				while (size_a.load() == 0)
 				{
-					//cvConsumers_.wait(mlock);
-					if (cvConsumers_.wait_for(p_lock, timeout) == std::cv_status::timeout)
+					//Register as waiter before releasing the mutex, so that the thread which changes the state next sees it
+					EventCount::Key key = notEmpty_.prepareWait();
+					p_lock.unlock();
+					if (!notEmpty_.commitWait(key, timeout))
 						return false;
+					p_lock.lock();
 				}
 			}
 			//OR
@@ -81,19 +94,12 @@ namespace mm {
 				tail_ %= maxSize_;
 			
 			//cout << "\nThread " << this_thread::get_id() << " popped " << obj << " from queue. Queue size: " << size_;
-			if (size_a.load() == maxSize_)
-			{
-				//Take a lock even though its atomic variable, so that you decrement it after the producer thread "unlocks mutexProducer_ and goes to wait" atomically
-				//There will be a race if producer thread checks size_a.load() == maxSize_ and goes into while loop, then consumer does --size_a and  cvProducers_.notify_one(), 
-				// and then producer goes into wait state....producer will miss the notification
-				std::unique_lock<std::mutex> p_lock(mutexProducer_); 
-				--size_a;
-			}
-			else
-				--size_a;
+			//No need to take mutexProducer_ here (like it was needed with condition variable) to avoid the missed notification,
+			//because the producer registers as waiter in notFull_ before it checks size_a again
+			--size_a;
 
 			c_lock.unlock();
-			cvProducers_.notify_one();
+			notFull_.notify(); //Does not signal anybody if no producer is waiting
 			return true;
 		}
 
@@ -104,6 +110,12 @@ namespace mm {
 			return size_a.load();
 		}
 
+		//Sum of both the EventCounts
+		EventCountStats getEventCountStats() const
+		{
+			return notFull_.getStats() + notEmpty_.getStats();
+		}
+
 		bool empty()
 		{
 			//std::unique_lock<std::mutex> p_lock(mutexProducer_);
@@ -120,8 +132,8 @@ namespace mm {
 		size_t tail_; //stores the index of object which will be popped
 		std::mutex mutexProducer_;
 		std::mutex mutexConsumer_;
-		std::condition_variable cvProducers_;
-		std::condition_variable cvConsumers_;
+		EventCount notFull_;
+		EventCount notEmpty_;
 	};
 	
 }
\ No newline at end of file
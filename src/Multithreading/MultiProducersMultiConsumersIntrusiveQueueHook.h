@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <type_traits>
+using namespace std;
+
+/*
+The hook embedded in every object which is pushed into an intrusive queue.
+The intrusive queues do not allocate any node. They link the objects themselves using this hook,
+the same way Node::next_a links the nodes inside the other queues.
+
+Usage:
+	class Message : public IntrusiveQueueHook { ... };
+	MultiProducersMultiConsumersUnlimitedIntrusiveQueue_v1<Message> queue;
+	queue.push(pMessage);
+
+Ownership rules:
+1. push(T* obj) lends the object to the queue. The caller must not touch (or delete) the object until it is popped again.
+2. pop(T*& outVal, ...) returns the object to the caller, who owns it again and may push it into any queue.
+3. The object can be in only one intrusive queue at a time. Pushing an object which is already in a queue corrupts that queue.
+4. The queue never deletes the objects. The objects which are still in the queue when the queue is destroyed are simply forgotten,
+   so pop all the objects before destroying the queue if the objects need to be released.
+*/
+
+namespace mm {
+
+	struct IntrusiveQueueHook
+	{
+		IntrusiveQueueHook() : next_a{ nullptr } { }
+		IntrusiveQueueHook(const IntrusiveQueueHook&) : next_a{ nullptr } { } //The link belongs to the queue, never copy it
+		IntrusiveQueueHook& operator=(const IntrusiveQueueHook&) { return *this; }
+
+		atomic<IntrusiveQueueHook*> next_a;
+	};
+
+	template<typename T>
+	struct is_intrusive_queue_object
+	{
+		static const bool value = std::is_base_of<IntrusiveQueueHook, T>::value;
+	};
+}
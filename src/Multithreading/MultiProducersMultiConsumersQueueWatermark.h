@@ -0,0 +1,158 @@
+#pragma once
+
+#include <iostream>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <atomic>
+#include <functional>
+#include <limits>
+using namespace std;
+
+/*
+Optional high/low watermarks (backpressure) for the unlimited queues.
+
+The unlimited queues never block producers, so if the consumers stall, the queue keeps growing until the process runs out of memory.
+With watermarks, the queue becomes "throttled" when its size reaches highWatermark and stays throttled until the size drops to lowWatermark.
+While the queue is throttled, push() behaves as per the policy:
+	block    - wait until the queue is not throttled anymore (or until timeout, then push() returns false)
+	fail     - return false immediately
+	callback - call onHighWatermark(approximateSize). If it returns true the object is pushed anyway, else push() returns false.
+	none     - always push. The watermarks are used only to track the size (see approximateSize())
+
+The size is an approximate counter (one atomic increment per push and one atomic decrement per pop),
+not the O(n) list walk which some queues use in size(). It can be slightly off while pushes and pops are in progress.
+If highWatermark is not set, the queue does not maintain the counter at all, so there is no overhead.
+*/
+
+namespace mm {
+
+	enum class QueueWatermarkPolicy
+	{
+		none,
+		block,
+		fail,
+		callback
+	};
+
+	struct QueueWatermarkConfig
+	{
+		QueueWatermarkConfig()
+			: highWatermark{ std::numeric_limits<size_t>::max() },
+			lowWatermark{ std::numeric_limits<size_t>::max() },
+			policy{ QueueWatermarkPolicy::none }
+		{}
+
+		QueueWatermarkConfig(size_t high, size_t low, QueueWatermarkPolicy pol, std::function<bool(size_t)> callback = nullptr)
+			: highWatermark{ high },
+			lowWatermark{ low < high ? low : high },
+			policy{ pol },
+			onHighWatermark{ std::move(callback) }
+		{}
+
+		size_t highWatermark;
+		size_t lowWatermark;
+		QueueWatermarkPolicy policy;
+		std::function<bool(size_t)> onHighWatermark; //Used only by QueueWatermarkPolicy::callback
+	};
+
+	class QueueWatermark
+	{
+	public:
+		QueueWatermark(const QueueWatermarkConfig& config)
+			: config_{ config },
+			enabled_{ config.highWatermark != std::numeric_limits<size_t>::max() },
+			size_a{ 0 },
+			throttled_a{ false }
+		{}
+
+		//Call it before pushing the object. Returns false if the object should not be pushed.
+		//The object is counted here (not after it is pushed), so the counter never goes below zero when a consumer pops it very quickly.
+		bool beforePush(const std::chrono::milliseconds& timeout)
+		{
+			if (!enabled_)
+				return true;
+
+			if (throttled_a.load(memory_order_seq_cst) && !canPushWhenThrottled(timeout))
+				return false;
+
+			size_t newSize = size_a.fetch_add(1, memory_order_seq_cst) + 1;
+			if (newSize >= config_.highWatermark && !throttled_a.load(memory_order_seq_cst))
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				if (!throttled_a.load(memory_order_seq_cst) && size_a.load(memory_order_seq_cst) >= config_.highWatermark)
+				{
+					throttled_a.store(true, memory_order_seq_cst);
+					//The consumers may have drained the queue after the above check and before they could see the flag. Check again.
+					if (size_a.load(memory_order_seq_cst) <= config_.lowWatermark)
+						resume();
+				}
+			}
+
+			return true;
+		}
+
+		//Call it after the consumer has popped count objects
+		void afterPop(size_t count = 1)
+		{
+			if (!enabled_)
+				return;
+
+			size_t newSize = size_a.fetch_sub(count, memory_order_seq_cst) - count;
+			if (newSize <= config_.lowWatermark && throttled_a.load(memory_order_seq_cst))
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				if (throttled_a.load(memory_order_seq_cst) && size_a.load(memory_order_seq_cst) <= config_.lowWatermark)
+					resume();
+			}
+		}
+
+		//Always 0 if the watermarks are not configured (highWatermark is not set): then the counter is not maintained at all
+		size_t approximateSize() const
+		{
+			return size_a.load(memory_order_relaxed);
+		}
+
+		bool isThrottled() const
+		{
+			return throttled_a.load(memory_order_relaxed);
+		}
+
+	private:
+		bool canPushWhenThrottled(const std::chrono::milliseconds& timeout)
+		{
+			switch (config_.policy)
+			{
+			case QueueWatermarkPolicy::none:
+				return true;
+			case QueueWatermarkPolicy::fail:
+				return false;
+			case QueueWatermarkPolicy::callback:
+				return config_.onHighWatermark ? config_.onHighWatermark(approximateSize()) : false;
+			case QueueWatermarkPolicy::block:
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				return cv_.wait_for(lock, timeout, [this]() { return !throttled_a.load(memory_order_seq_cst); });
+			}
+			}
+
+			return true;
+		}
+
+		//Must be called under mutex_
+		void resume()
+		{
+			throttled_a.store(false, memory_order_seq_cst);
+			cv_.notify_all();
+		}
+
+		const QueueWatermarkConfig config_;
+		const bool enabled_;
+		std::mutex mutex_;
+		std::condition_variable cv_;
+
+		// shared by producers and consumers
+		atomic<size_t> size_a;
+		atomic<bool> throttled_a;
+	};
+}
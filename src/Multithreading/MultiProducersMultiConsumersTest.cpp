@@ -9,11 +9,15 @@
 #include <limits>
 #include <unordered_map>
 #include <type_traits>
+#include <atomic>
+#include <thread>
+#include <iterator>
 using namespace std;
 
 #include "MultiProducersMultiConsumersUnlimitedQueue_v1.h"
 #include "MultiProducersMultiConsumersUnlimitedQueue_v2.h"
 #include "MultiProducersMultiConsumersUnlimitedQueue_v3.h"
+#include "MultiProducersMultiConsumersUnlimitedQueue_v4.h"
 
 #include "MultiProducersMultiConsumersUnlimitedLockFreeQueue_v1.h"
 #include "MultiProducersMultiConsumersUnlimitedLockFreeQueue_v2.h"
@@ -24,6 +28,12 @@ using namespace std;
 #include "MultiProducersMultiConsumersUnlimitedLockFreeQueue_v7.h"
 #include "MultiProducersMultiConsumersUnlimitedLockFreeQueue_v8.h"
 
+#include "MultiProducersMultiConsumersUnlimitedIntrusiveQueue_v1.h"
+#include "MultiProducersMultiConsumersUnlimitedIntrusiveLockFreeQueue_v1.h"
+
+#include "MultiProducersMultiConsumersUnlimitedLockFreeStack_v1.h"
+#include "MultiProducersMultiConsumersEliminationBackoff_v1.h"
+
 #include "MultiProducersMultiConsumersFixedSizeQueue_v1.h"
 #include "MultiProducersMultiConsumersFixedSizeQueue_v2.h"
 #include "MultiProducersMultiConsumersFixedSizeQueue_v3.h"
@@ -71,6 +81,7 @@ namespace mm {
 		MPMC_U_v2_fwlist,
 		MPMC_U_v2_myfwlist,
 		MPMC_U_v3_myfwlist,
+		MPMC_U_v4_myfwlist,
 
 		MPMC_U_LF_v1,
 		MPMC_U_LF_v2,
@@ -81,6 +92,13 @@ namespace mm {
 		MPMC_U_LF_v7,
 		MPMC_U_LF_v8,
 
+		MPMC_U_IN_v1,
+		MPMC_U_IN_LF_v1,
+
+		MPMC_U_LF_STK_v1,
+		MPMC_U_LF_STK_EB_v1,
+		MPMC_U_LF_v2_EB_v1,
+
 		MPMC_FS_v1,
 		MPMC_FS_v2,
 		MPMC_FS_v3,
@@ -106,6 +124,7 @@ namespace mm {
 		"MPMC_U_v2_fwlist",
 		"MPMC_U_v2_myfwlist",
 		"MPMC_U_v3_myfwlist",
+		"MPMC_U_v4_myfwlist",
 
 		"MPMC_U_LF_v1",
 		"MPMC_U_LF_v2",
@@ -116,6 +135,13 @@ namespace mm {
 		"MPMC_U_LF_v7",
 		"MPMC_U_LF_v8",
 
+		"MPMC_U_IN_v1",
+		"MPMC_U_IN_LF_v1",
+
+		"MPMC_U_LF_STK_v1",
+		"MPMC_U_LF_STK_EB_v1",
+		"MPMC_U_LF_v2_EB_v1",
+
 		"MPMC_FS_v1",
 		"MPMC_FS_v2",
 		"MPMC_FS_v3",
@@ -171,6 +197,7 @@ namespace mm {
 	template<typename T> struct typeInfo<QueueType::MPMC_U_v2_fwlist, T> : public typeInfoImpl<true, QueueType::MPMC_U_v2_fwlist, MultiProducersMultiConsumersUnlimitedQueue_v2<T, std::forward_list>> {};
 	template<typename T> struct typeInfo<QueueType::MPMC_U_v2_myfwlist, T> : public typeInfoImpl<true, QueueType::MPMC_U_v2_myfwlist, MultiProducersMultiConsumersUnlimitedQueue_v2<T, Undefined>> {};
 	template<typename T> struct typeInfo<QueueType::MPMC_U_v3_myfwlist, T> : public typeInfoImpl<true, QueueType::MPMC_U_v3_myfwlist, MultiProducersMultiConsumersUnlimitedQueue_v3<T>> {};
+	template<typename T> struct typeInfo<QueueType::MPMC_U_v4_myfwlist, T> : public typeInfoImpl<true, QueueType::MPMC_U_v4_myfwlist, MultiProducersMultiConsumersUnlimitedQueue_v4<T>> {};
 
 	template<typename T> struct typeInfo<QueueType::MPMC_U_LF_v1, T> : public typeInfoImpl<true, QueueType::MPMC_U_LF_v1, MultiProducersMultiConsumersUnlimitedLockFreeQueue_v1<T>> {};
 	template<typename T> struct typeInfo<QueueType::MPMC_U_LF_v2, T> : public typeInfoImpl<true, QueueType::MPMC_U_LF_v2, MultiProducersMultiConsumersUnlimitedLockFreeQueue_v2<T>> {};
@@ -181,6 +208,26 @@ namespace mm {
 	template<typename T> struct typeInfo<QueueType::MPMC_U_LF_v7, T> : public typeInfoImpl<true, QueueType::MPMC_U_LF_v7, MultiProducersMultiConsumersUnlimitedLockFreeQueue_v7<T>> {};
 	template<typename T> struct typeInfo<QueueType::MPMC_U_LF_v8, T> : public typeInfoImpl<true, QueueType::MPMC_U_LF_v8, MultiProducersMultiConsumersUnlimitedLockFreeQueue_v8<T>> {};
 
+	//The intrusive queues accept only the pointers to objects derived from IntrusiveQueueHook. The type is void (i.e. test is skipped) for all other payloads.
+	template<template<typename> class Tqueue, typename T>
+	struct intrusiveQueueType
+	{
+		using type = void;
+	};
+	template<template<typename> class Tqueue, typename T>
+	struct intrusiveQueueType<Tqueue, T*>
+	{
+		using type = typename std::conditional<is_intrusive_queue_object<T>::value, Tqueue<T>, void>::type;
+	};
+	template<typename T> struct typeInfo<QueueType::MPMC_U_IN_v1, T> : public typeInfoImpl<true, QueueType::MPMC_U_IN_v1, typename intrusiveQueueType<MultiProducersMultiConsumersUnlimitedIntrusiveQueue_v1, T>::type> {};
+	template<typename T> struct typeInfo<QueueType::MPMC_U_IN_LF_v1, T> : public typeInfoImpl<true, QueueType::MPMC_U_IN_LF_v1, typename intrusiveQueueType<MultiProducersMultiConsumersUnlimitedIntrusiveLockFreeQueue_v1, T>::type> {};
+
+	//The stack is not FIFO, but it has same interface, so it is compared with the queues
+	template<typename T> struct typeInfo<QueueType::MPMC_U_LF_STK_v1, T> : public typeInfoImpl<true, QueueType::MPMC_U_LF_STK_v1, MultiProducersMultiConsumersUnlimitedLockFreeStack_v1<T>> {};
+	template<typename T> struct typeInfo<QueueType::MPMC_U_LF_STK_EB_v1, T> : public typeInfoImpl<true, QueueType::MPMC_U_LF_STK_EB_v1, MultiProducersMultiConsumersEliminationBackoff_v1<T, MultiProducersMultiConsumersUnlimitedLockFreeStack_v1>> {};
+	//Not FIFO anymore, see MultiProducersMultiConsumersEliminationBackoff_v1.h
+	template<typename T> struct typeInfo<QueueType::MPMC_U_LF_v2_EB_v1, T> : public typeInfoImpl<true, QueueType::MPMC_U_LF_v2_EB_v1, MultiProducersMultiConsumersEliminationBackoff_v1<T, MultiProducersMultiConsumersUnlimitedLockFreeQueue_v2>> {};
+
 	template<typename T> struct typeInfo<QueueType::MPMC_FS_v1, T> : public typeInfoImpl<true, QueueType::MPMC_FS_v1, MultiProducersMultiConsumersFixedSizeQueue_v1<T>> {};
 	template<typename T> struct typeInfo<QueueType::MPMC_FS_v2, T> : public typeInfoImpl<true, QueueType::MPMC_FS_v2, MultiProducersMultiConsumersFixedSizeQueue_v2<T>> {};
 	template<typename T> struct typeInfo<QueueType::MPMC_FS_v3, T> : public typeInfoImpl<true, QueueType::MPMC_FS_v3, MultiProducersMultiConsumersFixedSizeQueue_v3<T>> {};
@@ -212,13 +259,14 @@ namespace mm {
 			//supportedTypes.push_back(getObjectPointer<typeInfo<QueueType::MPMC_U_v1_deque, void>>());
 			//supportedTypes.push_back(getObjectPointer<typeInfo<QueueType::MPMC_U_v1_list, void>>());
 			//supportedTypes.push_back(getObjectPointer<typeInfo<QueueType::MPMC_U_v1_fwlist, void>>());
-			//supportedTypes.push_back(getObjectPointer<typeInfo<QueueType::MPMC_U_v2_list, void>>());
-			//supportedTypes.push_back(getObjectPointer<typeInfo<QueueType::MPMC_U_v2_fwlist, void>>());
-			//supportedTypes.push_back(getObjectPointer<typeInfo<QueueType::MPMC_U_v2_myfwlist, void>>());
+			supportedTypes.push_back(getObjectPointer<typeInfo<QueueType::MPMC_U_v2_list, void>>());
+			supportedTypes.push_back(getObjectPointer<typeInfo<QueueType::MPMC_U_v2_fwlist, void>>());
+			supportedTypes.push_back(getObjectPointer<typeInfo<QueueType::MPMC_U_v2_myfwlist, void>>());
 			//supportedTypes.push_back(getObjectPointer<typeInfo<QueueType::MPMC_U_v3_myfwlist, void>>());
+			supportedTypes.push_back(getObjectPointer<typeInfo<QueueType::MPMC_U_v4_myfwlist, void>>());
 
 			//supportedTypes.push_back(getObjectPointer<typeInfo<QueueType::MPMC_U_LF_v1, void>>());
-			//supportedTypes.push_back(getObjectPointer<typeInfo<QueueType::MPMC_U_LF_v2, void>>());
+			supportedTypes.push_back(getObjectPointer<typeInfo<QueueType::MPMC_U_LF_v2, void>>());
 			//supportedTypes.push_back(getObjectPointer<typeInfo<QueueType::MPMC_U_LF_v3, void>>()); //not working
 			//supportedTypes.push_back(getObjectPointer<typeInfo<QueueType::MPMC_U_LF_v4, void>>()); //not working
 			//supportedTypes.push_back(getObjectPointer<typeInfo<QueueType::MPMC_U_LF_v5, void>>());
@@ -226,6 +274,13 @@ namespace mm {
 			//supportedTypes.push_back(getObjectPointer<typeInfo<QueueType::MPMC_U_LF_v7, void>>());
 			//supportedTypes.push_back(getObjectPointer<typeInfo<QueueType::MPMC_U_LF_v8, void>>());
 
+			supportedTypes.push_back(getObjectPointer<typeInfo<QueueType::MPMC_U_IN_v1, void>>());
+			supportedTypes.push_back(getObjectPointer<typeInfo<QueueType::MPMC_U_IN_LF_v1, void>>());
+
+			supportedTypes.push_back(getObjectPointer<typeInfo<QueueType::MPMC_U_LF_STK_v1, void>>());
+			supportedTypes.push_back(getObjectPointer<typeInfo<QueueType::MPMC_U_LF_STK_EB_v1, void>>());
+			supportedTypes.push_back(getObjectPointer<typeInfo<QueueType::MPMC_U_LF_v2_EB_v1, void>>());
+
 			//supportedTypes.push_back(getObjectPointer<typeInfo<QueueType::MPMC_FS_v1, void>>());
 			//supportedTypes.push_back(getObjectPointer<typeInfo<QueueType::MPMC_FS_v2, void>>());
 			//supportedTypes.push_back(getObjectPointer<typeInfo<QueueType::MPMC_FS_v3, void>>());
@@ -248,6 +303,36 @@ namespace mm {
 		size_t time;
 		bool queueEmpty;
 		size_t sizeAtEnd;
+		bool hasEventCountStats;
+		EventCountStats eventCountStats;
+		bool hasEliminationStats;
+		EliminationStats eliminationStats;
+	};
+
+	//The blocking queues which wait on EventCount (see EventCount.h) report how many notifications really signalled a waiter
+	template<typename Tqueue, typename = void>
+	struct has_event_count_stats : std::false_type
+	{
+		static EventCountStats get(const Tqueue&) { return EventCountStats{}; }
+	};
+
+	template<typename Tqueue>
+	struct has_event_count_stats<Tqueue, decltype(std::declval<const Tqueue&>().getEventCountStats(), void())> : std::true_type
+	{
+		static EventCountStats get(const Tqueue& queue) { return queue.getEventCountStats(); }
+	};
+
+	//The containers wrapped in MultiProducersMultiConsumersEliminationBackoff_v1 report how many push/pop pairs were eliminated
+	template<typename Tqueue, typename = void>
+	struct has_elimination_stats : std::false_type
+	{
+		static EliminationStats get(const Tqueue&) { return EliminationStats{}; }
+	};
+
+	template<typename Tqueue>
+	struct has_elimination_stats<Tqueue, decltype(std::declval<const Tqueue&>().getEliminationStats(), void())> : std::true_type
+	{
+		static EliminationStats get(const Tqueue& queue) { return queue.getEliminationStats(); }
 	};
 
 	struct TestCase
@@ -367,12 +452,87 @@ namespace mm {
 	template<>
 	bool validateResults<Object>(const Object& obj)
 	{
-		int n = obj.getValue();
+		size_t n = static_cast<size_t>(obj.getValue());
 		const string& str = obj.getStr();
 		my_runtime_assert(n == str.length());
 		return true;
 	}
 
+	/*
+	Payload for pointer mode. The objects are created by the test (like a pool maintained by the application) before the time measurement starts,
+	and only the pointers travel through the queues. The intrusive queues link these objects using the embedded hook, without any allocation.
+	All other queues store the pointer by value in their own nodes.
+	*/
+	class IntrusiveObject : public IntrusiveQueueHook
+	{
+	public:
+		IntrusiveObject()
+			: num_{ 0 }
+		{}
+
+		void setValue(int num)
+		{
+			num_ = num;
+			str_.assign(num, '*');
+		}
+
+		int getValue() const
+		{
+			return num_;
+		}
+
+		const string& getStr() const
+		{
+			return str_;
+		}
+
+	private:
+		int num_;
+		string str_;
+	};
+
+	unique_ptr<IntrusiveObject[]> intrusiveObjectsPool;
+
+	template<>
+	bool validateResults<IntrusiveObject*>(IntrusiveObject* const& obj)
+	{
+		size_t n = static_cast<size_t>(obj->getValue());
+		const string& str = obj->getStr();
+		my_runtime_assert(n == str.length());
+		return true;
+	}
+
+	template<typename T>
+	struct QueuePayload
+	{
+		static void createPool(size_t numOperations)
+		{
+		}
+
+		static T create(int n, size_t index)
+		{
+			return T{ n };
+		}
+	};
+
+	template<>
+	struct QueuePayload<IntrusiveObject*>
+	{
+		//The producers own the objects in the pool. Producer thread i pushes the objects [i * numProdOperationsPerThread, (i + 1) * numProdOperationsPerThread)
+		//The values (and their strings) are set here, so that the producers do not allocate or write the objects inside the time measurement.
+		static void createPool(size_t numOperations)
+		{
+			intrusiveObjectsPool = make_unique<IntrusiveObject[]>(numOperations);
+			for (size_t index = 0; index < numOperations; ++index)
+				intrusiveObjectsPool[index].setValue(static_cast<int>(index % 256 + 1));
+		}
+
+		static IntrusiveObject* create(int n, size_t index)
+		{
+			return &intrusiveObjectsPool[index];
+		}
+	};
+
 	template<typename Tqueue, typename Tobj>
 	void producerThreadFunction(Tqueue& queue, size_t numProdOperationsPerThread, int threadId)
 	{
@@ -387,7 +547,7 @@ namespace mm {
 			//int n = dist(mt64);
 			//cout << "\nThread " << this_thread::get_id() << " pushing " << n << " into queue";
 			int n = i;
-			Tobj obj{ n % 256 + 1 };
+			Tobj obj = QueuePayload<Tobj>::create(n % 256 + 1, threadId * numProdOperationsPerThread + i);
 			queue.push(std::move(obj));
 		}
 	}
@@ -474,7 +634,9 @@ namespace mm {
 		//	<< " Effective Duration: " << duration - (totalSleepTimeNanos / (numProducerThreads + numConsumerThreads)) << " nanos."
 		//	<< " Total sleep time: " << totalSleepTimeNanos << " nanos." 
 		//	<< " Average sleep time per thread: " << totalSleepTimeNanos / (numProducerThreads + numConsumerThreads) << " nanos.";
-		results[resultIndex].result_[static_cast<int>(queueType)] = { queueType, duration, queue.empty(), queue.size() };
+		results[resultIndex].result_[static_cast<int>(queueType)] = { queueType, duration, queue.empty(), queue.size(),
+			has_event_count_stats<Tqueue>::value, has_event_count_stats<Tqueue>::get(queue),
+			has_elimination_stats<Tqueue>::value, has_elimination_stats<Tqueue>::get(queue) };
 		string suffix{};
 		if (!queue.empty() || queue.size() != 0)
 		{
@@ -538,7 +700,8 @@ namespace mm {
 	{
 		static void call(QueueType queueType, size_t numProducerThreads, size_t numConsumerThreads, size_t numOperations, size_t queueSize, int resultIndex)
 		{
-			//Do nothing
+			//Do nothing, just keep the columns aligned
+			cout << std::setw(colWidth) << "-";
 		}
 	};
 
@@ -567,6 +730,8 @@ namespace mm {
 		}
 		//totalSleepTimeNanos *= 1000ULL;
 
+		QueuePayload<T>::createPool(numOperations);
+
 		columnNames.clear(); //Not a good fix! Make sure the columnNames are not pushed again and again for all test cases
 
 		/***** Unlimited Queues ****/
@@ -590,6 +755,7 @@ namespace mm {
 			case QueueType::MPMC_U_v2_fwlist: callWrapper<QueueType::MPMC_U_v2_fwlist, T>(numProducerThreads, numConsumerThreads, numOperations, 0, resultIndex); break;
 			case QueueType::MPMC_U_v2_myfwlist: callWrapper<QueueType::MPMC_U_v2_myfwlist, T>(numProducerThreads, numConsumerThreads, numOperations, 0, resultIndex); break;
 			case QueueType::MPMC_U_v3_myfwlist: callWrapper<QueueType::MPMC_U_v3_myfwlist, T>(numProducerThreads, numConsumerThreads, numOperations, 0, resultIndex); break;
+			case QueueType::MPMC_U_v4_myfwlist: callWrapper<QueueType::MPMC_U_v4_myfwlist, T>(numProducerThreads, numConsumerThreads, numOperations, 0, resultIndex); break;
 
 			case QueueType::MPMC_U_LF_v1: callWrapper<QueueType::MPMC_U_LF_v1, T>(numProducerThreads, numConsumerThreads, numOperations, 0, resultIndex); break;
 			case QueueType::MPMC_U_LF_v2: callWrapper<QueueType::MPMC_U_LF_v2, T>(numProducerThreads, numConsumerThreads, numOperations, 0, resultIndex); break;
@@ -600,6 +766,13 @@ namespace mm {
 			case QueueType::MPMC_U_LF_v7: callWrapper<QueueType::MPMC_U_LF_v7, T>(numProducerThreads, numConsumerThreads, numOperations, 0, resultIndex); break;
 			case QueueType::MPMC_U_LF_v8: callWrapper<QueueType::MPMC_U_LF_v8, T>(numProducerThreads, numConsumerThreads, numOperations, 0, resultIndex); break;
 
+			case QueueType::MPMC_U_IN_v1: callWrapper<QueueType::MPMC_U_IN_v1, T>(numProducerThreads, numConsumerThreads, numOperations, 0, resultIndex); break;
+			case QueueType::MPMC_U_IN_LF_v1: callWrapper<QueueType::MPMC_U_IN_LF_v1, T>(numProducerThreads, numConsumerThreads, numOperations, 0, resultIndex); break;
+
+			case QueueType::MPMC_U_LF_STK_v1: callWrapper<QueueType::MPMC_U_LF_STK_v1, T>(numProducerThreads, numConsumerThreads, numOperations, 0, resultIndex); break;
+			case QueueType::MPMC_U_LF_STK_EB_v1: callWrapper<QueueType::MPMC_U_LF_STK_EB_v1, T>(numProducerThreads, numConsumerThreads, numOperations, 0, resultIndex); break;
+			case QueueType::MPMC_U_LF_v2_EB_v1: callWrapper<QueueType::MPMC_U_LF_v2_EB_v1, T>(numProducerThreads, numConsumerThreads, numOperations, 0, resultIndex); break;
+
 			case QueueType::MPMC_FS_v1: callWrapper<QueueType::MPMC_FS_v1, T>(numProducerThreads, numConsumerThreads, numOperations, queueSize, resultIndex); break;
 			case QueueType::MPMC_FS_v2: callWrapper<QueueType::MPMC_FS_v2, T>(numProducerThreads, numConsumerThreads, numOperations, queueSize, resultIndex); break;
 			case QueueType::MPMC_FS_v3: callWrapper<QueueType::MPMC_FS_v3, T>(numProducerThreads, numConsumerThreads, numOperations, queueSize, resultIndex); break;
@@ -618,6 +791,56 @@ namespace mm {
 		//test_mpmcu_queue_sfinae<MultiProducersMultiConsumersFixedSizeLockFreeQueue_vx<int>>(QueueType::MPMC_FS_LF_vx, numProducerThreads, numConsumerThreads, numOperations, queueSize, resultIndex);
 	}
 
+	//Prints one more table for the rows [firstResultIndex, lastResultIndex] which have at least minThreads producers.
+	//getStats returns the text for one cell, or "-" if the queue does not have such stats.
+	template<typename Func>
+	void printStatsTable(const string& title, int firstResultIndex, int lastResultIndex, int minThreads, Func getStats)
+	{
+		cout << "\n--------------- " << title << " ---------------";
+		vector<unique_ptr<typeInfoBase>>& supportedTypes = getSupportedTypes();
+		for (int index = firstResultIndex; index <= lastResultIndex; ++index)
+		{
+			const TestCase& test = results[index];
+			if (test.numProducers_ < minThreads)
+				continue;
+
+			cout << "\n"
+				<< std::setw(subCol1) << test.numProducers_
+				<< std::setw(subCol2) << test.numConsumers_
+				<< std::setw(subCol3) << test.numOperations_
+				<< std::setw(subCol4) << test.queueSize_;
+
+			for (size_t i = 0; i < supportedTypes.size(); ++i)
+			{
+				if (supportedTypes[i])
+					cout << std::setw(colWidth) << getStats(test.result_[static_cast<int>(supportedTypes[i]->getQueueType())]);
+			}
+		}
+	}
+
+	//Prints notifies/signals/wakeups of the queues which wait on EventCount, "-" for others.
+	//The queues call notify() once per push (and the fixed size queues once per pop as well), so notifies is about the number of operations,
+	//and signals much lower than notifies means most of the notifications took the fast path and did not need any syscall.
+	void printEventCountStats(int firstResultIndex, int lastResultIndex)
+	{
+		printStatsTable("EventCount notifies/signals/wakeups", firstResultIndex, lastResultIndex, 0, [](const ResultSet& result) -> string {
+			if (!result.hasEventCountStats)
+				return "-";
+			return to_string(result.eventCountStats.notifies) + "/" + to_string(result.eventCountStats.signals) + "/" + to_string(result.eventCountStats.wakeups);
+		});
+	}
+
+	//Prints eliminations/collisions of the containers wrapped in elimination backoff, "-" for others.
+	//Only for the rows with high thread count (40, 50, 60, 80, 100), where the head pointer is contended.
+	void printEliminationStats(int firstResultIndex, int lastResultIndex)
+	{
+		printStatsTable("Elimination eliminations/collisions", firstResultIndex, lastResultIndex, 40, [](const ResultSet& result) -> string {
+			if (!result.hasEliminationStats)
+				return "-";
+			return to_string(result.eliminationStats.eliminations) + "/" + to_string(result.eliminationStats.collisions);
+		});
+	}
+
 	template<typename T>
 	void runAllTestCasesPerType(int numOperations, bool useSleepLocal, int& resultIndex)
 	{
@@ -658,6 +881,9 @@ namespace mm {
 
 			runTestCase<T>(tests[i].numProducers_, tests[i].numConsumers_, tests[i].numOperations_, tests[i].queueSize_, ++resultIndex);
 		}
+
+		printEventCountStats(resultIndex - static_cast<int>(tests.size()) + 1, resultIndex);
+		printEliminationStats(resultIndex - static_cast<int>(tests.size()) + 1, resultIndex);
 	}
 
 	MM_DECLARE_FLAG(Multithreading_mpmcu_queue);
@@ -703,6 +929,248 @@ namespace mm {
 		runAllTestCasesPerType<int>(numOperations, false, resultIndex);
 		runAllTestCasesPerType<int>(numOperations / divFactor, true, resultIndex);
 		runAllTestCasesPerType<Object>(numOperations / divFactor, true, resultIndex);
+		runAllTestCasesPerType<IntrusiveObject*>(numOperations, false, resultIndex);
+	}
+
+	/*
+	consume_all()/drain() test. The producers push numOperations ints (1 to numOperations) concurrently with:
+		- consumers which call consume_all() in a loop
+		- consumers which call drain() in a loop
+		- one consumer which calls pop() with a short timeout, so that consume_all() and drain() also run while pop() waits on an empty queue
+	At the end the number and the sum of the consumed ints must match what was pushed, and the queue must be empty.
+	*/
+	template<typename Tqueue>
+	void testConsumeAll(const string& queueName, size_t numProducerThreads, size_t numConsumerThreads, size_t numOperations)
+	{
+		Tqueue queue{};
+		const size_t numProdOperationsPerThread = numOperations / numProducerThreads;
+		const size_t total = numProdOperationsPerThread * numProducerThreads;
+		std::atomic<size_t> consumedCount{ 0 };
+		std::atomic<unsigned long long> consumedSum{ 0 };
+		std::atomic<size_t> numBatches{ 0 };
+
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		vector<std::thread> threads;
+		for (size_t i = 0; i < numProducerThreads; ++i)
+		{
+			threads.push_back(std::thread([&queue, numProdOperationsPerThread, i]() {
+				for (size_t j = 0; j < numProdOperationsPerThread; ++j)
+					queue.push(static_cast<int>(i * numProdOperationsPerThread + j + 1));
+			}));
+		}
+		for (size_t i = 0; i < numConsumerThreads; ++i)
+		{
+			threads.push_back(std::thread([&, i]() {
+				vector<int> drained;
+				while (consumedCount.load() < total)
+				{
+					unsigned long long sum = 0;
+					size_t count = 0;
+					if (i % 2 == 0)
+					{
+						count = queue.consume_all([&sum](int&& n) { sum += n; });
+					}
+					else
+					{
+						drained.clear();
+						count = queue.drain(std::back_inserter(drained));
+						my_runtime_assert(count == drained.size());
+						for (int n : drained)
+							sum += n;
+					}
+
+					if (count == 0)
+					{
+						std::this_thread::yield();
+						continue;
+					}
+					++numBatches;
+					consumedSum += sum;
+					consumedCount += count;
+				}
+			}));
+		}
+		threads.push_back(std::thread([&]() {
+			while (consumedCount.load() < total)
+			{
+				int n = 0;
+				if (queue.pop(n, std::chrono::milliseconds{ 1 }))
+				{
+					consumedSum += n;
+					++consumedCount;
+				}
+			}
+		}));
+
+		for (std::thread& t : threads)
+			t.join();
+		std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+		const unsigned long long expectedSum = static_cast<unsigned long long>(total) * (total + 1) / 2;
+		const bool passed = consumedCount.load() == total && consumedSum.load() == expectedSum && queue.empty();
+		cout << "\n" << std::setw(colWidth) << queueName
+			<< std::setw(subCol1) << numProducerThreads
+			<< std::setw(subCol2) << numConsumerThreads + 1
+			<< std::setw(colWidth) << consumedCount.load() << "/" << total
+			<< std::setw(colWidth) << numBatches.load()
+			<< std::setw(colWidth) << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()
+			<< std::setw(colWidth) << (passed ? "passed" : "FAILED");
+		my_runtime_assert(passed);
+	}
+
+	template<typename Tqueue>
+	void testConsumeAllAllThreadCounts(const string& queueName, size_t numOperations)
+	{
+		testConsumeAll<Tqueue>(queueName, 1, 1, numOperations);
+		testConsumeAll<Tqueue>(queueName, 4, 2, numOperations);
+		testConsumeAll<Tqueue>(queueName, 8, 4, numOperations);
+	}
+
+	MM_DECLARE_FLAG(Multithreading_mpmcu_queue_consume_all);
+	MM_UNIT_TEST(Multithreading_mpmcu_queue_consume_all_test, Multithreading_mpmcu_queue_consume_all)
+	{
+		MM_SET_PAUSE_ON_ERROR(true);
+
+		cout << "\n\n----consume_all()/drain() with concurrent producers and one pop() consumer----"
+			<< "\n" << std::setw(colWidth) << "Queue"
+			<< std::setw(subCol1) << "Ps"
+			<< std::setw(subCol2) << "Cs"
+			<< std::setw(colWidth) << "Consumed/Pushed"
+			<< std::setw(colWidth) << "Batches"
+			<< std::setw(colWidth) << "Time (us)"
+			<< std::setw(colWidth) << "Result";
+
+		const size_t numOperations = 200000;
+		testConsumeAllAllThreadCounts<MultiProducersMultiConsumersUnlimitedQueue_v1<int>>("MPMC_U_v1_deque", numOperations);
+		testConsumeAllAllThreadCounts<MultiProducersMultiConsumersUnlimitedQueue_v1<int, std::list>>("MPMC_U_v1_list", numOperations);
+		testConsumeAllAllThreadCounts<MultiProducersMultiConsumersUnlimitedQueue_v1<int, std::forward_list>>("MPMC_U_v1_fwlist", numOperations);
+		testConsumeAllAllThreadCounts<MultiProducersMultiConsumersUnlimitedLockFreeQueue_v1<int>>("MPMC_U_LF_v1", numOperations);
+		testConsumeAllAllThreadCounts<MultiProducersMultiConsumersUnlimitedLockFreeQueue_v2<int>>("MPMC_U_LF_v2", numOperations);
+		testConsumeAllAllThreadCounts<MultiProducersMultiConsumersUnlimitedLockFreeQueue_v3<int>>("MPMC_U_LF_v3", numOperations);
+		testConsumeAllAllThreadCounts<MultiProducersMultiConsumersUnlimitedLockFreeQueue_v4<int>>("MPMC_U_LF_v4", numOperations);
+		testConsumeAllAllThreadCounts<MultiProducersMultiConsumersUnlimitedLockFreeQueue_v5<int>>("MPMC_U_LF_v5", numOperations);
+		testConsumeAllAllThreadCounts<MultiProducersMultiConsumersUnlimitedLockFreeQueue_v6<int>>("MPMC_U_LF_v6", numOperations);
+		testConsumeAllAllThreadCounts<MultiProducersMultiConsumersUnlimitedLockFreeQueue_v7<int>>("MPMC_U_LF_v7", numOperations);
+		testConsumeAllAllThreadCounts<MultiProducersMultiConsumersUnlimitedLockFreeQueue_v8<int>>("MPMC_U_LF_v8", numOperations);
+		testConsumeAllAllThreadCounts<MultiProducersMultiConsumersUnlimitedLockFreeStack_v1<int>>("MPMC_U_LF_STK_v1", numOperations);
+		cout << endl;
+	}
+
+	/*
+	Watermark test. Every policy is tested with highWatermark = 100 and lowWatermark = 50:
+		block:    one producer pushes 1000 ints before any consumer starts. It must stop at 100, a push with a short timeout must time out,
+		          and once a consumer pops everything, the producer must finish.
+		fail:     pushes 200 ints without a consumer: 100 succeed and 100 fail. After popping 60, the queue is resumed and a push succeeds again.
+		callback: pushes 200 ints without a consumer. The callback is called for each of the last 100 pushes and accepts the first 10 of them.
+	approximateSize() must follow the pushes and pops in all cases.
+	*/
+	template<typename Tqueue>
+	void testWatermark(const string& queueName)
+	{
+		const size_t high = 100;
+		const size_t low = 50;
+		const std::chrono::milliseconds shortTimeout{ 10 };
+		bool passed = true;
+
+		//block
+		size_t pushedBeforeConsumer = 0;
+		bool blockTimedOut = false;
+		{
+			Tqueue queue{ QueueWatermarkConfig{ high, low, QueueWatermarkPolicy::block } };
+			const size_t numOperations = 1000;
+			std::atomic<size_t> pushed{ 0 };
+			std::thread producer([&]() {
+				for (size_t i = 0; i < numOperations; ++i)
+				{
+					if (queue.push(static_cast<int>(i)))
+						++pushed;
+				}
+			});
+			std::this_thread::sleep_for(std::chrono::milliseconds{ 100 });
+			pushedBeforeConsumer = pushed.load();
+			passed = passed && pushedBeforeConsumer == high && queue.approximateSize() == high;
+			blockTimedOut = !queue.push(-1, shortTimeout);
+			passed = passed && blockTimedOut;
+
+			size_t popped = 0;
+			int n = 0;
+			while (popped < numOperations && queue.pop(n, std::chrono::milliseconds{ 1000 }))
+				++popped;
+			producer.join();
+			passed = passed && popped == numOperations && pushed.load() == numOperations && queue.approximateSize() == 0;
+		}
+
+		//fail
+		size_t failAccepted = 0;
+		{
+			Tqueue queue{ QueueWatermarkConfig{ high, low, QueueWatermarkPolicy::fail } };
+			for (size_t i = 0; i < 2 * high; ++i)
+			{
+				if (queue.push(static_cast<int>(i), shortTimeout))
+					++failAccepted;
+			}
+			passed = passed && failAccepted == high && queue.approximateSize() == high;
+
+			int n = 0;
+			for (int i = 0; i < 60; ++i)
+				passed = passed && queue.pop(n, shortTimeout);
+			passed = passed && queue.approximateSize() == high - 60 && queue.push(int{ 0 }, shortTimeout);
+		}
+
+		//callback
+		size_t callbackCalls = 0;
+		size_t callbackAccepted = 0;
+		{
+			const size_t numToAccept = 10;
+			Tqueue queue{ QueueWatermarkConfig{ high, low, QueueWatermarkPolicy::callback, [&](size_t size) {
+				++callbackCalls;
+				return size < high + numToAccept;
+			} } };
+			for (size_t i = 0; i < 2 * high; ++i)
+			{
+				if (queue.push(static_cast<int>(i), shortTimeout))
+					++callbackAccepted;
+			}
+			passed = passed && callbackCalls == high && callbackAccepted == high + numToAccept && queue.approximateSize() == high + numToAccept;
+		}
+
+		cout << "\n" << std::setw(colWidth) << queueName
+			<< std::setw(colWidth) << to_string(pushedBeforeConsumer) + (blockTimedOut ? "/timed out" : "/pushed")
+			<< std::setw(colWidth) << to_string(failAccepted) + "/" + to_string(2 * high - failAccepted)
+			<< std::setw(colWidth) << to_string(callbackCalls) + "/" + to_string(callbackAccepted)
+			<< std::setw(colWidth) << (passed ? "passed" : "FAILED");
+		my_runtime_assert(passed);
+	}
+
+	MM_DECLARE_FLAG(Multithreading_mpmcu_queue_watermark);
+	MM_UNIT_TEST(Multithreading_mpmcu_queue_watermark_test, Multithreading_mpmcu_queue_watermark)
+	{
+		MM_SET_PAUSE_ON_ERROR(true);
+
+		cout << "\n\n----Watermarks (high = 100, low = 50)----"
+			<< "\n" << std::setw(colWidth) << "Queue"
+			<< std::setw(colWidth) << "block: pushed"
+			<< std::setw(colWidth) << "fail: ok/failed"
+			<< std::setw(colWidth) << "callback: calls/ok"
+			<< std::setw(colWidth) << "Result";
+
+		testWatermark<MultiProducersMultiConsumersUnlimitedQueue_v1<int>>("MPMC_U_v1_deque");
+		testWatermark<MultiProducersMultiConsumersUnlimitedQueue_v1<int, std::list>>("MPMC_U_v1_list");
+		testWatermark<MultiProducersMultiConsumersUnlimitedQueue_v1<int, std::forward_list>>("MPMC_U_v1_fwlist");
+		testWatermark<MultiProducersMultiConsumersUnlimitedQueue_v2<int, std::list>>("MPMC_U_v2_list");
+		testWatermark<MultiProducersMultiConsumersUnlimitedQueue_v2<int, std::forward_list>>("MPMC_U_v2_fwlist");
+		testWatermark<MultiProducersMultiConsumersUnlimitedQueue_v2<int, Undefined>>("MPMC_U_v2_myfwlist");
+		testWatermark<MultiProducersMultiConsumersUnlimitedQueue_v3<int>>("MPMC_U_v3_myfwlist");
+		testWatermark<MultiProducersMultiConsumersUnlimitedQueue_v4<int>>("MPMC_U_v4_myfwlist");
+		testWatermark<MultiProducersMultiConsumersUnlimitedLockFreeQueue_v1<int>>("MPMC_U_LF_v1");
+		testWatermark<MultiProducersMultiConsumersUnlimitedLockFreeQueue_v2<int>>("MPMC_U_LF_v2");
+		testWatermark<MultiProducersMultiConsumersUnlimitedLockFreeQueue_v3<int>>("MPMC_U_LF_v3");
+		testWatermark<MultiProducersMultiConsumersUnlimitedLockFreeQueue_v4<int>>("MPMC_U_LF_v4");
+		testWatermark<MultiProducersMultiConsumersUnlimitedLockFreeQueue_v5<int>>("MPMC_U_LF_v5");
+		testWatermark<MultiProducersMultiConsumersUnlimitedLockFreeQueue_v6<int>>("MPMC_U_LF_v6");
+		testWatermark<MultiProducersMultiConsumersUnlimitedLockFreeQueue_v7<int>>("MPMC_U_LF_v7");
+		testWatermark<MultiProducersMultiConsumersUnlimitedLockFreeQueue_v8<int>>("MPMC_U_LF_v8");
+		cout << endl;
 	}
 
 }
@@ -0,0 +1,17 @@
+#pragma once
+
+/*
+Result of the non-blocking single attempt operations tryPush() and tryPop().
+They are used by the wrappers like MultiProducersMultiConsumersEliminationBackoff_v1, which need to know
+whether the operation failed because the container is empty or because other threads were using it at the same time.
+*/
+
+namespace mm {
+
+	enum class TryResult
+	{
+		success,
+		empty,     //tryPop() only: there was nothing to pop
+		contended  //another thread was modifying the container, the caller may retry or back off
+	};
+}
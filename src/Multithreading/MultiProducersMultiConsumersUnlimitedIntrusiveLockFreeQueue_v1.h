@@ -0,0 +1,163 @@
+#pragma once
+
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <atomic>
+using namespace std;
+
+#include "MultiProducersMultiConsumersIntrusiveQueueHook.h"
+
+/*
+This is Multi Producers Multi Consumers Unlimited Size Intrusive Lock Free Queue.
+T embeds the IntrusiveQueueHook, push() and pop() take T*. The queue never allocates, copies or moves the objects.
+See MultiProducersMultiConsumersIntrusiveQueueHook.h for ownership rules.
+
+Reference: Dmitry Vyukov's intrusive MPSC node-based queue:
+https://www.1024cores.net/home/lock-free-algorithms/queues/intrusive-mpsc-node-based-queue
+
+Producers are lock free: one exchange on tail_a and one store into the previous tail.
+Between these two steps the list is temporarily broken, consumers wait (spin) for the link in that case.
+The algorithm supports only one consumer at a time, so consumers take a spin lock consumerLock_a like MultiProducersMultiConsumersUnlimitedLockFreeQueue_v2.
+The stub hook is the dummy node. It is pushed again when the consumer pops the last object.
+Consumers have to wait (spin) if the queue is empty.
+*/
+
+#define CACHE_LINE_SIZE 64
+
+namespace mm {
+
+	template<typename T>
+	class MultiProducersMultiConsumersUnlimitedIntrusiveLockFreeQueue_v1
+	{
+		static_assert(is_intrusive_queue_object<T>::value, "T must be derived from IntrusiveQueueHook");
+
+	public:
+		MultiProducersMultiConsumersUnlimitedIntrusiveLockFreeQueue_v1()
+			: head_{ &stub_ },
+			consumerLock_a{ false },
+			tail_a{ &stub_ }
+		{
+		}
+
+		MultiProducersMultiConsumersUnlimitedIntrusiveLockFreeQueue_v1(const MultiProducersMultiConsumersUnlimitedIntrusiveLockFreeQueue_v1&) = delete;
+		MultiProducersMultiConsumersUnlimitedIntrusiveLockFreeQueue_v1& operator=(const MultiProducersMultiConsumersUnlimitedIntrusiveLockFreeQueue_v1&) = delete;
+
+		//The queue takes the ownership of obj until it is popped
+		void push(T* obj)
+		{
+			pushHook(obj);
+		}
+
+		//The caller gets the ownership of outVal. Returns false if timeout occurs.
+		bool pop(T*& outVal, const std::chrono::milliseconds& timeout)
+		{
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+			while (consumerLock_a.exchange(true, memory_order_acquire))
+			{
+				if (isTimedOut(start, timeout))
+					return false;
+				std::this_thread::yield();
+			}    // acquire exclusivity
+
+			while (true)
+			{
+				IntrusiveQueueHook* theFirst = head_;
+				IntrusiveQueueHook* theNext = theFirst->next_a.load(memory_order_acquire);
+				if (theFirst == &stub_)
+				{
+					if (theNext == nullptr)
+					{
+						//The queue is empty
+						if (isTimedOut(start, timeout))
+						{
+							consumerLock_a.store(false, memory_order_release);
+							return false;
+						}
+						std::this_thread::yield();
+						continue;
+					}
+
+					//skip the stub
+					head_ = theNext;
+					theFirst = theNext;
+					theNext = theFirst->next_a.load(memory_order_acquire);
+				}
+
+				if (theNext == nullptr)
+				{
+					//theFirst is the last object if tail_a points to it. Otherwise a producer has exchanged tail_a but not linked the object yet.
+					if (tail_a.load(memory_order_acquire) == theFirst)
+					{
+						//Push the stub behind theFirst so that theFirst can be handed out
+						pushHook(&stub_);
+					}
+					theNext = theFirst->next_a.load(memory_order_acquire);
+					if (theNext == nullptr)
+					{
+						//Wait for the producer to complete the link
+						std::this_thread::yield();
+						continue;
+					}
+				}
+
+				head_ = theNext;
+				consumerLock_a.store(false, memory_order_release);    // release exclusivity
+				outVal = static_cast<T*>(theFirst);
+				return true;
+			}
+		}
+
+		//Only valid while no producer or consumer is running (the test calls it after joining all the threads).
+		//A concurrent pop may hand the objects back to the application, which may reuse their hooks while this walk follows them.
+		size_t size()
+		{
+			size_t size = 0;
+			for (IntrusiveQueueHook* curr = head_; curr != nullptr; curr = curr->next_a.load(memory_order_acquire))
+			{
+				if (curr != &stub_)
+					++size;
+			}
+
+			return size;
+		}
+
+		//Only valid while no producer or consumer is running, like size(): head_ is owned by the consumer holding consumerLock_a.
+		bool empty()
+		{
+			return head_ == &stub_ && stub_.next_a.load(memory_order_acquire) == nullptr;
+		}
+
+	private:
+		void pushHook(IntrusiveQueueHook* hook)
+		{
+			hook->next_a.store(nullptr, memory_order_relaxed);
+			IntrusiveQueueHook* prev = tail_a.exchange(hook, memory_order_acq_rel); // serialization point for producers
+			prev->next_a.store(hook, memory_order_release); // publish to consumers
+		}
+
+		static bool isTimedOut(const std::chrono::high_resolution_clock::time_point& start, const std::chrono::milliseconds& timeout)
+		{
+			std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+			return std::chrono::duration_cast<std::chrono::milliseconds>(end - start) >= timeout;
+		}
+
+		char pad0[CACHE_LINE_SIZE];
+
+		// for one consumer at a time
+		IntrusiveQueueHook* head_;
+		char pad1[CACHE_LINE_SIZE - sizeof(IntrusiveQueueHook*)];
+
+		// shared among consumers
+		atomic<bool> consumerLock_a;
+		char pad2[CACHE_LINE_SIZE - sizeof(atomic<bool>)];
+
+		// shared among producers
+		atomic<IntrusiveQueueHook*> tail_a;
+		char pad3[CACHE_LINE_SIZE - sizeof(atomic<IntrusiveQueueHook*>)];
+
+		IntrusiveQueueHook stub_;
+		char pad4[CACHE_LINE_SIZE - sizeof(IntrusiveQueueHook)];
+	};
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <atomic>
+using namespace std;
+
+#include "EventCount.h"
+#include "MultiProducersMultiConsumersIntrusiveQueueHook.h"
+
+/*
+This is Multi Producers Multi Consumers Unlimited Size Intrusive Queue.
+It is the intrusive version of MultiProducersMultiConsumersUnlimitedQueue_v4 (two mutexes and one EventCount).
+T embeds the IntrusiveQueueHook, push() and pop() take T*. The queue never allocates, copies or moves the objects.
+See MultiProducersMultiConsumersIntrusiveQueueHook.h for ownership rules.
+
+The dummy node of v4 can not be used here, because the popped object is returned to the caller and can not remain in the queue as dummy.
+So the queue owns a stub hook which acts as dummy. When the consumer pops the last object, it links the stub behind that object
+(under mutexProducer_, because the producers link new objects behind the same tail) and the stub becomes the head again.
+Otherwise the consumers take only mutexConsumer_ and the producers take only mutexProducer_.
+*/
+
+#define CACHE_LINE_SIZE 64
+
+namespace mm {
+
+	template<typename T>
+	class MultiProducersMultiConsumersUnlimitedIntrusiveQueue_v1
+	{
+		static_assert(is_intrusive_queue_object<T>::value, "T must be derived from IntrusiveQueueHook");
+
+	public:
+		MultiProducersMultiConsumersUnlimitedIntrusiveQueue_v1()
+		{
+			head_ = tail_ = &stub_;
+		}
+
+		MultiProducersMultiConsumersUnlimitedIntrusiveQueue_v1(const MultiProducersMultiConsumersUnlimitedIntrusiveQueue_v1&) = delete;
+		MultiProducersMultiConsumersUnlimitedIntrusiveQueue_v1& operator=(const MultiProducersMultiConsumersUnlimitedIntrusiveQueue_v1&) = delete;
+
+		//The queue takes the ownership of obj until it is popped
+		void push(T* obj)
+		{
+			IntrusiveQueueHook* hook = obj;
+			hook->next_a.store(nullptr, memory_order_relaxed);
+
+			std::unique_lock<std::mutex> p_lock(mutexProducer_);
+			tail_->next_a.store(hook, memory_order_seq_cst); // publish to consumers
+			tail_ = hook;
+			p_lock.unlock();
+
+			notEmpty_.notify(); //Does not signal anybody if no consumer is waiting
+		}
+
+		//The caller gets the ownership of outVal. Returns false if timeout occurs.
+		bool pop(T*& outVal, const std::chrono::milliseconds& timeout)
+		{
+			std::unique_lock<std::mutex> c_lock(mutexConsumer_);
+
+			//head_ can change while this thread waits without mutexConsumer_, so check the stub again after every wait
+			while (head_ == &stub_ && stub_.next_a.load(memory_order_acquire) == nullptr)
+			{
+				//Register as waiter, then check again. The producer links the object before it checks for waiters.
+				EventCount::Key key = notEmpty_.prepareWait();
+				if (stub_.next_a.load(memory_order_seq_cst) != nullptr)
+				{
+					notEmpty_.cancelWait();
+					continue;
+				}
+				c_lock.unlock();
+				if (!notEmpty_.commitWait(key, timeout))
+					return false;
+				c_lock.lock();
+			}
+
+			IntrusiveQueueHook* theFirst = head_;
+			IntrusiveQueueHook* theNext = theFirst->next_a.load(memory_order_acquire);
+			if (theFirst == &stub_)
+			{
+				//skip the stub
+				theFirst = theNext;
+				theNext = theFirst->next_a.load(memory_order_acquire);
+			}
+
+			if (theNext == nullptr)
+			{
+				//theFirst may be the last object. Producers link the objects behind tail_ under mutexProducer_, so check it again under the same mutex.
+				std::unique_lock<std::mutex> p_lock(mutexProducer_);
+				theNext = theFirst->next_a.load(memory_order_acquire);
+				if (theNext == nullptr)
+				{
+					stub_.next_a.store(nullptr, memory_order_relaxed);
+					theFirst->next_a.store(&stub_, memory_order_release);
+					tail_ = &stub_;
+					theNext = &stub_;
+				}
+			}
+
+			head_ = theNext;
+			c_lock.unlock();
+
+			outVal = static_cast<T*>(theFirst);
+			return true;
+		}
+
+		size_t size()
+		{
+			//Same order as pop(): mutexConsumer_ first
+			std::unique_lock<std::mutex> c_lock(mutexConsumer_);
+			std::unique_lock<std::mutex> p_lock(mutexProducer_);
+			size_t size = 0;
+			for (IntrusiveQueueHook* curr = head_; curr != nullptr; curr = curr->next_a.load(memory_order_relaxed))
+			{
+				if (curr != &stub_)
+					++size;
+			}
+
+			return size;
+		}
+
+		EventCountStats getEventCountStats() const
+		{
+			return notEmpty_.getStats();
+		}
+
+		bool empty()
+		{
+			std::unique_lock<std::mutex> c_lock(mutexConsumer_);
+			return head_ == &stub_ && stub_.next_a.load(memory_order_acquire) == nullptr;
+		}
+
+	private:
+		char pad0[CACHE_LINE_SIZE];
+
+		// for one consumer at a time
+		IntrusiveQueueHook* head_;
+		std::mutex mutexConsumer_;
+		char pad1[CACHE_LINE_SIZE];
+
+		// for one producer at a time
+		IntrusiveQueueHook* tail_;
+		std::mutex mutexProducer_;
+		char pad2[CACHE_LINE_SIZE];
+
+		// consumers wait on it, producers notify it
+		EventCount notEmpty_;
+		char pad3[CACHE_LINE_SIZE];
+
+		IntrusiveQueueHook stub_;
+		char pad4[CACHE_LINE_SIZE - sizeof(IntrusiveQueueHook)];
+	};
+}
@@ -12,6 +12,8 @@
 #include <atomic>
 using namespace std;
 
+#include "MultiProducersMultiConsumersQueueWatermark.h"
+
 /*
 This is Multi Producers Multi Consumers Unlimited Size Lock Free Queue.
 
@@ -47,7 +49,8 @@ namespace mm {
 		};
 
 	public:
-		MultiProducersMultiConsumersUnlimitedLockFreeQueue_v1() 
+		explicit MultiProducersMultiConsumersUnlimitedLockFreeQueue_v1(const QueueWatermarkConfig& watermarkConfig = QueueWatermarkConfig{})
+			: watermark_{ watermarkConfig }
 		{
 			first_ = last_ = new Node(nullptr);
 			producerLock_a = consumerLock_a = false;
@@ -63,8 +66,11 @@ namespace mm {
 			}
 		}
 
-		void push(T&& obj)
+		bool push(T&& obj, const std::chrono::milliseconds& timeout = std::chrono::milliseconds{ 1000 * 60 * 60 }) //default timeout = 1 hr
 		{
+			if (!watermark_.beforePush(timeout))
+				return false;
+
 			Node* tmp = new Node(new T(std::move(obj)));
 			while (producerLock_a.exchange(true))
 			{
@@ -72,6 +78,8 @@ namespace mm {
 			last_->next_a = tmp;         // publish to consumers
 			last_ = tmp;             // swing last forward
 			producerLock_a = false;       // release exclusivity
+
+			return true;
 		}
 
 		//exception SAFE pop() version. TODO: Returns false if timeout occurs.
@@ -90,7 +98,10 @@ namespace mm {
 				std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
 				const std::chrono::milliseconds duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
 				if (duration >= timeout)
+				{
+					consumerLock_a = false;   // release exclusivity
 					return false;
+				}
 			} //(This line is not a part of original implementation.) Wait on consumer thread if the queue is empty
 
 			Node* theFirst = first_;
@@ -105,6 +116,7 @@ namespace mm {
 				//outVal = *val;    // now copy it back here if the availability of queue i.e. locking it for least possible time is more important than exceptional neutrality. 
 				delete val;       // clean up the value_
 				delete theFirst;      // and the old dummy
+				watermark_.afterPop();
 				return true;      // and report success
 			}
 
@@ -112,6 +124,49 @@ namespace mm {
 			//return false;                  // report queue was empty
 		}
 
+		//Pops all the elements currently in the queue and calls func(T&&) for each of them, in FIFO order.
+		//It does not wait: returns 0 if the queue is empty, or if another consumer holds consumerLock_a (e.g. a pop() waiting on the empty queue).
+		//Returns the number of elements consumed.
+		//Detaches the whole chain first_->next_a ... last_ under both spin locks, the old dummy remains as dummy. func is called outside the locks.
+		//func must not throw, otherwise the remaining elements of the batch are lost.
+		template<typename Func>
+		size_t consume_all(Func func)
+		{
+			if (consumerLock_a.exchange(true))
+				return 0;    // single attempt to acquire exclusivity
+			while (producerLock_a.exchange(true))
+			{
+			}   // last_ is modified below
+
+			Node* curr = first_->next_a;
+			first_->next_a = nullptr;
+			last_ = first_;
+			producerLock_a = false;
+			consumerLock_a = false;
+
+			size_t count = 0;
+			while (curr != nullptr)
+			{
+				Node* tmp = curr;
+				curr = curr->next_a;
+				func(std::move(*tmp->value_));
+				delete tmp->value_;
+				delete tmp;
+				++count;
+			}
+
+			if (count > 0)
+				watermark_.afterPop(count);
+			return count;
+		}
+
+		//Moves all the elements currently in the queue to out. Returns the number of elements moved.
+		template<typename OutputIt>
+		size_t drain(OutputIt out)
+		{
+			return consume_all([&out](T&& obj) { *out++ = std::move(obj); });
+		}
+
 		size_t size()
 		{
 			//TODO: Use synchronization
@@ -132,6 +187,12 @@ namespace mm {
 			return first_->next_a == nullptr;
 		}
 
+		//Maintained only if the watermarks are configured (highWatermark is set), otherwise it is always 0. Its cheaper than size() which walks the list or locks the queue.
+		size_t approximateSize() const
+		{
+			return watermark_.approximateSize();
+		}
+
 	private:
 		char pad0[CACHE_LINE_SIZE];
 
@@ -150,5 +211,7 @@ namespace mm {
 		// shared among producers
 		atomic<bool> producerLock_a;
 		char pad4[CACHE_LINE_SIZE - sizeof(atomic<bool>)];
+
+		QueueWatermark watermark_;
 	};
 }
\ No newline at end of file
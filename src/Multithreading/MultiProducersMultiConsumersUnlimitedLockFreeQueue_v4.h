@@ -13,6 +13,8 @@
 #include <chrono>
 using namespace std;
 
+#include "MultiProducersMultiConsumersQueueWatermark.h"
+
 /*
 This is Multi Producers Multi Consumers Unlimited Size Lock Free Queue.
 
@@ -61,7 +63,8 @@ namespace mm {
 		};
 
 	public:
-		MultiProducersMultiConsumersUnlimitedLockFreeQueue_v4()
+		explicit MultiProducersMultiConsumersUnlimitedLockFreeQueue_v4(const QueueWatermarkConfig& watermarkConfig = QueueWatermarkConfig{})
+			: watermark_{ watermarkConfig }
 		{
 			Node* node = new Node{};
 			first_.next_a.store(node, memory_order_release); //first_.next_a is guaranteed to be non-nullptr
@@ -78,12 +81,17 @@ namespace mm {
 			}
 		}
 
-		void push(T&& obj)
+		bool push(T&& obj, const std::chrono::milliseconds& timeout = std::chrono::milliseconds{ 1000 * 60 * 60 }) //default timeout = 1 hr
 		{
+			if (!watermark_.beforePush(timeout))
+				return false;
+
 			Node* tmp = new Node{};
 			Node* oldLast = last_a.exchange(tmp, memory_order_seq_cst);
 			oldLast->value_ = std::move(obj);
 			oldLast->next_a.store(tmp, memory_order_release);         // publish to consumers
+
+			return true;
 		}
 
 		//exception SAFE pop() version. Returns false if timeout occurs.
@@ -116,9 +124,54 @@ namespace mm {
 			outVal = std::move(theFirst->value_);
 			delete theFirst;      // This is line#1
 
+			watermark_.afterPop();
 			return true;      // and report success
 		}
 
+		//Pops all the elements currently in the queue and calls func(T&&) for each of them, in FIFO order.
+		//It does not wait if the queue is empty. Returns the number of elements consumed.
+		//Detaches the list with one CAS: moves first_.next_a from the first node to the node which last_a points to (the empty node which
+		//the next push() fills). last_a is loaded after first_.next_a, so it is never before it in the list. The consumer which succeeds the CAS
+		//owns all the nodes before that node, and no other consumer can reach them any more, so they are walked and deleted privately.
+		//A producer may have taken a node by last_a.exchange() but not yet linked it, so the walk waits for each next_a.
+		//A stale pop() may still read next_a of a node which is deleted here, same as the nodes which pop() deletes (see line#1 in pop()).
+		//func must not throw, otherwise the remaining elements of the batch are lost.
+		template<typename Func>
+		size_t consume_all(Func func)
+		{
+			Node* theFirst = first_.next_a.load(memory_order_acquire);
+			Node* theLast = nullptr;
+			do
+			{
+				theLast = last_a.load(memory_order_acquire);
+				if (theLast == theFirst)
+					return 0; // queue is empty
+
+			} while (!first_.next_a.compare_exchange_weak(theFirst, theLast, memory_order_seq_cst));
+
+			size_t count = 0;
+			while (theFirst != theLast)
+			{
+				Node* tmp = theFirst;
+				while ((theFirst = tmp->next_a.load(memory_order_acquire)) == nullptr)
+				{
+				} // the producer of tmp has not linked it yet
+				func(std::move(tmp->value_));
+				delete tmp;
+				++count;
+			}
+
+			watermark_.afterPop(count);
+			return count;
+		}
+
+		//Moves all the elements currently in the queue to out. Returns the number of elements moved.
+		template<typename OutputIt>
+		size_t drain(OutputIt out)
+		{
+			return consume_all([&out](T&& obj) { *out++ = std::move(obj); });
+		}
+
 		size_t size()
 		{
 			//TODO: Use synchronization
@@ -138,6 +191,12 @@ namespace mm {
 			return first_.next_a.load()->next_a == nullptr;
 		}
 
+		//Maintained only if the watermarks are configured (highWatermark is set), otherwise it is always 0. Its cheaper than size() which walks the list or locks the queue.
+		size_t approximateSize() const
+		{
+			return watermark_.approximateSize();
+		}
+
 	private:
 		char pad0[CACHE_LINE_SIZE];
 
@@ -157,5 +216,7 @@ namespace mm {
 		// shared among producers
 		//atomic<Node*> tailUnused_a;
 		//char pad4[CACHE_LINE_SIZE - sizeof(atomic<Node*>)];
+
+		QueueWatermark watermark_;
 	};
 }
\ No newline at end of file
@@ -13,6 +13,8 @@
 #include <chrono>
 using namespace std;
 
+#include "MultiProducersMultiConsumersQueueWatermark.h"
+
 /*
 This is Multi Producers Multi Consumers Unlimited Size Lock Free Queue.
 
@@ -64,7 +66,8 @@ namespace mm {
 		};
 
 	public:
-		MultiProducersMultiConsumersUnlimitedLockFreeQueue_v5()
+		explicit MultiProducersMultiConsumersUnlimitedLockFreeQueue_v5(const QueueWatermarkConfig& watermarkConfig = QueueWatermarkConfig{})
+			: watermark_{ watermarkConfig }
 		{
 			first_a = last_a = new Node{};
 		}
@@ -79,12 +82,17 @@ namespace mm {
 			}
 		}
 
-		void push(T&& obj)
+		bool push(T&& obj, const std::chrono::milliseconds& timeout = std::chrono::milliseconds{ 1000 * 60 * 60 }) //default timeout = 1 hr
 		{
+			if (!watermark_.beforePush(timeout))
+				return false;
+
 			Node* tmp = new Node{};
 			Node* oldLast = last_a.exchange(tmp, memory_order_seq_cst);
 			oldLast->value_ = std::move(obj);
 			oldLast->next_a.store(tmp, memory_order_seq_cst);         // publish to consumers
+
+			return true;
 		}
 
 		//exception SAFE pop() version. Returns false if timeout occurs.
@@ -113,7 +121,10 @@ namespace mm {
 				std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
 				const std::chrono::milliseconds duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
 				if (duration >= timeout)
+				{
+					first_a.store(theFirst, memory_order_seq_cst); //Release the ownership of the first node, otherwise no consumer can ever pop again
 					return false;
+				}
 
 				//theFirst = first_a.load(memory_order_seq_cst);
 				//theNext = theFirst->next_a; //theFirst can be deleted by another consumer thread at line#2 below
@@ -132,9 +143,51 @@ namespace mm {
 			outVal = std::move(theFirst->value_);
 			delete theFirst;      // This is line#2
 
+			watermark_.afterPop();
 			return true;      // and report success
 		}
 
+		//Pops all the elements currently in the queue and calls func(T&&) for each of them, in FIFO order.
+		//It does not wait if the queue is empty. Returns the number of elements consumed, or 0 if another consumer owns the first node.
+		//Takes the ownership of the first node by exchange (same as pop()), and then releases the ownership of the node which last_a
+		//points to (the empty node which the next push() fills) instead of the second node. Both are O(1), the nodes in between belong to
+		//this consumer and are walked and deleted after other consumers are allowed to proceed.
+		//A producer may have taken a node by last_a.exchange() but not yet linked it, so the walk waits for each next_a.
+		//func must not throw, otherwise the remaining elements of the batch are lost.
+		template<typename Func>
+		size_t consume_all(Func func)
+		{
+			Node* theFirst = first_a.exchange(nullptr, memory_order_seq_cst);
+			if (theFirst == nullptr)
+				return 0; // another consumer owns the first node, do not wait for it: pop() may hold it until its timeout
+
+			Node* theLast = last_a.load(memory_order_seq_cst);
+			first_a.store(theLast, memory_order_seq_cst); //Allow other consumers to proceed
+
+			size_t count = 0;
+			while (theFirst != theLast)
+			{
+				Node* tmp = theFirst;
+				while ((theFirst = tmp->next_a.load(memory_order_acquire)) == nullptr)
+				{
+				} // the producer of tmp has not linked it yet
+				func(std::move(tmp->value_));
+				delete tmp;
+				++count;
+			}
+
+			if (count > 0)
+				watermark_.afterPop(count);
+			return count;
+		}
+
+		//Moves all the elements currently in the queue to out. Returns the number of elements moved.
+		template<typename OutputIt>
+		size_t drain(OutputIt out)
+		{
+			return consume_all([&out](T&& obj) { *out++ = std::move(obj); });
+		}
+
 		size_t size()
 		{
 			//TODO: Use synchronization
@@ -154,6 +207,12 @@ namespace mm {
 			return first_a.load()->next_a == nullptr;
 		}
 
+		//Maintained only if the watermarks are configured (highWatermark is set), otherwise it is always 0. Its cheaper than size() which walks the list or locks the queue.
+		size_t approximateSize() const
+		{
+			return watermark_.approximateSize();
+		}
+
 	private:
 		char pad0[CACHE_LINE_SIZE];
 
@@ -172,5 +231,7 @@ namespace mm {
 		// shared among producers
 		//atomic<bool> producerLock_a;
 		//char pad4[CACHE_LINE_SIZE - sizeof(atomic<bool>)];
+
+		QueueWatermark watermark_;
 	};
 }
\ No newline at end of file
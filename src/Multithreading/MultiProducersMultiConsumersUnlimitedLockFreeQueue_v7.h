@@ -13,6 +13,8 @@
 #include <chrono>
 using namespace std;
 
+#include "MultiProducersMultiConsumersQueueWatermark.h"
+
 /*
 This is Multi Producers Multi Consumers Unlimited Size Lock Free Queue.
 
@@ -73,10 +75,11 @@ namespace mm {
 		};
 
 	public:
-		MultiProducersMultiConsumersUnlimitedLockFreeQueue_v7()
+		explicit MultiProducersMultiConsumersUnlimitedLockFreeQueue_v7(const QueueWatermarkConfig& watermarkConfig = QueueWatermarkConfig{})
 			: 
 			//size_a{ 0 },
-			queueHasOneElementAndPushOrPopInProgress_a{ false }
+			queueHasOneElementAndPushOrPopInProgress_a{ false },
+			watermark_{ watermarkConfig }
 		{
 			first_a = last_a = nullptr;
 		}
@@ -91,8 +94,11 @@ namespace mm {
 			}
 		}
 
-		void push(T&& obj)
+		bool push(T&& obj, const std::chrono::milliseconds& timeout = std::chrono::milliseconds{ 1000 * 60 * 60 }) //default timeout = 1 hr
 		{
+			if (!watermark_.beforePush(timeout))
+				return false;
+
 			Node* tmp = new Node{ std::move(obj) };
 
 			//When queue has just one element, allow only one producer or only one consumer
@@ -119,6 +125,8 @@ namespace mm {
 
 			//if (holdLock)
 				queueHasOneElementAndPushOrPopInProgress_a.store(false, memory_order_seq_cst);
+
+			return true;
 		}
 
 		//exception SAFE pop() version. Returns false if timeout occurs.
@@ -163,9 +171,50 @@ namespace mm {
 			if (holdLock)
 				queueHasOneElementAndPushOrPopInProgress_a.store(false, memory_order_seq_cst);
 
+			watermark_.afterPop();
 			return true;
 		}
 
+		//Pops all the elements currently in the queue and calls func(T&&) for each of them, in FIFO order.
+		//It does not wait if the queue is empty. Returns the number of elements consumed.
+		//Detaches the whole list with one exchange of first_a and last_a under the same flag which push() and pop() use.
+		//Every push() links its node before it releases that flag, so the detached list is complete. func is called after the flag is released.
+		//func must not throw, otherwise the remaining elements of the batch are lost.
+		template<typename Func>
+		size_t consume_all(Func func)
+		{
+			while (queueHasOneElementAndPushOrPopInProgress_a.exchange(true))
+			{
+			}
+
+			Node* curr = first_a.exchange(nullptr, memory_order_seq_cst);
+			if (curr != nullptr)
+				last_a.store(nullptr, memory_order_seq_cst);
+
+			queueHasOneElementAndPushOrPopInProgress_a.store(false, memory_order_seq_cst);
+
+			size_t count = 0;
+			while (curr != nullptr)
+			{
+				Node* tmp = curr;
+				curr = curr->next_a.load(memory_order_seq_cst);
+				func(std::move(tmp->value_));
+				delete tmp;
+				++count;
+			}
+
+			if (count > 0)
+				watermark_.afterPop(count);
+			return count;
+		}
+
+		//Moves all the elements currently in the queue to out. Returns the number of elements moved.
+		template<typename OutputIt>
+		size_t drain(OutputIt out)
+		{
+			return consume_all([&out](T&& obj) { *out++ = std::move(obj); });
+		}
+
 		size_t size()
 		{
 			//TODO: Use synchronization
@@ -191,6 +240,12 @@ namespace mm {
 			return firstNull;
 		}
 
+		//Maintained only if the watermarks are configured (highWatermark is set), otherwise it is always 0. Its cheaper than size() which walks the list or locks the queue.
+		size_t approximateSize() const
+		{
+			return watermark_.approximateSize();
+		}
+
 	private:
 		char pad0[CACHE_LINE_SIZE];
 
@@ -211,5 +266,7 @@ namespace mm {
 
 		atomic<bool> producerLock_a;
 		char pad6[CACHE_LINE_SIZE - sizeof(atomic<bool>)];
+
+		QueueWatermark watermark_;
 	};
 }
\ No newline at end of file
@@ -13,6 +13,8 @@
 #include <chrono>
 using namespace std;
 
+#include "MultiProducersMultiConsumersQueueWatermark.h"
+
 /*
 This is Multi Producers Multi Consumers Unlimited Size Lock Free Queue.
 
@@ -86,11 +88,12 @@ namespace mm {
 		};
 
 	public:
-		MultiProducersMultiConsumersUnlimitedLockFreeQueue_v8()
+		explicit MultiProducersMultiConsumersUnlimitedLockFreeQueue_v8(const QueueWatermarkConfig& watermarkConfig = QueueWatermarkConfig{})
 			: 
 			//size_a{ 0 },
 			queueHasOneElementAndPushOrPopInProgress_a{ false },
-			consumerLock_a{ false }
+			consumerLock_a{ false },
+			watermark_{ watermarkConfig }
 		{
 			first_a = last_a = nullptr;
 		}
@@ -105,8 +108,11 @@ namespace mm {
 			}
 		}
 
-		void push(T&& obj)
+		bool push(T&& obj, const std::chrono::milliseconds& timeout = std::chrono::milliseconds{ 1000 * 60 * 60 }) //default timeout = 1 hr
 		{
+			if (!watermark_.beforePush(timeout))
+				return false;
+
 			Node* tmp = new Node{ std::move(obj) };
 
 			//When queue has just one element, allow only one producer or only one consumer
@@ -132,6 +138,8 @@ namespace mm {
 
 			if (holdLock)
 				queueHasOneElementAndPushOrPopInProgress_a.store(false, memory_order_seq_cst);
+
+			return true;
 		}
 
 		//exception SAFE pop() version. Returns false if timeout occurs.
@@ -153,7 +161,10 @@ namespace mm {
 				std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
 				const std::chrono::milliseconds duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
 				if (duration >= timeout)
+				{
+					consumerLock_a.store(false);
 					return false;
+				}
 
 				theFirst = first_a.load(memory_order_seq_cst);
 
@@ -184,7 +195,10 @@ namespace mm {
 					std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
 					const std::chrono::milliseconds duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
 					if (duration >= timeout)
+					{
+						consumerLock_a.store(false);
 						return false;
+					}
 				}
 
 				//locked = true;
@@ -219,9 +233,66 @@ namespace mm {
 
 			consumerLock_a.store(false);
 
+			watermark_.afterPop();
 			return true;
 		}
 
+		//Pops all the elements currently in the queue and calls func(T&&) for each of them, in FIFO order.
+		//It does not wait: returns 0 if the queue is empty, or if another consumer holds consumerLock_a (e.g. a pop() waiting on the empty queue).
+		//Returns the number of elements consumed.
+		//Detaches the whole list with one exchange of first_a and last_a (under consumerLock_a and the flag which push() and pop() use).
+		//A producer which exchanged last_a before that may not have linked its node yet, so wait for the links while walking up to theLast.
+		//func must not throw, otherwise the remaining elements of the batch are lost.
+		template<typename Func>
+		size_t consume_all(Func func)
+		{
+			if (consumerLock_a.exchange(true))
+				return 0;
+
+			while (queueHasOneElementAndPushOrPopInProgress_a.exchange(true))
+			{
+			}
+
+			Node* curr = first_a.load(memory_order_seq_cst);
+			Node* theLast = nullptr;
+			if (curr != nullptr)
+			{
+				first_a.store(nullptr, memory_order_seq_cst);
+				theLast = last_a.exchange(nullptr, memory_order_seq_cst);
+			}
+
+			queueHasOneElementAndPushOrPopInProgress_a.store(false, memory_order_seq_cst);
+			consumerLock_a.store(false);
+
+			size_t count = 0;
+			while (curr != nullptr)
+			{
+				Node* tmp = curr;
+				if (tmp == theLast)
+					curr = nullptr;
+				else
+				{
+					while ((curr = tmp->next_a.load(memory_order_seq_cst)) == nullptr)
+					{
+					} // the producer has not linked the next node yet
+				}
+				func(std::move(tmp->value_));
+				delete tmp;
+				++count;
+			}
+
+			if (count > 0)
+				watermark_.afterPop(count);
+			return count;
+		}
+
+		//Moves all the elements currently in the queue to out. Returns the number of elements moved.
+		template<typename OutputIt>
+		size_t drain(OutputIt out)
+		{
+			return consume_all([&out](T&& obj) { *out++ = std::move(obj); });
+		}
+
 		size_t size()
 		{
 			//TODO: Use synchronization
@@ -247,6 +318,12 @@ namespace mm {
 			return firstNull;
 		}
 
+		//Maintained only if the watermarks are configured (highWatermark is set), otherwise it is always 0. Its cheaper than size() which walks the list or locks the queue.
+		size_t approximateSize() const
+		{
+			return watermark_.approximateSize();
+		}
+
 	private:
 		char pad0[CACHE_LINE_SIZE];
 
@@ -267,5 +344,7 @@ namespace mm {
 
 		atomic<bool> producerLock_a;
 		char pad6[CACHE_LINE_SIZE - sizeof(atomic<bool>)];
+
+		QueueWatermark watermark_;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,276 @@
+#pragma once
+
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <cassert> //for assert()
+#include <cstdint>
+#include <atomic>
+using namespace std;
+
+#include "MultiProducersMultiConsumersTryResult.h"
+
+/*
+This is Multi Producers Multi Consumers Unlimited Size Lock Free Stack (LIFO).
+It is Treiber's stack (R. K. Treiber, "Systems Programming: Coping with Parallelism", IBM 1986):
+push() and pop() are one compare_exchange on the head pointer. See SingleLinkList_Atomic.cpp for the basic idea.
+
+ABA problem:
+Thread 1 reads head = A and A->next = B, and gets preempted before its CAS. Thread 2 pops A and B, and pushes A again.
+Now head = A again, so the CAS of thread 1 succeeds and sets head = B, which is not in the stack anymore.
+To avoid it, the head is a tagged pointer: the lower 48 bits are the pointer and the upper 16 bits are a counter which is
+incremented by every successful CAS. The CAS of thread 1 fails because the counter has changed, although the pointer is same.
+The user space pointers on x86-64 and ARM64 fit in 48 bits, so the tagged pointer fits in one uint64_t and the CAS is lock free
+on all 64 bit platforms. (The 128 bit pointer + counter CAS needs cmpxchg16b, which is not lock free with all compilers.)
+The counter can wrap around after 65536 operations on the head while one thread is preempted between its load and CAS, which is ignored.
+
+Memory reclamation:
+pop() reads head->next_a of a node which may be popped by another thread at the same time. So the popped nodes are never deleted,
+they are pushed to a free list (another Treiber stack of the same kind) and reused by push(). The memory of a node always remains
+a valid Node until the destructor, and a stale read of next_a is always detected by the tag of the CAS.
+So the stack does not need hazard pointers or epochs. The nodes are deleted only in the destructor.
+The stack never returns the memory to the system, the number of nodes is the maximum size which the stack ever had.
+Use the constructor argument to allocate the nodes upfront, then push() never allocates.
+
+Why stack:
+The most recently pushed object is popped first, so it is likely still in the cache of the core, which is better for free lists and work piles.
+Producers and consumers contend on the same head, unlike the queues which have separate head and tail.
+
+T must be default constructible and move assignable (same as the other queues).
+Consumers have to wait (spin) if the stack is empty.
+*/
+
+#define CACHE_LINE_SIZE 64
+
+namespace mm {
+
+	template <typename T>
+	class MultiProducersMultiConsumersUnlimitedLockFreeStack_v1
+	{
+		static_assert(sizeof(void*) == sizeof(uint64_t), "The tagged pointer needs 64 bit pointers");
+
+	private:
+		struct Node
+		{
+			Node() : value_{}, next_a{ nullptr } { }
+			T value_;
+			atomic<Node*> next_a; //atomic, because a stale pop() may read it while the node is reused by another thread
+		};
+
+		using TaggedPtr = uint64_t;
+
+	public:
+		explicit MultiProducersMultiConsumersUnlimitedLockFreeStack_v1(size_t numPreallocatedNodes = 0)
+			: head_a{ 0 },
+			freeList_a{ 0 }
+		{
+			for (size_t i = 0; i < numPreallocatedNodes; ++i)
+				pushNode(freeList_a, newNode());
+		}
+
+		~MultiProducersMultiConsumersUnlimitedLockFreeStack_v1()
+		{
+			deleteList(getPtr(head_a.load(memory_order_acquire)));
+			deleteList(getPtr(freeList_a.load(memory_order_acquire)));
+		}
+
+		MultiProducersMultiConsumersUnlimitedLockFreeStack_v1(const MultiProducersMultiConsumersUnlimitedLockFreeStack_v1&) = delete;
+		MultiProducersMultiConsumersUnlimitedLockFreeStack_v1& operator=(const MultiProducersMultiConsumersUnlimitedLockFreeStack_v1&) = delete;
+
+		void push(T&& obj)
+		{
+			Node* node = popNode(freeList_a);
+			if (node == nullptr)
+				node = newNode();
+
+			node->value_ = std::move(obj); //If the exception is thrown at this statement, the node is lost (not the stack)
+			pushNode(head_a, node);
+		}
+
+		//exception SAFE pop() version. Returns false if timeout occurs.
+		bool pop(T& outVal, const std::chrono::milliseconds& timeout)
+		{
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+			Node* node = nullptr;
+			while ((node = popNode(head_a)) == nullptr)
+			{
+				std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+				const std::chrono::milliseconds duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+				if (duration >= timeout)
+					return false;
+				std::this_thread::yield();
+			}
+
+			//The node is owned by this thread now
+			outVal = std::move(node->value_);
+			pushNode(freeList_a, node);
+			return true;
+		}
+
+		//Single attempt push(): only one CAS on the head. Returns TryResult::contended if the CAS fails.
+		//obj is moved only if it returns TryResult::success (it is moved back from the node otherwise).
+		TryResult tryPush(T&& obj)
+		{
+			Node* node = popNode(freeList_a);
+			if (node == nullptr)
+				node = newNode();
+
+			node->value_ = std::move(obj);
+			TaggedPtr oldHead = head_a.load(memory_order_relaxed);
+			node->next_a.store(getPtr(oldHead), memory_order_relaxed);
+			if (head_a.compare_exchange_strong(oldHead, makeTaggedPtr(node, oldHead), memory_order_release, memory_order_relaxed))
+				return TryResult::success;
+
+			obj = std::move(node->value_);
+			pushNode(freeList_a, node);
+			return TryResult::contended;
+		}
+
+		//Single attempt pop(): only one CAS on the head. It does not wait if the stack is empty.
+		TryResult tryPop(T& outVal)
+		{
+			TaggedPtr oldHead = head_a.load(memory_order_acquire);
+			Node* node = getPtr(oldHead);
+			if (node == nullptr)
+				return TryResult::empty;
+
+			Node* next = node->next_a.load(memory_order_relaxed);
+			if (!head_a.compare_exchange_strong(oldHead, makeTaggedPtr(next, oldHead), memory_order_acquire, memory_order_relaxed))
+				return TryResult::contended;
+
+			outVal = std::move(node->value_);
+			pushNode(freeList_a, node);
+			return TryResult::success;
+		}
+
+		//Pops all the elements currently in the stack and calls func(T&&) for each of them, in LIFO order.
+		//It does not wait if the stack is empty. Returns the number of elements consumed.
+		//Detaches the whole list with one CAS on the head, and returns all its nodes to the free list with one more CAS.
+		//func must not throw, otherwise the remaining elements of the batch are lost.
+		template<typename Func>
+		size_t consume_all(Func func)
+		{
+			TaggedPtr oldHead = head_a.load(memory_order_acquire);
+			while (getPtr(oldHead) != nullptr
+				&& !head_a.compare_exchange_weak(oldHead, makeTaggedPtr(nullptr, oldHead), memory_order_acquire, memory_order_acquire))
+			{
+			}
+
+			Node* first = getPtr(oldHead);
+			if (first == nullptr)
+				return 0;
+
+			size_t count = 0;
+			Node* last = first;
+			for (Node* curr = first; curr != nullptr; curr = curr->next_a.load(memory_order_relaxed))
+			{
+				func(std::move(curr->value_));
+				last = curr;
+				++count;
+			}
+
+			pushList(freeList_a, first, last);
+			return count;
+		}
+
+		//Moves all the elements currently in the stack to out (top first). Returns the number of elements moved.
+		template<typename OutputIt>
+		size_t drain(OutputIt out)
+		{
+			return consume_all([&out](T&& obj) { *out++ = std::move(obj); });
+		}
+
+		//Only valid while the stack is quiescent (no push or pop running, the test calls it after joining all the threads).
+		//A concurrent pop may move a node to the free list and a push may reuse it, so the walk could follow its new next_a and count garbage.
+		size_t size()
+		{
+			size_t size = 0;
+			for (Node* curr = getPtr(head_a.load(memory_order_acquire)); curr != nullptr; curr = curr->next_a.load(memory_order_relaxed))
+			{
+				++size;
+			}
+
+			return size;
+		}
+
+		bool empty()
+		{
+			return getPtr(head_a.load(memory_order_acquire)) == nullptr;
+		}
+
+	private:
+		static const int tagShift = 48;
+		static const TaggedPtr ptrMask = (TaggedPtr{ 1 } << tagShift) - 1;
+
+		static Node* getPtr(TaggedPtr tp)
+		{
+			return reinterpret_cast<Node*>(static_cast<uintptr_t>(tp & ptrMask));
+		}
+
+		//The tag of the new value is one more than the tag of the old value
+		static TaggedPtr makeTaggedPtr(Node* node, TaggedPtr old)
+		{
+			return (((old >> tagShift) + 1) << tagShift) | static_cast<TaggedPtr>(reinterpret_cast<uintptr_t>(node));
+		}
+
+		static Node* newNode()
+		{
+			Node* node = new Node{};
+			assert((static_cast<TaggedPtr>(reinterpret_cast<uintptr_t>(node)) & ~ptrMask) == 0); //The pointer must fit in 48 bits
+			return node;
+		}
+
+		static void pushNode(atomic<TaggedPtr>& head, Node* node)
+		{
+			pushList(head, node, node);
+		}
+
+		//Pushes the list [first, last] which is already linked using next_a
+		static void pushList(atomic<TaggedPtr>& head, Node* first, Node* last)
+		{
+			TaggedPtr oldHead = head.load(memory_order_relaxed);
+			do
+			{
+				last->next_a.store(getPtr(oldHead), memory_order_relaxed);
+			} while (!head.compare_exchange_weak(oldHead, makeTaggedPtr(first, oldHead), memory_order_release, memory_order_relaxed));
+		}
+
+		//Returns nullptr if the list is empty
+		static Node* popNode(atomic<TaggedPtr>& head)
+		{
+			TaggedPtr oldHead = head.load(memory_order_acquire);
+			while (true)
+			{
+				Node* node = getPtr(oldHead);
+				if (node == nullptr)
+					return nullptr;
+
+				//node may be popped and reused by another thread at this point. The value of next is then stale, but the CAS fails due to tag.
+				Node* next = node->next_a.load(memory_order_relaxed);
+				if (head.compare_exchange_weak(oldHead, makeTaggedPtr(next, oldHead), memory_order_acquire, memory_order_acquire))
+					return node;
+			}
+		}
+
+		static void deleteList(Node* curr)
+		{
+			while (curr != nullptr)      // release the list
+			{
+				Node* tmp = curr;
+				curr = curr->next_a.load(memory_order_relaxed);
+				delete tmp;
+			}
+		}
+
+		char pad0[CACHE_LINE_SIZE];
+
+		// shared among producers and consumers
+		atomic<TaggedPtr> head_a;
+		char pad1[CACHE_LINE_SIZE - sizeof(atomic<TaggedPtr>)];
+
+		// nodes which are not in use, shared among producers and consumers
+		atomic<TaggedPtr> freeList_a;
+		char pad2[CACHE_LINE_SIZE - sizeof(atomic<TaggedPtr>)];
+	};
+}
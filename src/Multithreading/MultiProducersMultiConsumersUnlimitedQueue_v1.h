@@ -12,6 +12,10 @@
 #include <forward_list>
 using namespace std;
 
+#include "EventCount.h"
+
+#include "MultiProducersMultiConsumersQueueWatermark.h"
+
 /*
 This is Multi Producers Multi Consumers Unlimited Size Queue.
 This is the most common and basic implementation using one mutex and one condition variable.
@@ -27,15 +31,23 @@ namespace mm {
 	class MultiProducersMultiConsumersUnlimitedQueue_v1
 	{
 	public:
+		explicit MultiProducersMultiConsumersUnlimitedQueue_v1(const QueueWatermarkConfig& watermarkConfig = QueueWatermarkConfig{})
+			: watermark_{ watermarkConfig }
+		{}
 
-		void push(T&& obj)
+		bool push(T&& obj, const std::chrono::milliseconds& timeout = std::chrono::milliseconds{ 1000 * 60 * 60 }) //default timeout = 1 hr
 		{
+			if (!watermark_.beforePush(timeout))
+				return false;
+
 			std::unique_lock<std::mutex> p_lock(mutex_);
 			queue_.push(std::move(obj));
 			//cout << "\nThread " << this_thread::get_id() << " pushed " << obj << " into queue. Queue size: " << queue_.size();
 			p_lock.unlock(); //release the lock on mutex, so that the notified thread can acquire that mutex immediately when awakened,
 							//Otherwise waiting thread may try to acquire mutex before this thread releases it.
-			cv_.notify_one(); //This will always notify one thread even though there are no waiting threads
+			notEmpty_.notify(); //Does not signal anybody if no consumer is waiting
+
+			return true;
 		}
 
 		//exception SAFE pop() with timeout. Returns false if timeout occurs.
@@ -46,9 +58,12 @@ namespace mm {
 			//force it to check if queue is empty so that it can wait again if the queue is empty
 			while (queue_.empty()) 
 			{
-				//cv_.wait(mlock);
-				if(cv_.wait_for(p_lock, timeout) == std::cv_status::timeout)
+				//Register as waiter before releasing the mutex, so that the thread which changes the state next sees it
+				EventCount::Key key = notEmpty_.prepareWait();
+				p_lock.unlock();
+				if (!notEmpty_.commitWait(key, timeout))
 					return false;
+				p_lock.lock();
 			}
 			//OR
 			//cv_.wait(mlock, [this](){ return !this->queue_.empty(); });
@@ -57,25 +72,66 @@ namespace mm {
 			outVal = std::move(queue_.front());
 			queue_.pop();
 			//cout << "\nThread " << this_thread::get_id() << " popped " << obj << " from queue. Queue size: " << queue_.size();
+			watermark_.afterPop();
 			return true;
 		}
 
+		//Pops all the elements currently in the queue and calls func(T&&) for each of them, in FIFO order.
+		//It does not wait if the queue is empty. Returns the number of elements consumed.
+		//Swaps the whole container under the lock, so the mutex is locked only once per batch. func is called outside the lock.
+		template<typename Func>
+		size_t consume_all(Func func)
+		{
+			std::queue<T, Container<T>> batch;
+			std::unique_lock<std::mutex> p_lock(mutex_);
+			std::swap(batch, queue_);
+			p_lock.unlock();
+
+			size_t count = 0;
+			for (; !batch.empty(); batch.pop(), ++count)
+				func(std::move(batch.front()));
+
+			if (count > 0)
+				watermark_.afterPop(count);
+			return count;
+		}
+
+		//Moves all the elements currently in the queue to out. Returns the number of elements moved.
+		template<typename OutputIt>
+		size_t drain(OutputIt out)
+		{
+			return consume_all([&out](T&& obj) { *out++ = std::move(obj); });
+		}
+
 		size_t size()
 		{
 			std::unique_lock<std::mutex> p_lock(mutex_);
 			return queue_.size();
 		}
 
+		EventCountStats getEventCountStats() const
+		{
+			return notEmpty_.getStats();
+		}
+
 		bool empty()
 		{
 			std::unique_lock<std::mutex> p_lock(mutex_);
 			return queue_.empty();
 		}
 
+		//Maintained only if the watermarks are configured (highWatermark is set), otherwise it is always 0. Its cheaper than size() which walks the list or locks the queue.
+		size_t approximateSize() const
+		{
+			return watermark_.approximateSize();
+		}
+
 	private:
 		std::queue<T, Container<T>> queue_; //The queue internally uses the deque by default
 		std::mutex mutex_;
-		std::condition_variable cv_;
+		EventCount notEmpty_;
+
+		QueueWatermark watermark_;
 	};
 
 
@@ -84,12 +140,16 @@ namespace mm {
 	class MultiProducersMultiConsumersUnlimitedQueue_v1<T, std::forward_list>
 	{
 	public:
-		MultiProducersMultiConsumersUnlimitedQueue_v1()
-			: last_{ queue_.before_begin() }
+		explicit MultiProducersMultiConsumersUnlimitedQueue_v1(const QueueWatermarkConfig& watermarkConfig = QueueWatermarkConfig{})
+			: last_{ queue_.before_begin() },
+			watermark_{ watermarkConfig }
 		{}
 
-		void push(T&& obj)
+		bool push(T&& obj, const std::chrono::milliseconds& timeout = std::chrono::milliseconds{ 1000 * 60 * 60 }) //default timeout = 1 hr
 		{
+			if (!watermark_.beforePush(timeout))
+				return false;
+
 			std::unique_lock<std::mutex> p_lock(mutex_);
 			if(queue_.empty())
 				last_ = queue_.before_begin(); //The last_ can be updated in pop() as well as shown below by commented code, but it is used by only producer, so keep it in push()
@@ -98,7 +158,9 @@ namespace mm {
 			//cout << "\nThread " << this_thread::get_id() << " pushed " << obj << " into queue. Queue size: " << queue_.size();
 			p_lock.unlock(); //release the lock on mutex, so that the notified thread can acquire that mutex immediately when awakened,
 							//Otherwise waiting thread may try to acquire mutex before this thread releases it.
-			cv_.notify_one(); //This will always notify one thread even though there are no waiting threads
+			notEmpty_.notify(); //Does not signal anybody if no consumer is waiting
+
+			return true;
 		}
 
 		//exception SAFE pop() with timeout. Returns false if timeout occurs.
@@ -110,8 +172,12 @@ namespace mm {
 			while (queue_.empty()) 
 			{
 				//cond_.wait(mlock);
-				if (cv_.wait_for(p_lock, timeout) == std::cv_status::timeout)
+				//Register as waiter before releasing the mutex, so that the thread which changes the state next sees it
+				EventCount::Key key = notEmpty_.prepareWait();
+				p_lock.unlock();
+				if (!notEmpty_.commitWait(key, timeout))
 					return false;
+				p_lock.lock();
 			}
 			//OR
 			//cv_.wait(p_lock, [this](){ return !this->queue_.empty(); });
@@ -123,9 +189,41 @@ namespace mm {
 			//	last_ = queue_.before_begin();
 
 			//cout << "\nThread " << this_thread::get_id() << " popped " << obj << " from queue. Queue size: " << queue_.size();
+			watermark_.afterPop();
 			return true;
 		}
 
+		//Pops all the elements currently in the queue and calls func(T&&) for each of them, in FIFO order.
+		//It does not wait if the queue is empty. Returns the number of elements consumed.
+		//Swaps the whole list under the lock, so the mutex is locked only once per batch. func is called outside the lock.
+		template<typename Func>
+		size_t consume_all(Func func)
+		{
+			std::forward_list<T> batch;
+			std::unique_lock<std::mutex> p_lock(mutex_);
+			batch.swap(queue_);
+			last_ = queue_.before_begin();
+			p_lock.unlock();
+
+			size_t count = 0;
+			for (T& obj : batch)
+			{
+				func(std::move(obj));
+				++count;
+			}
+
+			if (count > 0)
+				watermark_.afterPop(count);
+			return count;
+		}
+
+		//Moves all the elements currently in the queue to out. Returns the number of elements moved.
+		template<typename OutputIt>
+		size_t drain(OutputIt out)
+		{
+			return consume_all([&out](T&& obj) { *out++ = std::move(obj); });
+		}
+
 		size_t size()
 		{
 			std::unique_lock<std::mutex> p_lock(mutex_);
@@ -133,17 +231,30 @@ namespace mm {
 			//return size_;
 		}
 
+		EventCountStats getEventCountStats() const
+		{
+			return notEmpty_.getStats();
+		}
+
 		bool empty()
 		{
 			std::unique_lock<std::mutex> p_lock(mutex_);
 			return queue_.empty();
 		}
 
+		//Maintained only if the watermarks are configured (highWatermark is set), otherwise it is always 0. Its cheaper than size() which walks the list or locks the queue.
+		size_t approximateSize() const
+		{
+			return watermark_.approximateSize();
+		}
+
 	private:
 		std::forward_list<T> queue_; //The queue internally uses the vector by default
 		typename std::forward_list<T>::iterator last_;
 		//size_t size_;
 		std::mutex mutex_;
-		std::condition_variable cv_;
+		EventCount notEmpty_;
+
+		QueueWatermark watermark_;
 	};
 }
\ No newline at end of file
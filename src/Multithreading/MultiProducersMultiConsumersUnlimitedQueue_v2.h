@@ -12,6 +12,10 @@
 #include <forward_list>
 using namespace std;
 
+#include "EventCount.h"
+
+#include "MultiProducersMultiConsumersQueueWatermark.h"
+
 /*
 This is Multi Producers Multi Consumers Unlimited Size Queue.
 This is implemented using two mutexes and one condition variable.
@@ -33,22 +37,28 @@ namespace mm {
 	class MultiProducersMultiConsumersUnlimitedQueue_v2<T, std::list>
 	{
 	public:
-		MultiProducersMultiConsumersUnlimitedQueue_v2()
+		explicit MultiProducersMultiConsumersUnlimitedQueue_v2(const QueueWatermarkConfig& watermarkConfig = QueueWatermarkConfig{})
 			: 
 			//head_{ queue_.begin() },
 			//tail_{ queue_.end() },
-			nonAtomicSize_{	0 }
+			nonAtomicSize_{	0 },
+			watermark_{ watermarkConfig }
 		{}
 
-		void push(T&& obj)
+		bool push(T&& obj, const std::chrono::milliseconds& timeout = std::chrono::milliseconds{ 1000 * 60 * 60 }) //default timeout = 1 hr
 		{
+			if (!watermark_.beforePush(timeout))
+				return false;
+
 			std::unique_lock<std::mutex> p_lock(mutexProducer_);
 			queue_.push_back(std::move(obj));
 			++nonAtomicSize_;
 			//cout << "\nThread " << this_thread::get_id() << " pushed " << obj << " into queue. Queue size: " << queue_.size();
 			p_lock.unlock(); //release the lock on mutex, so that the notified thread can acquire that mutex immediately when awakened,
 							//Otherwise waiting thread may try to acquire mutex before this thread releases it.
-			cv_.notify_one(); //This will always notify one thread even though there are no waiting threads
+			notEmpty_.notify(); //Does not signal anybody if no consumer is waiting
+
+			return true;
 		}
 
 		//exception SAFE pop() with timeout. Returns false if timeout occurs.
@@ -61,9 +71,12 @@ namespace mm {
 			//force it to check if queue is empty so that it can wait again if the queue is empty
 			while(nonAtomicSize_ == 0) //Do not use 'while(queue_.empty())' because it internally uses size_ inside std::list which is not protected/thread safe
 			{
-				//cv_.wait(mlock);
-				if(cv_.wait_for(p_lock, timeout) == std::cv_status::timeout)
+				//Register as waiter before releasing the mutex, so that the thread which changes the state next sees it
+				EventCount::Key key = notEmpty_.prepareWait();
+				p_lock.unlock();
+				if (!notEmpty_.commitWait(key, timeout))
 					return false;
+				p_lock.lock();
 			}
 			//OR
 			//cv_.wait(mlock, [this](){ return !this->queue_.empty(); });
@@ -82,6 +95,7 @@ namespace mm {
 			queue_.pop_front();
 			
 			//cout << "\nThread " << this_thread::get_id() << " popped " << obj << " from queue. Queue size: " << queue_.size();
+			watermark_.afterPop();
 			return true;
 		}
 
@@ -93,6 +107,11 @@ namespace mm {
 			return nonAtomicSize_;
 		}
 
+		EventCountStats getEventCountStats() const
+		{
+			return notEmpty_.getStats();
+		}
+
 		bool empty()
 		{
 			std::unique_lock<std::mutex> p_lock(mutexProducer_);
@@ -101,6 +120,12 @@ namespace mm {
 			return nonAtomicSize_ == 0;
 		}
 
+		//Maintained only if the watermarks are configured (highWatermark is set), otherwise it is always 0. Its cheaper than size() which walks the list or locks the queue.
+		size_t approximateSize() const
+		{
+			return watermark_.approximateSize();
+		}
+
 	private:
 		std::list<T> queue_;
 		//typename std::list<T>::iterator head_;
@@ -109,7 +134,9 @@ namespace mm {
 		size_t nonAtomicSize_;
 		std::mutex mutexProducer_;
 		std::mutex mutexConsumer_;
-		std::condition_variable cv_;
+		EventCount notEmpty_;
+
+		QueueWatermark watermark_;
 	};
 
 
@@ -118,13 +145,17 @@ namespace mm {
 	class MultiProducersMultiConsumersUnlimitedQueue_v2<T, std::forward_list>
 	{
 	public:
-		MultiProducersMultiConsumersUnlimitedQueue_v2()
+		explicit MultiProducersMultiConsumersUnlimitedQueue_v2(const QueueWatermarkConfig& watermarkConfig = QueueWatermarkConfig{})
 			: last_{ queue_.before_begin() },
-			nonAtomicSize_{ 0 }
+			nonAtomicSize_{ 0 },
+			watermark_{ watermarkConfig }
 		{}
 
-		void push(T&& obj)
+		bool push(T&& obj, const std::chrono::milliseconds& timeout = std::chrono::milliseconds{ 1000 * 60 * 60 }) //default timeout = 1 hr
 		{
+			if (!watermark_.beforePush(timeout))
+				return false;
+
 			std::unique_lock<std::mutex> p_lock(mutexProducer_);
 			if(nonAtomicSize_ == 0) //if(queue_.empty()) also works but better check the value of nonAtomicSize_
 				last_ = queue_.before_begin();
@@ -133,7 +164,9 @@ namespace mm {
 			//cout << "\nThread " << this_thread::get_id() << " pushed " << obj << " into queue. Queue size: " << queue_.size();
 			p_lock.unlock(); //release the lock on mutex, so that the notified thread can acquire that mutex immediately when awakened,
 							//Otherwise waiting thread may try to acquire mutex before this thread releases it.
-			cv_.notify_one(); //This will always notify one thread even though there are no waiting threads
+			notEmpty_.notify(); //Does not signal anybody if no consumer is waiting
+
+			return true;
 		}
 
 		//exception SAFE pop() with timeout. Returns false if timeout occurs.
@@ -147,8 +180,12 @@ namespace mm {
 			while(nonAtomicSize_ == 0) //while(queue_.empty()) also works but better check the value of nonAtomicSize_
 			{
 				//cond_.wait(mlock);
-				if (cv_.wait_for(p_lock, timeout) == std::cv_status::timeout)
+				//Register as waiter before releasing the mutex, so that the thread which changes the state next sees it
+				EventCount::Key key = notEmpty_.prepareWait();
+				p_lock.unlock();
+				if (!notEmpty_.commitWait(key, timeout))
 					return false;
+				p_lock.lock();
 			}
 			//OR
 			//cv_.wait(p_lock, [this](){ return !this->queue_.empty(); });
@@ -168,6 +205,7 @@ namespace mm {
 			//	last_ = queue_.before_begin();
 
 			//cout << "\nThread " << this_thread::get_id() << " popped " << obj << " from queue. Queue size: " << queue_.size();
+			watermark_.afterPop();
 			return true;
 		}
 
@@ -179,6 +217,11 @@ namespace mm {
 			return nonAtomicSize_;
 		}
 
+		EventCountStats getEventCountStats() const
+		{
+			return notEmpty_.getStats();
+		}
+
 		bool empty()
 		{
 			std::unique_lock<std::mutex> p_lock(mutexProducer_);
@@ -187,6 +230,12 @@ namespace mm {
 			return nonAtomicSize_ == 0;
 		}
 
+		//Maintained only if the watermarks are configured (highWatermark is set), otherwise it is always 0. Its cheaper than size() which walks the list or locks the queue.
+		size_t approximateSize() const
+		{
+			return watermark_.approximateSize();
+		}
+
 	private:
 		std::forward_list<T> queue_; //The queue internally uses the vector by default
 		typename std::forward_list<T>::iterator last_;
@@ -194,7 +243,9 @@ namespace mm {
 		size_t nonAtomicSize_;
 		std::mutex mutexProducer_;
 		std::mutex mutexConsumer_;
-		std::condition_variable cv_;
+		EventCount notEmpty_;
+
+		QueueWatermark watermark_;
 	};
 
 
@@ -265,12 +316,16 @@ namespace mm {
 		};
 
 	public:
-		MultiProducersMultiConsumersUnlimitedQueue_v2()
-			: nonAtomicSize_{ 0 }
+		explicit MultiProducersMultiConsumersUnlimitedQueue_v2(const QueueWatermarkConfig& watermarkConfig = QueueWatermarkConfig{})
+			: nonAtomicSize_{ 0 },
+			watermark_{ watermarkConfig }
 		{}
 
-		void push(T&& obj)
+		bool push(T&& obj, const std::chrono::milliseconds& timeout = std::chrono::milliseconds{ 1000 * 60 * 60 }) //default timeout = 1 hr
 		{
+			if (!watermark_.beforePush(timeout))
+				return false;
+
 			std::unique_lock<std::mutex> p_lock(mutexProducer_);
 			queue_.push_back(std::move(obj)); //Push element at the tail.
 			++nonAtomicSize_;
@@ -278,7 +333,9 @@ namespace mm {
 			//cout << "\nThread " << this_thread::get_id() << " pushed " << obj << " into queue. Queue size: " << queue_.size();
 			p_lock.unlock(); //release the lock on mutex, so that the notified thread can acquire that mutex immediately when awakened,
 							//Otherwise waiting thread may try to acquire mutex before this thread releases it.
-			cv_.notify_one(); //This will always notify one thread even though there are no waiting threads
+			notEmpty_.notify(); //Does not signal anybody if no consumer is waiting
+
+			return true;
 		}
 
 		//exception SAFE pop() with timeout. Returns false if timeout occurs.
@@ -291,9 +348,12 @@ namespace mm {
 			//force it to check if queue is empty so that it can wait again if the queue is empty
 			while (nonAtomicSize_ == 0)
 			{
-				//cv_.wait(p_lock);
-				if (cv_.wait_for(p_lock, timeout) == std::cv_status::timeout)
+				//Register as waiter before releasing the mutex, so that the thread which changes the state next sees it
+				EventCount::Key key = notEmpty_.prepareWait();
+				p_lock.unlock();
+				if (!notEmpty_.commitWait(key, timeout))
 					return false;
+				p_lock.lock();
 			}
 			//OR
 			//cond_.wait(mlock, [this](){ return !this->queue_.empty(); });
@@ -311,6 +371,7 @@ namespace mm {
 
 			queue_.pop_front(outVal);
 			//cout << "\nThread " << this_thread::get_id() << " popped " << obj << " from queue. Queue size: " << queue_.size();
+			watermark_.afterPop();
 			return true;
 		}
 
@@ -321,6 +382,11 @@ namespace mm {
 			return nonAtomicSize_;
 		}
 
+		EventCountStats getEventCountStats() const
+		{
+			return notEmpty_.getStats();
+		}
+
 		bool empty()
 		{
 			std::unique_lock<std::mutex> p_lock(mutexProducer_);
@@ -328,13 +394,21 @@ namespace mm {
 			return nonAtomicSize_ == 0;
 		}
 
+		//Maintained only if the watermarks are configured (highWatermark is set), otherwise it is always 0. Its cheaper than size() which walks the list or locks the queue.
+		size_t approximateSize() const
+		{
+			return watermark_.approximateSize();
+		}
+
 	private:
 		ForwardList queue_;
 		//std::atomic<size_t> size_;
 		size_t nonAtomicSize_;
 		std::mutex mutexProducer_;
 		std::mutex mutexConsumer_;
-		std::condition_variable cv_;
+		EventCount notEmpty_;
+
+		QueueWatermark watermark_;
 	};
 
 
@@ -13,6 +13,10 @@
 #include <atomic>
 using namespace std;
 
+#include "EventCount.h"
+
+#include "MultiProducersMultiConsumersQueueWatermark.h"
+
 /*
 This is Multi Producers Multi Consumers Unlimited Size Queue.
 This is implemented using two mutexes and one condition variable.
@@ -92,12 +96,16 @@ namespace mm {
 		};
 
 	public:
-		MultiProducersMultiConsumersUnlimitedQueue_v3()
+		explicit MultiProducersMultiConsumersUnlimitedQueue_v3(const QueueWatermarkConfig& watermarkConfig = QueueWatermarkConfig{})
 			//: nonAtomicSize_{ 0 }
+			: watermark_{ watermarkConfig }
 		{}
 
-		void push(T&& obj)
+		bool push(T&& obj, const std::chrono::milliseconds& timeout = std::chrono::milliseconds{ 1000 * 60 * 60 }) //default timeout = 1 hr
 		{
+			if (!watermark_.beforePush(timeout))
+				return false;
+
 			std::unique_lock<std::mutex> p_lock(mutexProducer_);
 			queue_.push_back(std::move(obj)); //Push element at the tail.
 			//++nonAtomicSize_;
@@ -105,7 +113,9 @@ namespace mm {
 			//cout << "\nThread " << this_thread::get_id() << " pushed " << obj << " into queue. Queue size: " << queue_.size();
 			p_lock.unlock(); //release the lock on mutex, so that the notified thread can acquire that mutex immediately when awakened,
 							//Otherwise waiting thread may try to acquire mutex before this thread releases it.
-			cv_.notify_one(); //This will always notify one thread even though there are no waiting threads
+			notEmpty_.notify(); //Does not signal anybody if no consumer is waiting
+
+			return true;
 		}
 
 		//exception SAFE pop() with timeout. Returns false if timeout occurs.
@@ -121,9 +131,12 @@ namespace mm {
 				//force it to check if queue is empty so that it can wait again if the queue is empty
 				while (queue_.head_->next_a == nullptr)
 				{
-					//cv_.wait(p_lock);
-					if (cv_.wait_for(p_lock, timeout) == std::cv_status::timeout)
+					//Register as waiter before releasing the mutex, so that the thread which changes the state next sees it
+					EventCount::Key key = notEmpty_.prepareWait();
+					p_lock.unlock();
+					if (!notEmpty_.commitWait(key, timeout))
 						return false;
+					p_lock.lock();
 				}
 			}
 			//OR
@@ -142,6 +155,7 @@ namespace mm {
 
 			queue_.pop_front(outVal);
 			//cout << "\nThread " << this_thread::get_id() << " popped " << obj << " from queue. Queue size: " << queue_.size();
+			watermark_.afterPop();
 			return true;
 		}
 
@@ -160,6 +174,11 @@ namespace mm {
 			return size;
 		}
 
+		EventCountStats getEventCountStats() const
+		{
+			return notEmpty_.getStats();
+		}
+
 		bool empty()
 		{
 			std::unique_lock<std::mutex> p_lock(mutexProducer_);
@@ -168,13 +187,21 @@ namespace mm {
 			return queue_.head_->next_a == nullptr;
 		}
 
+		//Maintained only if the watermarks are configured (highWatermark is set), otherwise it is always 0. Its cheaper than size() which walks the list or locks the queue.
+		size_t approximateSize() const
+		{
+			return watermark_.approximateSize();
+		}
+
 	private:
 		ForwardList queue_;
 		//std::atomic<size_t> size_;
 		//size_t nonAtomicSize_;
 		std::mutex mutexProducer_;
 		std::mutex mutexConsumer_;
-		std::condition_variable cv_;
+		EventCount notEmpty_;
+
+		QueueWatermark watermark_;
 	};
 
 
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <iostream>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <chrono>
+#include <cassert> //for assert()
+#include <cmath>
+#include <atomic>
+using namespace std;
+
+#include "EventCount.h"
+
+#include "MultiProducersMultiConsumersQueueWatermark.h"
+
+/*
+This is Multi Producers Multi Consumers Unlimited Size Queue.
+This is implemented using two mutexes and one EventCount (see EventCount.h). Producers do not signal anybody if no consumer is waiting.
+It is the two-lock queue from Michael and Scott's paper "Simple, Fast, and Practical Non-Blocking and Blocking Concurrent Queue Algorithms":
+https://www.cs.rochester.edu/u/scott/papers/1996_PODC_queues.pdf
+
+The list always contains one dummy node at the head. The head_ is touched only by consumers (under mutexConsumer_)
+and the tail_ is touched only by producers (under mutexProducer_). Unlike MultiProducersMultiConsumersUnlimitedQueue_v2,
+pop() never takes mutexProducer_ and there is no size counter shared between producers and consumers.
+When the queue has one element, head_->next_a == tail_ and both sides touch the same node, so next_a is atomic.
+Producers never need to wait because its unlimited queue and will never be full.
+Consumers have to wait if the queue is empty.
+*/
+
+#define CACHE_LINE_SIZE 64
+
+namespace mm {
+
+	template<typename T>
+	class MultiProducersMultiConsumersUnlimitedQueue_v4
+	{
+	private:
+		struct Node
+		{
+			Node() : value_{}, next_a{ nullptr } { }
+			Node(T&& val) : value_{ std::move(val) }, next_a{ nullptr } { }
+			T value_;
+			atomic<Node*> next_a;
+		};
+
+	public:
+		explicit MultiProducersMultiConsumersUnlimitedQueue_v4(const QueueWatermarkConfig& watermarkConfig = QueueWatermarkConfig{})
+			: watermark_{ watermarkConfig }
+		{
+			head_ = tail_ = new Node{}; //the dummy node
+		}
+
+		~MultiProducersMultiConsumersUnlimitedQueue_v4()
+		{
+			Node* curr = head_;
+			while (curr != nullptr)      // release the list
+			{
+				Node* tmp = curr;
+				curr = curr->next_a.load(memory_order_relaxed);
+				delete tmp;
+			}
+		}
+
+		bool push(T&& obj, const std::chrono::milliseconds& timeout = std::chrono::milliseconds{ 1000 * 60 * 60 }) //default timeout = 1 hr
+		{
+			if (!watermark_.beforePush(timeout))
+				return false;
+
+			Node* tmp = new Node{ std::move(obj) }; //allocate outside the lock
+
+			std::unique_lock<std::mutex> p_lock(mutexProducer_);
+			tail_->next_a.store(tmp, memory_order_seq_cst); // publish to consumers
+			tail_ = tmp;
+			p_lock.unlock();
+
+			notEmpty_.notify(); //Does not signal anybody if no consumer is waiting
+
+			return true;
+		}
+
+		//exception SAFE pop() with timeout. Returns false if timeout occurs.
+		bool pop(T& outVal, const std::chrono::milliseconds& timeout)
+		{
+			std::unique_lock<std::mutex> c_lock(mutexConsumer_);
+
+			Node* theNext = nullptr;
+			//If more number of threads are notified than the number of elements in queue,
+			//force it to check if queue is empty so that it can wait again if the queue is empty
+			while ((theNext = head_->next_a.load(memory_order_acquire)) == nullptr)
+			{
+				//Register as waiter, then check again. The producer links the node before it checks for waiters.
+				EventCount::Key key = notEmpty_.prepareWait();
+				if (head_->next_a.load(memory_order_seq_cst) != nullptr)
+				{
+					notEmpty_.cancelWait();
+					continue;
+				}
+				c_lock.unlock();
+				if (!notEmpty_.commitWait(key, timeout))
+					return false;
+				c_lock.lock();
+			}
+
+			Node* theFirst = head_;
+			outVal = std::move(theNext->value_); //If the exception is thrown at this statement, the state of the entire queue will remain unchanged
+			head_ = theNext; //theNext becomes the new dummy node
+			c_lock.unlock();
+
+			delete theFirst; //the old dummy node
+			watermark_.afterPop();
+			return true;
+		}
+
+		size_t size()
+		{
+			std::unique_lock<std::mutex> p_lock(mutexProducer_);
+			std::unique_lock<std::mutex> c_lock(mutexConsumer_);
+			size_t size = 0;
+			for (Node* curr = head_->next_a; curr != nullptr; curr = curr->next_a)
+			{
+				++size;
+			}
+
+			return size;
+		}
+
+		bool empty()
+		{
+			std::unique_lock<std::mutex> c_lock(mutexConsumer_);
+			return head_->next_a.load(memory_order_acquire) == nullptr;
+		}
+
+		EventCountStats getEventCountStats() const
+		{
+			return notEmpty_.getStats();
+		}
+
+		//Maintained only if the watermarks are configured (highWatermark is set), otherwise it is always 0. Its cheaper than size() which walks the list or locks the queue.
+		size_t approximateSize() const
+		{
+			return watermark_.approximateSize();
+		}
+
+	private:
+		char pad0[CACHE_LINE_SIZE];
+
+		// for one consumer at a time
+		Node* head_;
+		std::mutex mutexConsumer_;
+		char pad1[CACHE_LINE_SIZE];
+
+		// for one producer at a time
+		Node* tail_;
+		std::mutex mutexProducer_;
+		char pad2[CACHE_LINE_SIZE];
+
+		// consumers wait on it, producers notify it
+		EventCount notEmpty_;
+		char pad3[CACHE_LINE_SIZE];
+
+		QueueWatermark watermark_;
+	};
+}
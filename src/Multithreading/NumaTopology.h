@@ -0,0 +1,174 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <cstdlib>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+/*
+NUMA topology for the cohort locks (see CohortLock_v1.h).
+
+System topology (NumaTopology{}): read from /sys/devices/system/node on Linux:
+	/sys/devices/system/node/online           list of the online nodes, e.g. "0-1"
+	/sys/devices/system/node/node<N>/cpulist  list of the cpus of node N, e.g. "0-15,32-47"
+The nodes are numbered 0 .. getNumNodes() - 1 in the order of their ids (node ids may have gaps).
+getCurrentNode() maps the cpu the calling thread runs on (sched_getcpu()) to its node. The thread may be moved to another cpu right after,
+so the result is only a hint for locality, the callers must stay correct whatever node it returns.
+If /sys can not be read (not Linux, or hidden in a container), it is a single node.
+
+Simulated topology (NumaTopology{ numNodes }): for testing the cohort locks on a single node machine. Each thread gets a node once
+(round robin by the order in which the threads first ask for it), so the threads form numNodes fixed cohorts.
+
+getDefault() is the topology used by the locks which are not given one: simulated with $MM_SIMULATED_NUMA_NODES nodes if that is set, else the system one.
+*/
+
+namespace mm {
+
+	class NumaTopology
+	{
+	public:
+		//System topology
+		NumaTopology()
+			: simulated_{ false },
+			numNodes_{ 1 }
+		{
+			readSystemTopology();
+		}
+
+		//Simulated topology
+		explicit NumaTopology(unsigned int numNodes)
+			: simulated_{ true },
+			numNodes_{ numNodes > 0 ? numNodes : 1 }
+		{
+		}
+
+		static const NumaTopology& getDefault()
+		{
+			static const NumaTopology topology = createDefault();
+			return topology;
+		}
+
+		unsigned int getNumNodes() const
+		{
+			return numNodes_;
+		}
+
+		bool isSimulated() const
+		{
+			return simulated_;
+		}
+
+		unsigned int getCurrentNode() const
+		{
+			if (simulated_)
+				return getThreadIndex() % numNodes_;
+
+#if defined(__linux__)
+			const int cpu = sched_getcpu();
+			if (cpu >= 0 && static_cast<size_t>(cpu) < cpuToNode_.size())
+				return cpuToNode_[cpu];
+#endif
+			return 0;
+		}
+
+		std::string toString() const
+		{
+			std::stringstream ss;
+			ss << (simulated_ ? "simulated" : "system") << " NUMA topology with " << numNodes_ << " node(s)";
+			return ss.str();
+		}
+
+		//Parses a cpu or node list of /sys, e.g. "0-3,8,10-11"
+		static std::vector<unsigned int> parseList(const std::string& list)
+		{
+			std::vector<unsigned int> values;
+			std::stringstream ss{ list };
+			std::string range;
+			while (std::getline(ss, range, ','))
+			{
+				if (range.empty() || range.find_first_not_of(" \t\r\n") == std::string::npos)
+					continue;
+
+				const size_t dash = range.find('-');
+				const unsigned long first = std::strtoul(range.c_str(), nullptr, 10);
+				const unsigned long last = dash == std::string::npos ? first : std::strtoul(range.c_str() + dash + 1, nullptr, 10);
+				for (unsigned long value = first; value <= last; ++value)
+					values.push_back(static_cast<unsigned int>(value));
+			}
+			return values;
+		}
+
+	private:
+		static NumaTopology createDefault()
+		{
+			const char* simulatedNodes = std::getenv("MM_SIMULATED_NUMA_NODES");
+			if (simulatedNodes != nullptr && std::atoi(simulatedNodes) > 0)
+				return NumaTopology{ static_cast<unsigned int>(std::atoi(simulatedNodes)) };
+			return NumaTopology{};
+		}
+
+		static bool readFile(const std::string& path, std::string& content)
+		{
+			std::ifstream file{ path };
+			if (!file)
+				return false;
+			std::getline(file, content);
+			return true;
+		}
+
+		void readSystemTopology()
+		{
+			std::string onlineNodes;
+			if (!readFile("/sys/devices/system/node/online", onlineNodes))
+				return;
+
+			std::vector<unsigned int> nodeIds = parseList(onlineNodes);
+			std::vector<unsigned int> cpuToNode;
+			unsigned int numNodes = 0;
+			for (unsigned int nodeId : nodeIds)
+			{
+				std::string cpuList;
+				if (!readFile("/sys/devices/system/node/node" + std::to_string(nodeId) + "/cpulist", cpuList))
+					continue;
+
+				std::vector<unsigned int> cpus = parseList(cpuList);
+				if (cpus.empty())
+					continue; //Memory only node, no thread can run on it
+
+				for (unsigned int cpu : cpus)
+				{
+					if (cpu >= cpuToNode.size())
+						cpuToNode.resize(cpu + 1, 0);
+					cpuToNode[cpu] = numNodes;
+				}
+				++numNodes;
+			}
+
+			if (numNodes > 0)
+			{
+				numNodes_ = numNodes;
+				cpuToNode_ = std::move(cpuToNode);
+			}
+		}
+
+		static unsigned int getThreadIndex()
+		{
+			static std::atomic<unsigned int> nextThreadIndex{ 0 };
+			thread_local const unsigned int threadIndex = nextThreadIndex.fetch_add(1, std::memory_order_relaxed);
+			return threadIndex;
+		}
+
+		bool simulated_;
+		unsigned int numNodes_;
+		std::vector<unsigned int> cpuToNode_;
+	};
+
+}
@@ -0,0 +1,547 @@
+#pragma once
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <atomic>
+#include <utility>
+#include <algorithm>
+#include <tuple>
+#include <type_traits>
+
+#include "MM_UnitTestFramework/MM_UnitTestFramework.h"
+#include "TryLockUntil.h"
+
+/*
+Lock contention profiler.
+
+ProfiledLock<L> wraps any lock of this repo and has the same member functions as L, whichever naming L uses:
+	std::mutex, CohortLock, Spinlock:   lock(), unlock(), try_lock(), try_lock_until()
+	SharedMutex:                        lock_shared(), unlock_shared(), try_lock_shared(), try_lock_shared_until() as well
+	ReadWriteLock:                      acquireReadLock(), releaseReadLock(), acquireWriteLock(), releaseWriteLock(), tryAcquire...()
+	McsLock, ClhLock:                   lock(node) / unlock(node), lock() returning the node / unlock(node)
+(each wrapper member function is instantiated only if it is called, so L needs only the ones which are used).
+
+Per lock instance it records, separately for the exclusive and the shared mode:
+	acquisitions:   number of successful acquisitions
+	contended:      acquisitions which had to wait: the blocking and timed acquire calls first try the lock once, and only if that fails
+	                they count as contended and as waiting (locks without try_lock(), i.e. ClhLock: acquisitions which found the lock held)
+	handoffs:       releases while other threads were waiting (as above), i.e. the lock went straight from one thread to a waiting one
+	                (for the shared mode: the last reader out while a writer was waiting). With a FIFO lock (McsLock, CohortLock) it is about
+	                the number of contended acquisitions. With a barging lock (std::mutex, Spinlock) one waiter may see many releases until it gets
+	                the lock, so handoffs much higher than contended means the waiters are overtaken.
+	failed tries:   try...() calls which did not get the lock
+	wait time:      histogram of the time spent in the acquire call (successful ones only)
+	hold time:      histogram of the time from the acquisition to the release
+The histograms have power of 2 buckets in nanoseconds (bucket i counts [2^i, 2^(i+1)) ns), so the percentiles in the report are upper bounds
+within a factor of 2.
+Hold times of the shared mode are matched to their acquisition by a small thread_local list of the shared locks held by the thread, so
+unlock_shared() must be called by the thread which called lock_shared() (as for std::shared_mutex).
+
+The counters are lock-free: each thread adds to the slot of its own thread index (one slot per hardware thread, as the reader slots of the
+big-reader lock) by relaxed fetch_add(), so the threads running at the same time almost never write the same cache line.
+With more threads than hardware threads, some threads share a slot: the counters are still exact, only the cache line is shared.
+getProfile() sums up the slots, report() formats it. Both can be called at any time.
+
+The profiler costs two clock reads and a few atomic operations per acquisition. It is compiled out entirely unless MM_ENABLE_LOCK_PROFILING
+is defined (cmake -DMM_ENABLE_LOCK_PROFILING=ON): then ProfiledLock<L> is L itself, and there is no getProfile() / report().
+*/
+
+namespace mm {
+
+	namespace lockProfiling {
+
+		enum : int { numHistogramBuckets = 40 };
+
+		struct LockHistogram
+		{
+			LockHistogram()
+			{
+				std::fill(buckets, buckets + numHistogramBuckets, 0);
+			}
+
+			uint64_t getCount() const
+			{
+				uint64_t count = 0;
+				for (int i = 0; i < numHistogramBuckets; ++i)
+					count += buckets[i];
+				return count;
+			}
+
+			//Upper bound (exclusive) of the bucket which contains the percentile p (0 < p <= 1), in ns
+			uint64_t getPercentile(double p) const
+			{
+				const uint64_t count = getCount();
+				if (count == 0)
+					return 0;
+
+				const uint64_t rank = static_cast<uint64_t>(p * (count - 1)) + 1;
+				uint64_t seen = 0;
+				for (int i = 0; i < numHistogramBuckets; ++i)
+				{
+					seen += buckets[i];
+					if (seen >= rank)
+						return uint64_t{ 1 } << (i + 1);
+				}
+				return uint64_t{ 1 } << numHistogramBuckets;
+			}
+
+			uint64_t buckets[numHistogramBuckets];
+		};
+
+		struct LockModeProfile
+		{
+			LockModeProfile()
+				: acquisitions{ 0 },
+				contended{ 0 },
+				handoffs{ 0 },
+				failedTries{ 0 }
+			{}
+
+			uint64_t acquisitions;
+			uint64_t contended;
+			uint64_t handoffs;
+			uint64_t failedTries;
+			LockHistogram waitNs;
+			LockHistogram holdNs;
+		};
+
+		struct LockProfile
+		{
+			LockModeProfile exclusive;
+			LockModeProfile shared;
+		};
+
+		//Whether Lock has try_lock(Args&...), e.g. McsLock::try_lock(node), but not ClhLock
+		template<typename Lock, typename ArgsTuple, typename = void>
+		struct HasTryLock : std::false_type {};
+
+		template<typename Lock, typename... Args>
+		struct HasTryLock<Lock, std::tuple<Args...>, decltype(std::declval<Lock&>().try_lock(std::declval<Args&>()...), void())> : std::true_type {};
+
+		inline std::string formatHistogram(const LockHistogram& histogram)
+		{
+			std::stringstream ss;
+			ss << "p50 < " << std::setw(10) << histogram.getPercentile(0.5)
+				<< "  p99 < " << std::setw(12) << histogram.getPercentile(0.99)
+				<< "  max < " << std::setw(14) << histogram.getPercentile(1.0) << " ns";
+			return ss.str();
+		}
+
+		inline std::string formatProfile(const LockProfile& profile, const std::string& indent)
+		{
+			std::stringstream ss;
+			ss.imbue(std::locale{ "" });
+			auto formatMode = [&ss, &indent](const char* mode, const LockModeProfile& p) {
+				if (p.acquisitions == 0 && p.failedTries == 0)
+					return;
+				ss << "\n" << indent << mode
+					<< " acquisitions: " << std::setw(12) << p.acquisitions
+					<< "   contended: " << std::setw(12) << p.contended
+					<< " (" << std::fixed << std::setprecision(1) << (p.acquisitions > 0 ? 100.0 * p.contended / p.acquisitions : 0.0) << " %)"
+					<< "   handoffs: " << std::setw(12) << p.handoffs
+					<< "   failed tries: " << std::setw(10) << p.failedTries
+					<< "\n" << indent << mode << " wait  " << formatHistogram(p.waitNs)
+					<< "\n" << indent << mode << " hold  " << formatHistogram(p.holdNs);
+			};
+			formatMode("exclusive", profile.exclusive);
+			formatMode("shared   ", profile.shared);
+			return ss.str();
+		}
+
+	}
+
+#if defined(MM_ENABLE_LOCK_PROFILING)
+
+	template<typename LockType>
+	class ProfiledLock
+	{
+	public:
+		ProfiledLock()
+			: numSlots_{ std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1 },
+			slots_{ new Slot[numSlots_] },
+			exclusiveHeld_{ false },
+			numSharedHeld_{ 0 },
+			numExclusiveWaiting_{ 0 },
+			numSharedWaiting_{ 0 }
+		{
+		}
+
+		ProfiledLock(const ProfiledLock&) = delete;
+		ProfiledLock& operator=(const ProfiledLock&) = delete;
+
+		//Exclusive mode
+		//(lock() and unlock() return whatever the lock returns, e.g. the node of ClhLock. Lock = LockType only delays the lookup of
+		// LockType::lock() until they are called, the ReadWriteLocks do not have it.)
+
+		template<typename... Args, typename Lock = LockType>
+		auto lock(Args&&... args) -> decltype(std::declval<Lock&>().lock(std::forward<Args>(args)...))
+		{
+			AcquireScope scope{ *this, exclusiveMode };
+			return lockTryFirst(scope, lockProfiling::HasTryLock<Lock, std::tuple<Args...>>{}, std::forward<Args>(args)...);
+		}
+
+		template<typename... Args>
+		bool try_lock(Args&&... args)
+		{
+			AcquireScope scope{ *this, exclusiveMode };
+			return scope.setAcquired(lock_.try_lock(std::forward<Args>(args)...));
+		}
+
+		bool try_lock_until(LockDeadline deadline)
+		{
+			AcquireScope scope{ *this, exclusiveMode };
+			return scope.setAcquired(acquireTryFirst(scope, [this]() { return lock_.try_lock(); }, [this, deadline]() { return lock_.try_lock_until(deadline); }));
+		}
+
+		template<typename... Args, typename Lock = LockType>
+		auto unlock(Args&&... args) -> decltype(std::declval<Lock&>().unlock(std::forward<Args>(args)...))
+		{
+			onRelease(exclusiveMode);
+			return lock_.unlock(std::forward<Args>(args)...);
+		}
+
+		void acquireWriteLock()
+		{
+			AcquireScope scope{ *this, exclusiveMode };
+			acquireTryFirst(scope, [this]() { return lock_.tryAcquireWriteLock(); }, [this]() { lock_.acquireWriteLock(); return true; });
+		}
+
+		bool tryAcquireWriteLock()
+		{
+			AcquireScope scope{ *this, exclusiveMode };
+			return scope.setAcquired(lock_.tryAcquireWriteLock());
+		}
+
+		bool tryAcquireWriteLockUntil(LockDeadline deadline)
+		{
+			AcquireScope scope{ *this, exclusiveMode };
+			return scope.setAcquired(acquireTryFirst(scope, [this]() { return lock_.tryAcquireWriteLock(); }, [this, deadline]() { return lock_.tryAcquireWriteLockUntil(deadline); }));
+		}
+
+		void releaseWriteLock()
+		{
+			onRelease(exclusiveMode);
+			lock_.releaseWriteLock();
+		}
+
+		//Shared mode
+
+		void lock_shared()
+		{
+			AcquireScope scope{ *this, sharedMode };
+			acquireTryFirst(scope, [this]() { return lock_.try_lock_shared(); }, [this]() { lock_.lock_shared(); return true; });
+		}
+
+		bool try_lock_shared()
+		{
+			AcquireScope scope{ *this, sharedMode };
+			return scope.setAcquired(lock_.try_lock_shared());
+		}
+
+		bool try_lock_shared_until(LockDeadline deadline)
+		{
+			AcquireScope scope{ *this, sharedMode };
+			return scope.setAcquired(acquireTryFirst(scope, [this]() { return lock_.try_lock_shared(); }, [this, deadline]() { return lock_.try_lock_shared_until(deadline); }));
+		}
+
+		void unlock_shared()
+		{
+			onRelease(sharedMode);
+			lock_.unlock_shared();
+		}
+
+		void acquireReadLock()
+		{
+			AcquireScope scope{ *this, sharedMode };
+			acquireTryFirst(scope, [this]() { return lock_.tryAcquireReadLock(); }, [this]() { lock_.acquireReadLock(); return true; });
+		}
+
+		bool tryAcquireReadLock()
+		{
+			AcquireScope scope{ *this, sharedMode };
+			return scope.setAcquired(lock_.tryAcquireReadLock());
+		}
+
+		bool tryAcquireReadLockUntil(LockDeadline deadline)
+		{
+			AcquireScope scope{ *this, sharedMode };
+			return scope.setAcquired(acquireTryFirst(scope, [this]() { return lock_.tryAcquireReadLock(); }, [this, deadline]() { return lock_.tryAcquireReadLockUntil(deadline); }));
+		}
+
+		void releaseReadLock()
+		{
+			onRelease(sharedMode);
+			lock_.releaseReadLock();
+		}
+
+		//Profile
+
+		lockProfiling::LockProfile getProfile() const
+		{
+			lockProfiling::LockProfile profile;
+			for (unsigned int i = 0; i < numSlots_; ++i)
+			{
+				slots_[i].modes[exclusiveMode].addTo(profile.exclusive);
+				slots_[i].modes[sharedMode].addTo(profile.shared);
+			}
+			return profile;
+		}
+
+		std::string report(const std::string& indent = "") const
+		{
+			return lockProfiling::formatProfile(getProfile(), indent);
+		}
+
+		const LockType& getLock() const
+		{
+			return lock_;
+		}
+
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		enum Mode : int
+		{
+			exclusiveMode,
+			sharedMode
+		};
+
+		struct AtomicHistogram
+		{
+			AtomicHistogram()
+			{
+				for (int i = 0; i < lockProfiling::numHistogramBuckets; ++i)
+					buckets[i].store(0, std::memory_order_relaxed);
+			}
+
+			void add(Clock::duration duration)
+			{
+				const long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+				int bucket = 0;
+				for (unsigned long long n = ns > 0 ? static_cast<unsigned long long>(ns) : 1; n > 1 && bucket < lockProfiling::numHistogramBuckets - 1; n >>= 1)
+					++bucket;
+				buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+			}
+
+			void addTo(lockProfiling::LockHistogram& histogram) const
+			{
+				for (int i = 0; i < lockProfiling::numHistogramBuckets; ++i)
+					histogram.buckets[i] += buckets[i].load(std::memory_order_relaxed);
+			}
+
+			std::atomic<uint64_t> buckets[lockProfiling::numHistogramBuckets];
+		};
+
+		struct ModeCounters
+		{
+			ModeCounters()
+				: acquisitions{ 0 },
+				contended{ 0 },
+				handoffs{ 0 },
+				failedTries{ 0 }
+			{}
+
+			void addTo(lockProfiling::LockModeProfile& profile) const
+			{
+				profile.acquisitions += acquisitions.load(std::memory_order_relaxed);
+				profile.contended += contended.load(std::memory_order_relaxed);
+				profile.handoffs += handoffs.load(std::memory_order_relaxed);
+				profile.failedTries += failedTries.load(std::memory_order_relaxed);
+				waitNs.addTo(profile.waitNs);
+				holdNs.addTo(profile.holdNs);
+			}
+
+			std::atomic<uint64_t> acquisitions;
+			std::atomic<uint64_t> contended;
+			std::atomic<uint64_t> handoffs;
+			std::atomic<uint64_t> failedTries;
+			AtomicHistogram waitNs;
+			AtomicHistogram holdNs;
+		};
+
+		struct Slot
+		{
+			ModeCounters modes[2];
+			char pad[64];
+		};
+
+		//Records the wait when the acquire call returns (also for the lock() overloads which return a value, e.g. ClhLock::lock())
+		class AcquireScope
+		{
+		public:
+			AcquireScope(ProfiledLock& owner, Mode mode)
+				: owner_{ owner },
+				mode_{ mode },
+				acquired_{ true },
+				contended_{ false },
+				start_{ Clock::now() }
+			{
+			}
+
+			~AcquireScope()
+			{
+				if (contended_)
+					owner_.getWaiting(mode_).fetch_sub(1, std::memory_order_relaxed);
+				if (acquired_)
+					owner_.onAcquired(mode_, contended_, start_);
+				else
+					owner_.getSlot().modes[mode_].failedTries.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			bool setAcquired(bool acquired)
+			{
+				acquired_ = acquired;
+				return acquired;
+			}
+
+			//Called when the acquire call is going to wait, from then on the releasing thread sees this thread as waiting
+			void setContended()
+			{
+				contended_ = true;
+				owner_.getWaiting(mode_).fetch_add(1, std::memory_order_relaxed);
+			}
+
+		private:
+			ProfiledLock& owner_;
+			const Mode mode_;
+			bool acquired_;
+			bool contended_;
+			const Clock::time_point start_;
+		};
+
+		//The shared locks held by this thread, with the time of their acquisition (usually zero or one entry)
+		static std::vector<std::pair<const void*, Clock::time_point>>& getHeldSharedLocks()
+		{
+			thread_local std::vector<std::pair<const void*, Clock::time_point>> heldSharedLocks;
+			return heldSharedLocks;
+		}
+
+		//Tries the lock once, and waits by acquire() only if that fails. acquire() returns false if it gives up (the timed ones).
+		//Only the waiting ones count: with more threads than cores, there are always some threads preempted inside an acquire call,
+		//so counting every call as waiting would make almost every release a handoff even if the lock is free.
+		template<typename TryAcquire, typename Acquire>
+		bool acquireTryFirst(AcquireScope& scope, TryAcquire tryAcquire, Acquire acquire)
+		{
+			if (tryAcquire())
+				return true;
+			scope.setContended();
+			return acquire();
+		}
+
+		template<typename... Args>
+		void lockTryFirst(AcquireScope& scope, std::true_type, Args&&... args)
+		{
+			acquireTryFirst(scope, [&]() { return lock_.try_lock(args...); }, [&]() { lock_.lock(std::forward<Args>(args)...); return true; });
+		}
+
+		//No try_lock() (ClhLock::lock() returns the node): fall back to the holders
+		template<typename... Args, typename Lock = LockType>
+		auto lockTryFirst(AcquireScope& scope, std::false_type, Args&&... args) -> decltype(std::declval<Lock&>().lock(std::forward<Args>(args)...))
+		{
+			if (isHeld(exclusiveMode))
+				scope.setContended();
+			return lock_.lock(std::forward<Args>(args)...);
+		}
+
+		bool isHeld(Mode mode) const
+		{
+			if (exclusiveHeld_.load(std::memory_order_relaxed))
+				return true;
+			return mode == exclusiveMode && numSharedHeld_.load(std::memory_order_relaxed) > 0;
+		}
+
+		std::atomic<int>& getWaiting(Mode mode)
+		{
+			return mode == exclusiveMode ? numExclusiveWaiting_ : numSharedWaiting_;
+		}
+
+		void onAcquired(Mode mode, bool contended, Clock::time_point start)
+		{
+			const Clock::time_point now = Clock::now();
+			ModeCounters& counters = getSlot().modes[mode];
+			counters.acquisitions.fetch_add(1, std::memory_order_relaxed);
+			if (contended)
+				counters.contended.fetch_add(1, std::memory_order_relaxed);
+			counters.waitNs.add(now - start);
+
+			if (mode == exclusiveMode)
+			{
+				exclusiveHeld_.store(true, std::memory_order_relaxed);
+				exclusiveAcquiredAt_ = now;
+			}
+			else
+			{
+				numSharedHeld_.fetch_add(1, std::memory_order_relaxed);
+				getHeldSharedLocks().emplace_back(this, now);
+			}
+		}
+
+		void onRelease(Mode mode)
+		{
+			const Clock::time_point now = Clock::now();
+			ModeCounters& counters = getSlot().modes[mode];
+			const bool writersWaiting = numExclusiveWaiting_.load(std::memory_order_relaxed) > 0;
+			if (mode == exclusiveMode)
+			{
+				counters.holdNs.add(now - exclusiveAcquiredAt_);
+				exclusiveHeld_.store(false, std::memory_order_relaxed);
+				if (writersWaiting || numSharedWaiting_.load(std::memory_order_relaxed) > 0)
+					counters.handoffs.fetch_add(1, std::memory_order_relaxed);
+			}
+			else
+			{
+				std::vector<std::pair<const void*, Clock::time_point>>& held = getHeldSharedLocks();
+				for (size_t i = held.size(); i > 0; --i)
+				{
+					if (held[i - 1].first == this)
+					{
+						counters.holdNs.add(now - held[i - 1].second);
+						held.erase(held.begin() + (i - 1));
+						break;
+					}
+				}
+				//Only the last reader out hands the lock over (to a waiting writer)
+				if (numSharedHeld_.fetch_sub(1, std::memory_order_relaxed) == 1 && writersWaiting)
+					counters.handoffs.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		Slot& getSlot()
+		{
+			return slots_[getThreadIndex() % numSlots_];
+		}
+
+		static unsigned int getThreadIndex()
+		{
+			static std::atomic<unsigned int> nextThreadIndex{ 0 };
+			thread_local const unsigned int threadIndex = nextThreadIndex.fetch_add(1, std::memory_order_relaxed);
+			return threadIndex;
+		}
+
+		LockType lock_;
+		const unsigned int numSlots_;
+		std::unique_ptr<Slot[]> slots_;
+		//Only approximate, they are updated outside of the lock
+		std::atomic<bool> exclusiveHeld_;
+		std::atomic<int> numSharedHeld_;
+		std::atomic<int> numExclusiveWaiting_;
+		std::atomic<int> numSharedWaiting_;
+		//Accessed only by the exclusive holder
+		Clock::time_point exclusiveAcquiredAt_;
+	};
+
+#else
+
+	template<typename LockType>
+	using ProfiledLock = LockType;
+
+#endif
+
+}
@@ -0,0 +1,290 @@
+#pragma once
+
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
+#include <atomic>
+
+/*
+User space RCU (Read-Copy-Update), quiescent state based reclamation (QSBR).
+Reference: Desnoyers, McKenney, Stern, Dagenais, Walpole, "User-Level Implementations of Read-Copy Update" (IEEE TPDS 2012), liburcu-qsbr
+and CppCon 2017: Fedor Pikus "Read, Copy, Update, then what? RCU for non-kernel programmers" (see Vector_Mutex.cpp)
+
+RCU in short:
+	Readers access the shared data through one atomic pointer and never write any shared memory (no lock, no counter, no atomic RMW).
+	A writer makes a copy of the data, modifies the copy and publishes it by storing the pointer. The old copy may still be read by the readers
+	which loaded the pointer before the store, so it is freed only after a grace period: after every reader thread has passed a quiescent state.
+
+QSBR:
+	Each registered thread announces its quiescent states itself (quiescentState(), e.g. once per iteration of its main loop), a point where it does not
+	hold any pointer to RCU protected data. So readLock() and readUnlock() are empty (only a compiler barrier), the read side costs nothing.
+	The price: every registered thread MUST call quiescentState() regularly, or go offline() before it blocks (sleep, wait, I/O),
+	otherwise synchronize() waits for it forever.
+
+Grace period:
+	gp_a is a global counter. quiescentState() copies gp_a to the counter of the thread (ctr_a). synchronize() increments gp_a and waits until
+	the counter of each online thread is at least the new value, i.e. until each online thread has passed a quiescent state after the increment.
+	An offline thread has ctr_a = 0 and is not waited for.
+
+Deferred free:
+	callRcu(func) does not wait. The callbacks are collected in a batch, and when the batch has batchSize callbacks, the thread which adds the last one
+	runs one grace period for the whole batch and then calls all the callbacks. barrier() does the same for the callbacks pending at the moment.
+	So the cost of synchronize() is shared by batchSize updates.
+
+Usage:
+	RcuDomain domain;                           //one per group of data structures, usually global
+	RcuThread self{ domain };                   //in each thread which reads or writes, registers the thread (RAII)
+	Reader:  self.readLock(); p = ptr_a.load(acquire); ...use p...; self.readUnlock(); ... self.quiescentState();
+	Writer:  newP = copy of *p, modify newP; old = ptr_a.exchange(newP); self.callRcu([old]{ delete old; });   //or self.synchronize(); delete old;
+*/
+
+#define CACHE_LINE_SIZE 64
+
+namespace mm {
+
+	namespace rcu_QSBR_v1 {
+
+		class RcuThread;
+
+		class RcuDomain
+		{
+		public:
+			explicit RcuDomain(size_t batchSize = 64)
+				: batchSize_{ batchSize > 0 ? batchSize : 1 },
+				gp_a{ 1 }
+			{
+			}
+
+			//All the registered threads must be gone. Calls the pending callbacks (no reader is left which can see the old data).
+			~RcuDomain()
+			{
+				for (std::function<void()>& func : pending_)
+					func();
+			}
+
+			RcuDomain(const RcuDomain&) = delete;
+			RcuDomain& operator=(const RcuDomain&) = delete;
+
+			//Waits until all the online threads have passed a quiescent state.
+			//The calling thread must not be online in this domain (use RcuThread::synchronize() from a registered thread).
+			void synchronize()
+			{
+				std::lock_guard<std::mutex> gpLock{ gpMutex_ }; //one grace period at a time, concurrent callers share nothing but wait in turn
+
+				//The stores which unlinked the old data must be visible before the readers can see the new gp
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				const uint64_t newGp = gp_a.fetch_add(1, std::memory_order_seq_cst) + 1;
+
+				std::lock_guard<std::mutex> registryLock{ registryMutex_ };
+				for (ThreadRecord* record : threads_)
+				{
+					while (true)
+					{
+						const uint64_t ctr = record->ctr_a.load(std::memory_order_acquire);
+						if (ctr == offline_ || ctr >= newGp)
+							break;
+						std::this_thread::yield();
+					}
+				}
+
+				//The readers are done with the old data before the caller frees it
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+			}
+
+			//Defers func until after a grace period. The calling thread must not be online (use RcuThread::callRcu() from a registered thread).
+			void callRcu(std::function<void()> func)
+			{
+				std::vector<std::function<void()>> batch;
+				{
+					std::lock_guard<std::mutex> lock{ pendingMutex_ };
+					pending_.push_back(std::move(func));
+					if (pending_.size() < batchSize_)
+						return;
+					batch.swap(pending_);
+				}
+
+				runBatch(batch);
+			}
+
+			//Runs a grace period for all the callbacks pending now and calls them. Same requirement as synchronize().
+			void barrier()
+			{
+				std::vector<std::function<void()>> batch;
+				{
+					std::lock_guard<std::mutex> lock{ pendingMutex_ };
+					batch.swap(pending_);
+				}
+
+				runBatch(batch);
+			}
+
+			uint64_t getGracePeriod() const
+			{
+				return gp_a.load(std::memory_order_relaxed) - 1;
+			}
+
+		private:
+			friend class RcuThread;
+
+			static const uint64_t offline_ = 0;
+
+			struct ThreadRecord
+			{
+				ThreadRecord() : ctr_a{ offline_ } { }
+				std::atomic<uint64_t> ctr_a; //written only by its own thread, read by synchronize()
+				char pad[CACHE_LINE_SIZE - sizeof(std::atomic<uint64_t>)];
+			};
+
+			void registerThread(ThreadRecord& record)
+			{
+				std::lock_guard<std::mutex> lock{ registryMutex_ };
+				threads_.push_back(&record);
+			}
+
+			void unregisterThread(ThreadRecord& record)
+			{
+				std::lock_guard<std::mutex> lock{ registryMutex_ };
+				threads_.erase(std::remove(threads_.begin(), threads_.end(), &record), threads_.end());
+			}
+
+			void quiescentState(ThreadRecord& record)
+			{
+				//acquire: the reads after this point see everything which was unlinked before gp_a was incremented
+				record.ctr_a.store(gp_a.load(std::memory_order_acquire), std::memory_order_release);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+			}
+
+			void offline(ThreadRecord& record)
+			{
+				record.ctr_a.store(offline_, std::memory_order_release);
+			}
+
+			void runBatch(std::vector<std::function<void()>>& batch)
+			{
+				if (batch.empty())
+					return;
+
+				synchronize();
+				for (std::function<void()>& func : batch)
+					func();
+			}
+
+			const size_t batchSize_;
+
+			std::mutex gpMutex_;
+			std::mutex registryMutex_;
+			std::vector<ThreadRecord*> threads_;
+			std::mutex pendingMutex_;
+			std::vector<std::function<void()>> pending_;
+
+			char pad0[CACHE_LINE_SIZE];
+			std::atomic<uint64_t> gp_a; //read by every quiescentState(), written only by synchronize()
+			char pad1[CACHE_LINE_SIZE - sizeof(std::atomic<uint64_t>)];
+		};
+
+		//Registers the calling thread in the domain for its lifetime. The thread is online after the constructor.
+		//Create it in the thread which uses it, and do not share it among threads.
+		class RcuThread
+		{
+		public:
+			explicit RcuThread(RcuDomain& domain)
+				: domain_{ domain }
+			{
+				domain_.registerThread(record_);
+				online();
+			}
+
+			~RcuThread()
+			{
+				offline();
+				domain_.unregisterThread(record_);
+			}
+
+			RcuThread(const RcuThread&) = delete;
+			RcuThread& operator=(const RcuThread&) = delete;
+
+			//The read side critical section. Nothing to do in QSBR, only prevents the compiler from moving the reads out of it.
+			void readLock()
+			{
+				std::atomic_signal_fence(std::memory_order_seq_cst);
+			}
+
+			void readUnlock()
+			{
+				std::atomic_signal_fence(std::memory_order_seq_cst);
+			}
+
+			//Tells the domain that this thread does not hold any pointer to RCU protected data at this point
+			void quiescentState()
+			{
+				domain_.quiescentState(record_);
+			}
+
+			//Call it before blocking for a long time. The thread must not access RCU protected data until online().
+			void offline()
+			{
+				domain_.offline(record_);
+			}
+
+			void online()
+			{
+				domain_.quiescentState(record_);
+			}
+
+			//Must be called outside of the read side critical section. It is a quiescent state of this thread.
+			void synchronize()
+			{
+				offline();
+				domain_.synchronize();
+				online();
+			}
+
+			//Must be called outside of the read side critical section. It may be a quiescent state of this thread (if it runs the batch).
+			void callRcu(std::function<void()> func)
+			{
+				offline();
+				domain_.callRcu(std::move(func));
+				online();
+			}
+
+			void barrier()
+			{
+				offline();
+				domain_.barrier();
+				online();
+			}
+
+		private:
+			RcuDomain& domain_;
+			RcuDomain::ThreadRecord record_;
+		};
+
+		//Read side critical section guard
+		class RcuReadLockGuard
+		{
+		public:
+			explicit RcuReadLockGuard(RcuThread& self)
+				: self_{ self }
+			{
+				self_.readLock();
+			}
+
+			~RcuReadLockGuard()
+			{
+				self_.readUnlock();
+			}
+
+			RcuReadLockGuard(const RcuReadLockGuard&) = delete;
+			RcuReadLockGuard& operator=(const RcuReadLockGuard&) = delete;
+
+		private:
+			RcuThread& self_;
+		};
+
+	}
+
+}
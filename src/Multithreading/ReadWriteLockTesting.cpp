@@ -13,6 +13,8 @@
 #include <queue>
 #include <atomic>
 #include <utility>
+#include <algorithm>
+#include <type_traits>
 #include <typeinfo>
 
 #include "MM_UnitTestFramework/MM_UnitTestFramework.h"
@@ -46,6 +48,17 @@
 #include "ReadWriteLock_WritePref_LockFree_v2.h"
 #include "ReadWriteLock_WritePref_LockFree_v3.h"
 #include "ReadWriteLock_WritePref_LockFree_v4.h"
+#include "ReadWriteLock_WritePref_BigReader_v1.h"
+#include "ReadWriteLock_WritePref_SNZI_v1.h"
+#include "ReadWriteLock_PhaseFair_v1.h"
+#include "ReadWriteLock_Futex_v1.h"
+#include "ReadWriteLock_WritePref_Cohort_v1.h"
+#include "ReadWriteLock_Upgradeable_v1.h"
+#include "ReadWriteLock_Bravo_v1.h"
+
+#include "Rcu_QSBR_v1.h"
+#include "FlatCombining_v1.h"
+#include "ProfiledLock.h"
 
 namespace mm {
 
@@ -151,12 +164,134 @@ namespace mm {
 				return retVal;
 			}
 
+			const LockType& getLock() const
+			{
+				return lock_;
+			}
+
 		private:
 			std::queue<ObjectType> buffer_;
 			std::unique_ptr<size_t> size_; //Intentionally keeping unique_ptr so that write op will change the memory location
 			LockType lock_;
 		};
 
+		//Samples of the time taken by acquireReadLock() and acquireWriteLock(), collected per thread.
+		//A thread which wants its samples sets getCurrent() to its own AcquireLatencySamples, the other threads are not sampled.
+		struct AcquireLatencySamples
+		{
+			static AcquireLatencySamples*& getCurrent()
+			{
+				thread_local AcquireLatencySamples* current = nullptr;
+				return current;
+			}
+
+			static constexpr const size_t samplingInterval = 16; //every 16th acquire is timed, to keep the clock out of the measurement
+
+			size_t numReadAcquires{ 0 };
+			size_t numWriteAcquires{ 0 };
+			std::vector<long long> readNs;
+			std::vector<long long> writeNs;
+		};
+
+		template<typename LockType>
+		class LatencySampledLock
+		{
+		public:
+			void acquireReadLock()
+			{
+				AcquireLatencySamples* samples = AcquireLatencySamples::getCurrent();
+				if (samples == nullptr || samples->numReadAcquires++ % AcquireLatencySamples::samplingInterval != 0)
+				{
+					lock_.acquireReadLock();
+					return;
+				}
+
+				std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				lock_.acquireReadLock();
+				samples->readNs.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+			}
+
+			void releaseReadLock()
+			{
+				lock_.releaseReadLock();
+			}
+
+			void acquireWriteLock()
+			{
+				AcquireLatencySamples* samples = AcquireLatencySamples::getCurrent();
+				if (samples == nullptr || samples->numWriteAcquires++ % AcquireLatencySamples::samplingInterval != 0)
+				{
+					lock_.acquireWriteLock();
+					return;
+				}
+
+				std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				lock_.acquireWriteLock();
+				samples->writeNs.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+			}
+
+			void releaseWriteLock()
+			{
+				lock_.releaseWriteLock();
+			}
+
+			const LockType& getLock() const
+			{
+				return lock_;
+			}
+
+		private:
+			LockType lock_;
+		};
+
+		//The locks with a spin policy (see SpinPolicy.h) report how often the acquirers spun and how often they parked, separately for the readers and the writers
+		template<typename LockType, typename = void>
+		struct has_spin_policy_stats : std::false_type
+		{
+			static SpinPolicyStats getReader(const LockType&) { return SpinPolicyStats{}; }
+			static SpinPolicyStats getWriter(const LockType&) { return SpinPolicyStats{}; }
+		};
+
+		template<typename LockType>
+		struct has_spin_policy_stats<LockType, decltype(std::declval<const LockType&>().getReaderSpinPolicy().getStats(), void())>
+			: std::integral_constant<bool, !std::is_same<typename std::decay<decltype(std::declval<const LockType&>().getReaderSpinPolicy())>::type, NoSpinPolicy>::value>
+		{
+			static SpinPolicyStats getReader(const LockType& lock) { return lock.getReaderSpinPolicy().getStats(); }
+			static SpinPolicyStats getWriter(const LockType& lock) { return lock.getWriterSpinPolicy().getStats(); }
+		};
+
+		//The lock without the profiler around it (ProfiledLock<LockType> is LockType itself if MM_ENABLE_LOCK_PROFILING is not defined)
+		template<typename LockType>
+		const LockType& getUnprofiledLock(const LockType& lock)
+		{
+			return lock;
+		}
+
+#if defined(MM_ENABLE_LOCK_PROFILING)
+		template<typename LockType>
+		const LockType& getUnprofiledLock(const ProfiledLock<LockType>& lock)
+		{
+			return lock.getLock();
+		}
+#endif
+
+		std::string getLatencyPercentiles(std::vector<long long>& samples)
+		{
+			if (samples.empty())
+				return "no samples";
+
+			std::sort(samples.begin(), samples.end());
+			auto percentile = [&samples](double p) { return samples[static_cast<size_t>(p * (samples.size() - 1))]; };
+
+			std::stringstream ss;
+			ss.imbue(std::locale{ "" });
+			ss << "p50: " << std::setw(10) << percentile(0.5)
+				<< " p99: " << std::setw(12) << percentile(0.99)
+				<< " p99.9: " << std::setw(12) << percentile(0.999)
+				<< " max: " << std::setw(14) << samples.back() << " ns";
+			return ss.str();
+		}
+
 		enum class Operations
 		{
 			push,
@@ -171,7 +306,10 @@ namespace mm {
 			std::mt19937 mt(rd());
 			std::uniform_int_distribution<int> dist(1, 100);
 
-			auto threadFunPushPop = [](ThreadSafeQueue<Object, LockType>& tsq, int iterations) {
+			using QueueType = ThreadSafeQueue<Object, LatencySampledLock<ProfiledLock<LockType>>>;
+
+			auto threadFunPushPop = [](QueueType& tsq, int iterations, AcquireLatencySamples& samples) {
+				AcquireLatencySamples::getCurrent() = &samples;
 				for (size_t i = 1; i <= iterations; ++i)
 				{
 					//First strategy - does not work well
@@ -194,7 +332,8 @@ namespace mm {
 				}
 			};
 
-			auto threadFunFront = [](ThreadSafeQueue<Object, LockType>& tsq, int iterations, std::atomic<size_t>& totalSum) {
+			auto threadFunFront = [](QueueType& tsq, int iterations, std::atomic<size_t>& totalSum, AcquireLatencySamples& samples) {
+				AcquireLatencySamples::getCurrent() = &samples;
 				for (int i = 0; i < iterations; ++i)
 				{
 					//if (tsq.empty())
@@ -236,23 +375,25 @@ namespace mm {
 			//constexpr const int iterations = 1'000'000;
 			constexpr const int iterations = 100'000;
 			constexpr const int numWriters = 50;
-			ThreadSafeQueue<Object, LockType> tsq;
+			QueueType tsq;
 
 			std::vector<std::thread> writers;
 			writers.reserve(numWriters);
+			std::vector<AcquireLatencySamples> writerSamples(numWriters);
 			for (int i = 0; i < numWriters; ++i)
 			{
-				writers.push_back(std::thread{ threadFunPushPop, std::ref(tsq), iterations });
+				writers.push_back(std::thread{ threadFunPushPop, std::ref(tsq), iterations, std::ref(writerSamples[i]) });
 			}
 
 			constexpr const int numReaders = 50;
 			std::vector<std::thread> readers;
 			readers.reserve(numReaders);
+			std::vector<AcquireLatencySamples> readerSamples(numReaders);
 			std::atomic<size_t> totalSum = 0;
 			tsq.push(Object{ 0 }); //Push one object to be on safer side in case writers lag behind and reader threads start executing first
 			for (int i = 0; i < numReaders; ++i)
 			{
-				readers.push_back(std::thread{ threadFunFront, std::ref(tsq), iterations, std::ref(totalSum) });
+				readers.push_back(std::thread{ threadFunFront, std::ref(tsq), iterations, std::ref(totalSum), std::ref(readerSamples[i]) });
 			}
 
 			for (int i = 0; i < writers.size(); ++i)
@@ -274,6 +415,37 @@ namespace mm {
 				//<< " emptyCount: " << std::setw(6) << emptyCount
 				;
 
+			//Writer threads acquire the read lock too (empty() in pop()), so each side is reported by the kind of lock, not by the kind of thread
+			std::vector<long long> readNs;
+			std::vector<long long> writeNs;
+			for (std::vector<AcquireLatencySamples>* samples : { &writerSamples, &readerSamples })
+			{
+				for (AcquireLatencySamples& s : *samples)
+				{
+					readNs.insert(readNs.end(), s.readNs.begin(), s.readNs.end());
+					writeNs.insert(writeNs.end(), s.writeNs.begin(), s.writeNs.end());
+				}
+			}
+			std::cout << "\n" << std::setw(40) << "" << "  acquireReadLock  " << getLatencyPercentiles(readNs)
+				<< "\n" << std::setw(40) << "" << "  acquireWriteLock " << getLatencyPercentiles(writeNs);
+
+			if (has_spin_policy_stats<LockType>::value)
+			{
+				const LockType& lock = getUnprofiledLock(tsq.getLock().getLock());
+				auto printSpinStats = [](const char* side, const SpinPolicyStats& stats) {
+					std::cout << "\n" << std::setw(40) << "" << "  " << side << " spin acquires: " << stats.spinAcquires
+						<< "   parked acquires: " << stats.parkedAcquires
+						<< "   spin iterations: " << stats.spinIterations
+						<< "   spin limit: " << stats.spinLimit;
+				};
+				printSpinStats("reader", has_spin_policy_stats<LockType>::getReader(lock));
+				printSpinStats("writer", has_spin_policy_stats<LockType>::getWriter(lock));
+			}
+
+#if defined(MM_ENABLE_LOCK_PROFILING)
+			std::cout << tsq.getLock().getLock().report(std::string(42, ' '));
+#endif
+
 			return totalSum;
 		}
 
@@ -394,12 +566,134 @@ namespace mm {
 				readWriteLock_.releaseWriteLock();
 			}
 
+			//Same as set(), but takes the write lock only if the value is different. Returns true if it has changed the value.
+			//ReadWriteLockType must support the upgrade lock (see ReadWriteLock_Upgradeable_v1.h).
+			bool setIfChanged(const std::string& str, int n, ThreadInfo& ti)
+			{
+				readWriteLock_.acquireUpgradeLock();
+				auto it = data_.find(str);
+				if (it != data_.end() && it->second == n)
+				{
+					readWriteLock_.releaseUpgradeLock();
+					return false;
+				}
+
+				readWriteLock_.upgradeToWriteLock();
+				size_.reset();
+
+				//wait on cv
+				ti.pause();
+
+				data_[str] = n;
+				size_ = std::make_unique<size_t>(data_.size());
+				readWriteLock_.releaseWriteLock();
+				return true;
+			}
+
 		private:
 			ReadWriteLockType readWriteLock_;
 			std::unordered_map<std::string, int> data_;
 			std::unique_ptr<size_t> size_{ std::make_unique<size_t>(data_.size()) }; //Intentionally keeping unique_ptr so that write op will change the memory location
 		};
 
+		//Same hash map protected by a read-write lock, without the pauses of ThreadsafeHashMap. Used to compare with RcuThreadsafeHashMap.
+		template<typename ReadWriteLockType>
+		class RwLockThreadsafeHashMap
+		{
+		public:
+			explicit RwLockThreadsafeHashMap(std::unordered_map<std::string, int> data)
+				: data_{ std::move(data) }
+			{
+			}
+
+			int get(const std::string& str)
+			{
+				readWriteLock_.acquireReadLock();
+				auto it = data_.find(str);
+				int retVal = it != data_.end() ? it->second : -1;
+				readWriteLock_.releaseReadLock();
+
+				return retVal;
+			}
+
+			void set(const std::string& str, int n)
+			{
+				readWriteLock_.acquireWriteLock();
+				data_[str] = n;
+				readWriteLock_.releaseWriteLock();
+			}
+
+			//Takes the write lock only if the value is different, see ThreadsafeHashMap::setIfChanged()
+			bool setIfChanged(const std::string& str, int n)
+			{
+				readWriteLock_.acquireUpgradeLock();
+				auto it = data_.find(str);
+				if (it != data_.end() && it->second == n)
+				{
+					readWriteLock_.releaseUpgradeLock();
+					return false;
+				}
+
+				readWriteLock_.upgradeToWriteLock();
+				data_[str] = n;
+				readWriteLock_.releaseWriteLock();
+				return true;
+			}
+
+		private:
+			ReadWriteLockType readWriteLock_;
+			std::unordered_map<std::string, int> data_;
+		};
+
+		//RCU protected hash map (see Rcu_QSBR_v1.h), for read mostly data like routing tables.
+		//get() is one acquire load of the pointer and the lookup: no lock, no atomic RMW, it does not write any shared cache line.
+		//set() copies the whole map, modifies the copy and publishes it. The old copy is freed after a grace period (batched by callRcu()).
+		//The calling thread must be registered in the domain (RcuThread) and must call quiescentState() regularly when it is not inside get().
+		class RcuThreadsafeHashMap
+		{
+		public:
+			using Map = std::unordered_map<std::string, int>;
+
+			explicit RcuThreadsafeHashMap(Map data)
+				: data_a{ new Map{ std::move(data) } }
+			{
+			}
+
+			//No thread may use the map anymore. The old copies are freed by the domain.
+			~RcuThreadsafeHashMap()
+			{
+				delete data_a.load(std::memory_order_relaxed);
+			}
+
+			RcuThreadsafeHashMap(const RcuThreadsafeHashMap&) = delete;
+			RcuThreadsafeHashMap& operator=(const RcuThreadsafeHashMap&) = delete;
+
+			int get(const std::string& str, rcu_QSBR_v1::RcuThread& self) const
+			{
+				rcu_QSBR_v1::RcuReadLockGuard guard{ self };
+				const Map* data = data_a.load(std::memory_order_acquire);
+				auto it = data->find(str);
+				return it != data->end() ? it->second : -1;
+			}
+
+			void set(const std::string& str, int n, rcu_QSBR_v1::RcuThread& self)
+			{
+				const Map* oldData = nullptr;
+				{
+					std::lock_guard<std::mutex> lock{ writerMutex_ }; //writers are serialized, each one copies the latest version
+					std::unique_ptr<Map> newData{ new Map{ *data_a.load(std::memory_order_relaxed) } };
+					(*newData)[str] = n;
+					oldData = data_a.exchange(newData.release(), std::memory_order_release);
+				}
+
+				self.callRcu([oldData]() { delete oldData; });
+			}
+
+		private:
+			std::mutex writerMutex_;
+			std::atomic<const Map*> data_a;
+		};
+
 		template<typename ReadWriteLockType>
 		class Thread
 		{
@@ -749,60 +1043,683 @@ namespace mm {
 			}
 		};
 		
+		using AllReadWriteLockTypes = std::tuple<
+			readWriteLock_stdMutex_v1::ReadWriteLock, 
+			readWriteLock_stdSharedMutex_v1::ReadWriteLock,
+
+			//THESE ARE NOT REALLY READ-WRITE LOCKs, but based on their behavior, we can say these are no preferrence read/write locks.
+			//These are added just to demonstrate the lock free synchronization.
+			///readWriteLock_LockFree_v1::ReadWriteLock,  //This is without thread::yield() and so takes lot of time
+			readWriteLock_LockFree_v2::ReadWriteLock,
+			readWriteLock_LockFree_v3::ReadWriteLock,
+
+			//No peferrence
+			readWriteLock_NoPref_v1::ReadWriteLock<>,
+			readWriteLock_NoPref_v2::ReadWriteLock<>,
+			readWriteLock_NoPref_v3::ReadWriteLock<>,
+			readWriteLock_NoPref_v4::ReadWriteLock<>,
+
+			readWriteLock_NoPref_LockFree_v1::ReadWriteLock,
+			readWriteLock_NoPref_LockFree_v2::ReadWriteLock,
+			readWriteLock_NoPref_LockFree_v3::ReadWriteLock,
+			//readWriteLock_NoPref_LockFree_v4_1::ReadWriteLock,  /*FIX ME*/
+			//readWriteLock_NoPref_LockFree_v4_2::ReadWriteLock,  /*FIX ME*/
+			//readWriteLock_NoPref_LockFree_v4_3::ReadWriteLock,  /*FIX ME*/
+			//readWriteLock_NoPref_LockFree_v4_4::ReadWriteLock,  /*FIX ME*/
+
+			//Read Preferrence
+			readWriteLock_ReadPref_v1::ReadWriteLock<>,
+			readWriteLock_ReadPref_v2::ReadWriteLock<>,
+			readWriteLock_ReadPref_v3::ReadWriteLock<>,
+
+			readWriteLock_ReadPref_LockFree_v1::ReadWriteLock,
+			readWriteLock_ReadPref_LockFree_v2::ReadWriteLock,
+			readWriteLock_ReadPref_LockFree_v3::ReadWriteLock,
+			//readWriteLock_ReadPref_LockFree_v4::ReadWriteLock,  /*FIX ME*/
+
+			//Write Preferrence
+			readWriteLock_WritePref_v1::ReadWriteLock<>,
+			readWriteLock_WritePref_v2::ReadWriteLock<>,
+			readWriteLock_WritePref_v3::ReadWriteLock<>,
+
+			readWriteLock_WritePref_LockFree_v1::ReadWriteLock,
+			readWriteLock_WritePref_LockFree_v2::ReadWriteLock,
+			readWriteLock_WritePref_LockFree_v3::ReadWriteLock,
+			//readWriteLock_WritePref_LockFree_v4::ReadWriteLock,   /*FIX ME*/
+
+			//Per thread reader slots, readers do not share any cache line
+			readWriteLock_WritePref_BigReader_v1::ReadWriteLock,
+			//SNZI tree reader indicator, writers check only the root
+			readWriteLock_WritePref_SNZI_v1::ReadWriteLock,
+
+			//Phase fair: reader and writer phases alternate, neither side starves
+			readWriteLock_PhaseFair_v1::ReadWriteLock,
+
+			//One state word, waiters block in the kernel (futex) instead of yield spinning
+			readWriteLock_WritePref_Futex_v1::ReadWriteLock,
+			readWriteLock_NoPref_Futex_v1::ReadWriteLock,
+
+			//NUMA-aware: per node reader counters, writers serialize by a cohort lock (see NumaTopology.h)
+			readWriteLock_WritePref_Cohort_v1::ReadWriteLock,
+
+			//The blocking locks again, spinning with exponential backoff before they park (see SpinPolicy.h)
+			readWriteLock_NoPref_v1::ReadWriteLock<AdaptiveSpinPolicy>,
+			readWriteLock_NoPref_v2::ReadWriteLock<AdaptiveSpinPolicy>,
+			readWriteLock_NoPref_v3::ReadWriteLock<AdaptiveSpinPolicy>,
+			readWriteLock_NoPref_v4::ReadWriteLock<AdaptiveSpinPolicy>,
+			readWriteLock_ReadPref_v1::ReadWriteLock<AdaptiveSpinPolicy>,
+			readWriteLock_ReadPref_v2::ReadWriteLock<AdaptiveSpinPolicy>,
+			readWriteLock_ReadPref_v3::ReadWriteLock<AdaptiveSpinPolicy>,
+			readWriteLock_WritePref_v1::ReadWriteLock<AdaptiveSpinPolicy>,
+			readWriteLock_WritePref_v2::ReadWriteLock<AdaptiveSpinPolicy>,
+			readWriteLock_WritePref_v3::ReadWriteLock<AdaptiveSpinPolicy>
+		>;
+
+		//std::tuple<L...> -> std::tuple<readWriteLock_Bravo_v1::ReadWriteLock<L>...>
+		template <typename T>
+		struct WrapInBravo;
 
-		void testAllReadWriteLocks()
+		template <typename... Ts>
+		struct WrapInBravo< std::tuple<Ts...> >
 		{
-			using LockTypes = std::tuple<
-				readWriteLock_stdMutex_v1::ReadWriteLock, 
-				readWriteLock_stdSharedMutex_v1::ReadWriteLock,
-
-				//THESE ARE NOT REALLY READ-WRITE LOCKs, but based on their behavior, we can say these are no preferrence read/write locks.
-				//These are added just to demonstrate the lock free synchronization.
-				///readWriteLock_LockFree_v1::ReadWriteLock,  //This is without thread::yield() and so takes lot of time
-				readWriteLock_LockFree_v2::ReadWriteLock,
-				readWriteLock_LockFree_v3::ReadWriteLock,
-
-				//No peferrence
-				readWriteLock_NoPref_v1::ReadWriteLock,
-				readWriteLock_NoPref_v2::ReadWriteLock,
-				readWriteLock_NoPref_v3::ReadWriteLock,
-				readWriteLock_NoPref_v4::ReadWriteLock,
-
-				readWriteLock_NoPref_LockFree_v1::ReadWriteLock,
-				readWriteLock_NoPref_LockFree_v2::ReadWriteLock,
-				readWriteLock_NoPref_LockFree_v3::ReadWriteLock,
-				//readWriteLock_NoPref_LockFree_v4_1::ReadWriteLock,  /*FIX ME*/
-				//readWriteLock_NoPref_LockFree_v4_2::ReadWriteLock,  /*FIX ME*/
-				//readWriteLock_NoPref_LockFree_v4_3::ReadWriteLock,  /*FIX ME*/
-				//readWriteLock_NoPref_LockFree_v4_4::ReadWriteLock,  /*FIX ME*/
-
-				//Read Preferrence
-				readWriteLock_ReadPref_v1::ReadWriteLock,
-				readWriteLock_ReadPref_v2::ReadWriteLock,
-				readWriteLock_ReadPref_v3::ReadWriteLock,
-
-				readWriteLock_ReadPref_LockFree_v1::ReadWriteLock,
-				readWriteLock_ReadPref_LockFree_v2::ReadWriteLock,
-				readWriteLock_ReadPref_LockFree_v3::ReadWriteLock,
-				//readWriteLock_ReadPref_LockFree_v4::ReadWriteLock,  /*FIX ME*/
-
-				//Write Preferrence
-				readWriteLock_WritePref_v1::ReadWriteLock,
-				readWriteLock_WritePref_v2::ReadWriteLock,
-				readWriteLock_WritePref_v3::ReadWriteLock,
-
-				readWriteLock_WritePref_LockFree_v1::ReadWriteLock,
-				readWriteLock_WritePref_LockFree_v2::ReadWriteLock,
-				readWriteLock_WritePref_LockFree_v3::ReadWriteLock
-				//readWriteLock_WritePref_LockFree_v4::ReadWriteLock   /*FIX ME*/
-			>;
+			using type = std::tuple<readWriteLock_Bravo_v1::ReadWriteLock<Ts>...>;
+		};
+
+		using AllBravoReadWriteLockTypes = typename WrapInBravo<AllReadWriteLockTypes>::type;
 
+		void testAllReadWriteLocks()
+		{
 			std::cout << "\n\n----testAllReadWriteLocks (faster the readers, sum will be minimum) ----\n";
-			testReadWriteLockPerformanceHelper<LockTypes>::call();
+			testReadWriteLockPerformanceHelper<AllReadWriteLockTypes>::call();
 
 			std::cout << "\n\n----testAllReadWriteLocksInSteps----\n";
-			testAllPermutationsOfOperationsHelper<LockTypes>::call();
+			testAllPermutationsOfOperationsHelper<AllReadWriteLockTypes>::call();
+		}
+	}
+
+	namespace readWriteLockTesting {
+
+		//Read mostly hash map: numReaders threads call get() as fast as they can, one writer calls set() once per millisecond.
+		//readerFun(threadIndex, stop) and writerFun(stop) return the number of operations done.
+		template<typename ReaderFun, typename WriterFun>
+		void testReadMostlyHashMap(const std::string& msg, size_t numReaders, ReaderFun readerFun, WriterFun writerFun)
+		{
+			std::atomic<bool> stop{ false };
+			std::vector<size_t> numReads(numReaders, 0);
+			size_t numWrites = 0;
+
+			std::vector<std::thread> readers;
+			readers.reserve(numReaders);
+			for (size_t i = 0; i < numReaders; ++i)
+				readers.push_back(std::thread{ [&, i]() { numReads[i] = readerFun(i, stop); } });
+			std::thread writer{ [&]() { numWrites = writerFun(stop); } };
+
+			constexpr const int durationMs = 1000;
+			std::this_thread::sleep_for(std::chrono::milliseconds(durationMs));
+			stop.store(true);
+
+			for (std::thread& t : readers)
+				t.join();
+			writer.join();
+
+			size_t totalReads = 0;
+			for (size_t n : numReads)
+				totalReads += n;
+
+			std::cout << "\n" << std::setw(40) << msg
+				<< " reads/sec: " << std::setw(18) << totalReads * 1000 / durationMs
+				<< "   writes: " << std::setw(8) << numWrites;
+		}
+
+		void testRcuHashMap()
+		{
+			constexpr const int numKeys = 1000;
+			std::vector<std::string> keys;
+			RcuThreadsafeHashMap::Map data;
+			for (int i = 0; i < numKeys; ++i)
+			{
+				keys.push_back("route" + std::to_string(i));
+				data[keys.back()] = i;
+			}
+
+			const size_t numReaders = std::max(2u, std::thread::hardware_concurrency());
+			std::cout << "\n\n----testRcuHashMap (" << numReaders << " readers, 1 writer) ----\n";
+
+			auto writeInterval = std::chrono::milliseconds(1);
+
+			{
+				RwLockThreadsafeHashMap<readWriteLock_stdSharedMutex_v1::ReadWriteLock> map{ data };
+				testReadMostlyHashMap("readWriteLock_stdSharedMutex_v1", numReaders,
+					[&](size_t threadIndex, const std::atomic<bool>& stop) {
+						size_t count = 0;
+						for (size_t i = threadIndex; !stop.load(std::memory_order_relaxed); ++i, ++count)
+							map.get(keys[i % numKeys]);
+						return count;
+					},
+					[&](const std::atomic<bool>& stop) {
+						size_t count = 0;
+						for (; !stop.load(std::memory_order_relaxed); ++count)
+						{
+							map.set(keys[count % numKeys], static_cast<int>(count));
+							std::this_thread::sleep_for(writeInterval);
+						}
+						return count;
+					});
+			}
+
+			{
+				RwLockThreadsafeHashMap<readWriteLock_WritePref_BigReader_v1::ReadWriteLock> map{ data };
+				testReadMostlyHashMap("readWriteLock_WritePref_BigReader_v1", numReaders,
+					[&](size_t threadIndex, const std::atomic<bool>& stop) {
+						size_t count = 0;
+						for (size_t i = threadIndex; !stop.load(std::memory_order_relaxed); ++i, ++count)
+							map.get(keys[i % numKeys]);
+						return count;
+					},
+					[&](const std::atomic<bool>& stop) {
+						size_t count = 0;
+						for (; !stop.load(std::memory_order_relaxed); ++count)
+						{
+							map.set(keys[count % numKeys], static_cast<int>(count));
+							std::this_thread::sleep_for(writeInterval);
+						}
+						return count;
+					});
+			}
+
+			{
+				rcu_QSBR_v1::RcuDomain domain;
+				RcuThreadsafeHashMap map{ data };
+				testReadMostlyHashMap("rcu_QSBR_v1", numReaders,
+					[&](size_t threadIndex, const std::atomic<bool>& stop) {
+						rcu_QSBR_v1::RcuThread self{ domain };
+						size_t count = 0;
+						for (size_t i = threadIndex; !stop.load(std::memory_order_relaxed); ++i, ++count)
+						{
+							map.get(keys[i % numKeys], self);
+							if (count % 256 == 0)
+								self.quiescentState(); //does not hold any pointer to the map here
+						}
+						return count;
+					},
+					[&](const std::atomic<bool>& stop) {
+						rcu_QSBR_v1::RcuThread self{ domain };
+						size_t count = 0;
+						for (; !stop.load(std::memory_order_relaxed); ++count)
+						{
+							map.set(keys[count % numKeys], static_cast<int>(count), self);
+							self.offline(); //do not block the grace periods while sleeping
+							std::this_thread::sleep_for(writeInterval);
+							self.online();
+						}
+						return count;
+					});
+				std::cout << "   grace periods: " << domain.getGracePeriod();
+			}
+
+			std::cout << std::endl;
+		}
+	}
+
+	namespace readWriteLockTesting {
+
+		//Check-then-modify: numUpdaters threads update random keys, 95% of the updates write the value which is already there (no-op)
+		//and 5% write a new value. numReaders threads call get() at the same time (the same number of times).
+		//set() takes the write lock for every update, setIfChanged() takes the upgrade lock. Returns true if the value has changed.
+		template<typename MapType>
+		bool update(MapType& map, const std::string& str, int n, std::false_type /*useSetIfChanged*/)
+		{
+			map.set(str, n);
+			return true;
 		}
+
+		template<typename MapType>
+		bool update(MapType& map, const std::string& str, int n, std::true_type /*useSetIfChanged*/)
+		{
+			return map.setIfChanged(str, n);
+		}
+
+		template<typename MapType, bool useSetIfChanged>
+		void testCheckThenModify(const std::string& msg)
+		{
+			constexpr const int numKeys = 1000;
+			constexpr const int numUpdaters = 4;
+			constexpr const int numReaders = 4;
+			constexpr const int iterations = 50'000;
+			constexpr const int realWritePercent = 5;
+
+			std::vector<std::string> keys;
+			std::unordered_map<std::string, int> data;
+			for (int i = 0; i < numKeys; ++i)
+			{
+				keys.push_back("key" + std::to_string(i));
+				data[keys.back()] = 0;
+			}
+			MapType map{ data };
+
+			//The value which the updaters want in the map. It changes only on a real write, so that most of the updates are no-ops.
+			std::unique_ptr<std::atomic<int>[]> wanted{ new std::atomic<int>[numKeys] };
+			for (int i = 0; i < numKeys; ++i)
+				wanted[i].store(0);
+
+			std::atomic<size_t> numChanged{ 0 };
+			auto updaterFun = [&](unsigned int seed) {
+				std::mt19937 mt(seed);
+				std::uniform_int_distribution<int> keyDist(0, numKeys - 1);
+				std::uniform_int_distribution<int> percentDist(0, 99);
+				size_t changed = 0;
+				for (int i = 0; i < iterations; ++i)
+				{
+					const int k = keyDist(mt);
+					const int value = percentDist(mt) < realWritePercent ? wanted[k].fetch_add(1) + 1 : wanted[k].load();
+					if (update(map, keys[k], value, std::integral_constant<bool, useSetIfChanged>{}))
+						++changed;
+				}
+				numChanged += changed;
+			};
+
+			auto readerFun = [&](unsigned int seed) {
+				for (int i = 0; i < iterations; ++i)
+					map.get(keys[(seed + i) % numKeys]);
+			};
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			std::vector<std::thread> readers;
+			for (int i = 0; i < numReaders; ++i)
+				readers.push_back(std::thread{ readerFun, i });
+			std::vector<std::thread> updaters;
+			for (int i = 0; i < numUpdaters; ++i)
+				updaters.push_back(std::thread{ updaterFun, i + 1 });
+			for (std::thread& t : updaters)
+				t.join();
+			for (std::thread& t : readers)
+				t.join();
+			std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+			long long duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+			std::cout << "\n" << std::setw(50) << msg
+				<< " duration: " << std::setw(18) << duration << " ns"
+				<< "   writes: " << std::setw(9) << numChanged;
+		}
+
+		template<typename BaseReadWriteLock>
+		void testCheckThenModify(const std::string& msg)
+		{
+			testCheckThenModify<RwLockThreadsafeHashMap<BaseReadWriteLock>, false>(msg + " set");
+			testCheckThenModify<RwLockThreadsafeHashMap<readWriteLock_Upgradeable_v1::ReadWriteLock<BaseReadWriteLock>>, true>(msg + " setIfChanged");
+		}
+
+		void testAllCheckThenModify()
+		{
+			std::cout << "\n\n----testCheckThenModify (95% no-op updates, 5% real writes) ----\n";
+			testCheckThenModify<readWriteLock_stdSharedMutex_v1::ReadWriteLock>("readWriteLock_stdSharedMutex_v1");
+			testCheckThenModify<readWriteLock_WritePref_v3::ReadWriteLock<>>("readWriteLock_WritePref_v3");
+			testCheckThenModify<readWriteLock_WritePref_Futex_v1::ReadWriteLock>("readWriteLock_WritePref_Futex_v1");
+			testCheckThenModify<readWriteLock_PhaseFair_v1::ReadWriteLock>("readWriteLock_PhaseFair_v1");
+			std::cout << std::endl;
+		}
+	}
+
+	namespace readWriteLockTesting {
+
+		//Request handlers which serve stale data rather than queue behind a writer: numReaders threads read by tryAcquireReadLock() and
+		//tryAcquireReadLockUntil(now + readTimeout) alternately, and skip the read if it fails. numWriters threads write all the time,
+		//by acquireWriteLock() and tryAcquireWriteLock() alternately. Prints the success rate of each kind of try.
+		template<typename ReadWriteLockType>
+		void testTryAcquireSuccessRate(const std::string& msg)
+		{
+			constexpr const int numReaders = 8;
+			constexpr const int numWriters = 2;
+			constexpr const int durationMs = 300;
+			constexpr const int workIterations = 100;
+			const std::chrono::microseconds readTimeout{ 50 };
+
+			struct TryCounts
+			{
+				size_t attempts{ 0 };
+				size_t successes{ 0 };
+				char pad[64 - 2 * sizeof(size_t)];
+
+				void add(bool success)
+				{
+					++attempts;
+					if (success)
+						++successes;
+				}
+			};
+
+			ReadWriteLockType lock;
+			std::atomic<int> data{ 0 };
+			std::atomic<bool> stop{ false };
+			std::vector<TryCounts> tryReads(numReaders);
+			std::vector<TryCounts> timedReads(numReaders);
+			std::vector<TryCounts> tryWrites(numWriters);
+
+			auto readerFun = [&](int threadIndex) {
+				while (!stop.load(std::memory_order_relaxed))
+				{
+					const bool tryAcquired = lock.tryAcquireReadLock();
+					if (tryAcquired)
+					{
+						for (int i = 0; i < workIterations; ++i)
+							data.load(std::memory_order_relaxed);
+						lock.releaseReadLock();
+					}
+					tryReads[threadIndex].add(tryAcquired);
+
+					const bool timedAcquired = lock.tryAcquireReadLockUntil(std::chrono::steady_clock::now() + readTimeout);
+					if (timedAcquired)
+					{
+						for (int i = 0; i < workIterations; ++i)
+							data.load(std::memory_order_relaxed);
+						lock.releaseReadLock();
+					}
+					timedReads[threadIndex].add(timedAcquired);
+				}
+			};
+
+			auto writerFun = [&](int threadIndex) {
+				while (!stop.load(std::memory_order_relaxed))
+				{
+					lock.acquireWriteLock();
+					for (int i = 0; i < workIterations; ++i)
+						data.fetch_add(1, std::memory_order_relaxed);
+					lock.releaseWriteLock();
+
+					const bool acquired = lock.tryAcquireWriteLock();
+					if (acquired)
+					{
+						for (int i = 0; i < workIterations; ++i)
+							data.fetch_add(1, std::memory_order_relaxed);
+						lock.releaseWriteLock();
+					}
+					tryWrites[threadIndex].add(acquired);
+				}
+			};
+
+			std::vector<std::thread> threads;
+			for (int i = 0; i < numReaders; ++i)
+				threads.push_back(std::thread{ readerFun, i });
+			for (int i = 0; i < numWriters; ++i)
+				threads.push_back(std::thread{ writerFun, i });
+			std::this_thread::sleep_for(std::chrono::milliseconds(durationMs));
+			stop.store(true);
+			for (std::thread& t : threads)
+				t.join();
+
+			auto getSuccessRate = [](const std::vector<TryCounts>& counts) {
+				size_t attempts = 0;
+				size_t successes = 0;
+				for (const TryCounts& c : counts)
+				{
+					attempts += c.attempts;
+					successes += c.successes;
+				}
+				return attempts > 0 ? 100.0 * successes / attempts : 0.0;
+			};
+
+			std::cout << "\n" << std::setw(50) << msg << std::fixed << std::setprecision(1)
+				<< "   tryAcquireReadLock: " << std::setw(5) << getSuccessRate(tryReads) << " %"
+				<< "   tryAcquireReadLockUntil(" << readTimeout.count() << " us): " << std::setw(5) << getSuccessRate(timedReads) << " %"
+				<< "   tryAcquireWriteLock: " << std::setw(5) << getSuccessRate(tryWrites) << " %";
+			std::cout.unsetf(std::ios_base::floatfield);
+		}
+
+		template <typename T>
+		struct testTryAcquireSuccessRateHelper
+		{
+			static void call() {}
+		};
+
+		template <typename T, typename... Ts>
+		struct testTryAcquireSuccessRateHelper< std::tuple<T, Ts...> >
+		{
+			static void call()
+			{
+				std::string typeName{ typeid(T).name() };
+				typeName = typeName.substr(typeName.find_first_of("::") + 2);
+				typeName = typeName.substr(0, typeName.find_last_of("::"));
+
+				testTryAcquireSuccessRate<T>(typeName);
+				testTryAcquireSuccessRateHelper<std::tuple<Ts...>>::call();
+			}
+		};
+	}
+
+	namespace readWriteLockTesting {
+
+		//Same interface as ThreadSafeQueue, but the operations are applied by a combiner in batches instead of being serialized by a lock.
+		//front() returns a copy: the combiner may pop the object as soon as the batch is over.
+		template<typename ObjectType>
+		class FlatCombiningQueue
+		{
+		public:
+			void push(ObjectType&& obj)
+			{
+				fc_.apply([&obj](std::queue<ObjectType>& buffer) { buffer.push(std::move(obj)); });
+			}
+
+			void pop()
+			{
+				fc_.apply([](std::queue<ObjectType>& buffer) {
+					if (buffer.empty())
+						throw std::runtime_error{ "Queue underflow" };
+					buffer.pop();
+				});
+			}
+
+			ObjectType front()
+			{
+				return fc_.apply([](std::queue<ObjectType>& buffer) {
+					if (buffer.empty())
+						throw std::runtime_error{ "Queue underflow" };
+					return buffer.front();
+				});
+			}
+
+			bool empty()
+			{
+				return fc_.apply([](std::queue<ObjectType>& buffer) { return buffer.empty(); });
+			}
+
+			flatCombining_v1::FlatCombiningStats getStats() const
+			{
+				return fc_.getStats();
+			}
+
+		private:
+			flatCombining_v1::FlatCombining<std::queue<ObjectType>> fc_;
+		};
+
+		inline std::string getBatchStats(const flatCombining_v1::FlatCombiningStats& stats)
+		{
+			std::stringstream ss;
+			ss << "   batches: " << std::setw(9) << stats.numBatches
+				<< "   average batch size: " << std::setw(6) << std::fixed << std::setprecision(2)
+				<< (stats.numBatches > 0 ? static_cast<double>(stats.numOperations) / stats.numBatches : 0.0);
+			return ss.str();
+		}
+
+		template<typename QueueType>
+		std::string getBatchStats(QueueType&)
+		{
+			return "";
+		}
+
+		template<typename ObjectType>
+		std::string getBatchStats(FlatCombiningQueue<ObjectType>& queue)
+		{
+			return getBatchStats(queue.getStats());
+		}
+
+		//The workload of testReadWriteLockPerformance (numWriters threads push() and pop(), numReaders threads front()),
+		//without the latency sampling, so that the lock based ThreadSafeQueue and FlatCombiningQueue can be compared.
+		template<typename QueueType>
+		void testQueueThroughput(const std::string& msg)
+		{
+			constexpr const int iterations = 20'000;
+			constexpr const int numWriters = 50;
+			constexpr const int numReaders = 50;
+
+			QueueType queue;
+			queue.push(Object{ 0 }); //Keeps the queue non-empty for the readers, every writer pops only what it has pushed before
+
+			std::atomic<size_t> totalSum{ 0 };
+			auto threadFunPushPop = [&queue]() {
+				for (size_t i = 1; i <= iterations; ++i)
+				{
+					queue.push(Object{ i });
+					queue.pop();
+				}
+			};
+			auto threadFunFront = [&queue, &totalSum]() {
+				size_t sum = 0;
+				for (int i = 0; i < iterations; ++i)
+				{
+					Object obj = queue.front();
+					sum += obj.getSum();
+				}
+				totalSum += sum;
+			};
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			std::vector<std::thread> threads;
+			for (int i = 0; i < numWriters; ++i)
+				threads.push_back(std::thread{ threadFunPushPop });
+			for (int i = 0; i < numReaders; ++i)
+				threads.push_back(std::thread{ threadFunFront });
+			for (std::thread& t : threads)
+				t.join();
+			std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+			long long duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+			std::cout << "\n" << std::setw(50) << msg
+				<< " duration: " << std::setw(18) << duration << " ns"
+				<< "   totalSum: " << std::setw(18) << totalSum
+				<< getBatchStats(queue);
+		}
+
+		//numThreads threads apply operation(container, threadIndex, i) iterations times each, either under a std::mutex or through FlatCombining.
+		//Prints check(container) at the end, which must be the same for both.
+		template<typename Container, typename Operation, typename Check>
+		void testMutexVsFlatCombining(const std::string& msg, Operation operation, Check check)
+		{
+			constexpr const int iterations = 20'000;
+			constexpr const int numThreads = 50;
+
+			auto run = [](std::function<void(int)> threadFun) {
+				std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				std::vector<std::thread> threads;
+				for (int i = 0; i < numThreads; ++i)
+					threads.push_back(std::thread{ threadFun, i });
+				for (std::thread& t : threads)
+					t.join();
+				return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+			};
+
+			Container container;
+			std::mutex mutex;
+			const long long mutexDuration = run([&](int threadIndex) {
+				for (int i = 0; i < iterations; ++i)
+				{
+					std::lock_guard<std::mutex> lock{ mutex };
+					operation(container, threadIndex, i);
+				}
+			});
+			std::cout << "\n" << std::setw(50) << msg + " std::mutex"
+				<< " duration: " << std::setw(18) << mutexDuration << " ns"
+				<< "   check: " << std::setw(12) << check(container);
+
+			flatCombining_v1::FlatCombining<Container> fc;
+			const long long fcDuration = run([&](int threadIndex) {
+				for (int i = 0; i < iterations; ++i)
+					fc.apply([&](Container& c) { operation(c, threadIndex, i); });
+			});
+			std::cout << "\n" << std::setw(50) << msg + " flatCombining_v1"
+				<< " duration: " << std::setw(18) << fcDuration << " ns"
+				<< "   check: " << std::setw(12) << check(fc.getUnsafe())
+				<< getBatchStats(fc.getStats());
+		}
+
+		void testAllFlatCombining()
+		{
+			std::cout << "\n\n----testQueueThroughput (50 threads push() + pop(), 50 threads front()) ----\n";
+			testQueueThroughput<ThreadSafeQueue<Object, readWriteLock_stdMutex_v1::ReadWriteLock>>("ThreadSafeQueue readWriteLock_stdMutex_v1");
+			testQueueThroughput<ThreadSafeQueue<Object, readWriteLock_stdSharedMutex_v1::ReadWriteLock>>("ThreadSafeQueue readWriteLock_stdSharedMutex_v1");
+			testQueueThroughput<ThreadSafeQueue<Object, readWriteLock_WritePref_Futex_v1::ReadWriteLock>>("ThreadSafeQueue readWriteLock_WritePref_Futex_v1");
+			testQueueThroughput<ThreadSafeQueue<Object, readWriteLock_PhaseFair_v1::ReadWriteLock>>("ThreadSafeQueue readWriteLock_PhaseFair_v1");
+			testQueueThroughput<FlatCombiningQueue<Object>>("FlatCombiningQueue");
+
+			std::cout << "\n\n----testMutexVsFlatCombining (50 threads) ----\n";
+			testMutexVsFlatCombining<std::priority_queue<size_t>>("priority_queue push() + pop()",
+				[](std::priority_queue<size_t>& pq, int threadIndex, int i) {
+					pq.push(static_cast<size_t>(threadIndex) * i);
+					if (i % 2 == 1)
+						pq.pop();
+				},
+				[](std::priority_queue<size_t>& pq) { return pq.size(); });
+			testMutexVsFlatCombining<std::unordered_map<int, size_t>>("unordered_map ++map[key]",
+				[](std::unordered_map<int, size_t>& map, int threadIndex, int i) {
+					++map[(threadIndex * 7919 + i) % 1000];
+				},
+				[](std::unordered_map<int, size_t>& map) {
+					size_t total = 0;
+					for (const auto& entry : map)
+						total += entry.second;
+					return total;
+				});
+			std::cout << std::endl;
+		}
+	}
+
+	MM_DECLARE_FLAG(ReadWriteLock_Bravo);
+
+	MM_UNIT_TEST(ReadWriteLock_Bravo_Test, ReadWriteLock_Bravo)
+	{
+		std::cout.imbue(std::locale{ "" });
+
+		std::cout << "\n\n----testAllReadWriteLocks wrapped in BRAVO (readers skip the underlying lock while the read bias is on) ----\n";
+		readWriteLockTesting::testReadWriteLockPerformanceHelper<readWriteLockTesting::AllBravoReadWriteLockTypes>::call();
+
+		std::cout << "\n\n----testAllReadWriteLocksInSteps wrapped in BRAVO----\n";
+		readWriteLockTesting::testAllPermutationsOfOperationsHelper<readWriteLockTesting::AllBravoReadWriteLockTypes>::call();
+		std::cout << std::endl;
+	}
+
+	MM_DECLARE_FLAG(ReadWriteLock_FlatCombining);
+
+	MM_UNIT_TEST(ReadWriteLock_FlatCombining_Test, ReadWriteLock_FlatCombining)
+	{
+		std::cout.imbue(std::locale{ "" });
+
+		readWriteLockTesting::testAllFlatCombining();
+	}
+
+	MM_DECLARE_FLAG(ReadWriteLock_TryAcquire);
+
+	MM_UNIT_TEST(ReadWriteLock_TryAcquire_Test, ReadWriteLock_TryAcquire)
+	{
+		std::cout << "\n\n----testTryAcquireSuccessRate (readers skip the read if the try fails) ----\n";
+		readWriteLockTesting::testTryAcquireSuccessRateHelper<readWriteLockTesting::AllReadWriteLockTypes>::call();
+		std::cout << std::endl;
+	}
+
+	MM_DECLARE_FLAG(ReadWriteLock_Upgradeable);
+
+	MM_UNIT_TEST(ReadWriteLock_Upgradeable_Test, ReadWriteLock_Upgradeable)
+	{
+		std::cout.imbue(std::locale{ "" });
+
+		readWriteLockTesting::testAllCheckThenModify();
+	}
+
+	MM_DECLARE_FLAG(ReadWriteLock_RcuHashMap);
+
+	MM_UNIT_TEST(ReadWriteLock_RcuHashMap_Test, ReadWriteLock_RcuHashMap)
+	{
+		std::cout.imbue(std::locale{ "" });
+
+		readWriteLockTesting::testRcuHashMap();
 	}
 
 	MM_DECLARE_FLAG(ReadWriteLock);
@@ -0,0 +1,276 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <utility>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "MM_UnitTestFramework/MM_UnitTestFramework.h"
+#include "SpinPolicy.h"
+#include "TryLockUntil.h"
+
+/*
+BRAVO (Biased Locking for Reader-Writer Locks): a reader fast path in front of any read-write lock of this repo.
+Reference: Dice, Kogan, "BRAVO - Biased Locking for Reader-Writer Locks" (USENIX ATC 2019)
+
+Every read-write lock in this repo has some shared state which every reader modifies (a counter, a mutex, a state word), so readers on
+different cores keep taking the same cache line away from each other even when there is no writer at all.
+The big-reader, SNZI and cohort locks fix it by changing the reader indicator of the lock itself. ReadWriteLock<UnderlyingLock> fixes it for
+all of them at once, without touching their internals:
+
+Visible readers table: one global table of slots, shared by all the BRAVO locks. A slot holds the address of the lock which a reader
+holds by the fast path, or nullptr. A reader uses the slot at hash(thread, lock), so different threads mostly use different slots.
+
+readBias_ on (the default):
+	Reader: CAS its slot from nullptr to this, then check readBias_ again. If it is still on, the reader holds the read lock without
+	        touching the underlying lock at all. Otherwise (a writer is revoking the bias), or if the slot is taken by another lock or thread,
+	        it clears the slot again and takes the slow path: the read lock of the underlying lock.
+	Writer: acquires the write lock of the underlying lock, which stops the slow path readers, then revokes the bias: turns readBias_ off and
+	        waits until no slot holds this lock any more, i.e. until all the fast path readers have left.
+	The CAS and the second check of the reader, and the store and the scan of the writer are seq_cst (Dekker style, as in the big-reader lock):
+	either the reader sees readBias_ off, or the writer sees the slot of the reader.
+readBias_ off:
+	All readers and writers use the underlying lock, BRAVO costs one extra load per acquire.
+	A slow path reader turns readBias_ on again (it holds the read lock, so no writer is active) once the cool-down is over.
+	The cool-down is inhibitFactor times the time which the last revocation took, so that the writers spend at most about
+	1 / (inhibitFactor + 1) of the time on scanning the table, no matter how often they come.
+
+A writer scans the whole table (numSlots loads) when it revokes, so BRAVO pays off for read mostly locks, not for write heavy ones.
+releaseReadLock() must be called by the same thread which called acquireReadLock(): the thread remembers (thread_local) which of its read locks
+it took by the fast path.
+*/
+
+namespace mm {
+
+	namespace readWriteLock_Bravo_v1 {
+
+		class VisibleReaders
+		{
+		public:
+			enum : size_t
+			{
+				numSlots = 4096 //power of 2
+			};
+
+			using Slot = std::atomic<const void*>;
+
+			static Slot& getSlot(const void* lock)
+			{
+				thread_local const uint64_t threadId = getNextThreadId();
+				//Mix the thread and the lock (splitmix64 finalizer), so that a thread holding several locks does not use one slot for all of them
+				uint64_t hash = threadId * 0x9E3779B97F4A7C15ULL ^ reinterpret_cast<uintptr_t>(lock);
+				hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ULL;
+				hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBULL;
+				hash ^= hash >> 31;
+				return getSlots()[hash & (numSlots - 1)];
+			}
+
+			static Slot& getSlot(size_t index)
+			{
+				return getSlots()[index];
+			}
+
+			//The slots taken by the current thread, most recent last. A thread rarely holds more than one or two read locks at a time.
+			static std::vector<std::pair<const void*, Slot*>>& getFastReads()
+			{
+				thread_local std::vector<std::pair<const void*, Slot*>> fastReads;
+				return fastReads;
+			}
+
+		private:
+			static Slot* getSlots()
+			{
+				static Slot slots[numSlots] = {};
+				return slots;
+			}
+
+			static uint64_t getNextThreadId()
+			{
+				static std::atomic<uint64_t> nextThreadId{ 1 };
+				return nextThreadId.fetch_add(1, std::memory_order_relaxed);
+			}
+		};
+
+		template<typename UnderlyingLock>
+		class ReadWriteLock
+		{
+		public:
+			ReadWriteLock()
+				: readBias_{ true },
+				inhibitUntilNs_{ 0 }
+			{
+			}
+
+			ReadWriteLock(const ReadWriteLock&) = delete;
+			ReadWriteLock& operator=(const ReadWriteLock&) = delete;
+
+			void acquireReadLock()
+			{
+				if (tryFastRead())
+					return;
+
+				lock_.acquireReadLock();
+				enableBiasIfCooledDown();
+			}
+
+			void releaseReadLock()
+			{
+				std::vector<std::pair<const void*, VisibleReaders::Slot*>>& fastReads = VisibleReaders::getFastReads();
+				for (auto it = fastReads.rbegin(); it != fastReads.rend(); ++it)
+				{
+					if (it->first == this)
+					{
+						it->second->store(nullptr, std::memory_order_release);
+						fastReads.erase(std::next(it).base());
+						return;
+					}
+				}
+
+				lock_.releaseReadLock();
+			}
+
+			void acquireWriteLock()
+			{
+				lock_.acquireWriteLock();
+				if (!readBias_.load(std::memory_order_relaxed))
+					return;
+
+				const int64_t start = getNowNs();
+				readBias_.store(false, std::memory_order_seq_cst);
+				for (size_t i = 0; i < VisibleReaders::numSlots; ++i)
+				{
+					VisibleReaders::Slot& slot = VisibleReaders::getSlot(i);
+					if (slot.load(std::memory_order_seq_cst) == this)
+						spinWaitUntil([this, &slot]() { return slot.load(std::memory_order_acquire) != this; });
+				}
+				inhibitBias(start);
+			}
+
+			void releaseWriteLock()
+			{
+				lock_.releaseWriteLock();
+			}
+
+			bool tryAcquireReadLock()
+			{
+				if (tryFastRead())
+					return true;
+
+				if (!lock_.tryAcquireReadLock())
+					return false;
+				enableBiasIfCooledDown();
+				return true;
+			}
+
+			bool tryAcquireWriteLock()
+			{
+				return tryAcquireWriteLockUntil(LockDeadline{});
+			}
+
+			bool tryAcquireReadLockUntil(LockDeadline deadline)
+			{
+				if (tryFastRead())
+					return true;
+
+				if (!lock_.tryAcquireReadLockUntil(deadline))
+					return false;
+				enableBiasIfCooledDown();
+				return true;
+			}
+
+			//Gives up the underlying write lock again if the fast path readers do not leave before the deadline.
+			//The bias has to be turned on again then: some fast path readers are still inside, and a writer skips the scan while the bias is off.
+			bool tryAcquireWriteLockUntil(LockDeadline deadline)
+			{
+				if (!lock_.tryAcquireWriteLockUntil(deadline))
+					return false;
+				if (!readBias_.load(std::memory_order_relaxed))
+					return true;
+
+				const int64_t start = getNowNs();
+				readBias_.store(false, std::memory_order_seq_cst);
+				if (retryUntil(deadline, [this]() { return !hasFastReaders(); }))
+				{
+					inhibitBias(start);
+					return true;
+				}
+
+				readBias_.store(true, std::memory_order_release);
+				lock_.releaseWriteLock();
+				return false;
+			}
+
+			bool isReadBiased() const
+			{
+				return readBias_.load(std::memory_order_relaxed);
+			}
+
+		private:
+			enum : int64_t
+			{
+				inhibitFactor = 9
+			};
+
+			static int64_t getNowNs()
+			{
+				return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+			}
+
+			bool tryFastRead()
+			{
+				if (!readBias_.load(std::memory_order_acquire))
+					return false;
+
+				VisibleReaders::Slot& slot = VisibleReaders::getSlot(this);
+				const void* expected = nullptr;
+				if (!slot.compare_exchange_strong(expected, this, std::memory_order_seq_cst, std::memory_order_relaxed))
+					return false; //Taken by another reader (of this or another lock) which hashes to the same slot
+
+				if (readBias_.load(std::memory_order_seq_cst))
+				{
+					VisibleReaders::getFastReads().emplace_back(this, &slot);
+					return true;
+				}
+
+				//A writer is revoking the bias
+				slot.store(nullptr, std::memory_order_release);
+				return false;
+			}
+
+			bool hasFastReaders() const
+			{
+				for (size_t i = 0; i < VisibleReaders::numSlots; ++i)
+				{
+					if (VisibleReaders::getSlot(i).load(std::memory_order_seq_cst) == this)
+						return true;
+				}
+				return false;
+			}
+
+			//Called with the write lock held
+			void inhibitBias(int64_t revocationStart)
+			{
+				const int64_t now = getNowNs();
+				inhibitUntilNs_.store(now + (now - revocationStart) * inhibitFactor, std::memory_order_relaxed);
+			}
+
+			//Called with the read lock held, so no writer can be revoking the bias at the same time
+			void enableBiasIfCooledDown()
+			{
+				if (!readBias_.load(std::memory_order_relaxed) && getNowNs() >= inhibitUntilNs_.load(std::memory_order_relaxed))
+					readBias_.store(true, std::memory_order_release);
+			}
+
+			UnderlyingLock lock_;
+			char pad0[64];
+			std::atomic<bool> readBias_;
+			std::atomic<int64_t> inhibitUntilNs_;
+			char pad1[64 - sizeof(std::atomic<bool>) - sizeof(std::atomic<int64_t>)];
+		};
+
+	}
+
+}
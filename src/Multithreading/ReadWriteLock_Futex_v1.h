@@ -0,0 +1,316 @@
+#pragma once
+
+#include <iostream>
+#include <thread>
+#include <cstdint>
+#include <atomic>
+
+#include "MM_UnitTestFramework/MM_UnitTestFramework.h"
+#include "Futex.h"
+#include "TryLockUntil.h"
+
+/*
+Futex based read-write lock.
+The LockFree read-write locks spin with std::this_thread::yield(). With more threads than cores (50 readers + 50 writers in testReadWriteLockPerformance)
+every waiter still gets scheduled again and again only to find the lock busy. The mutex + condition variable locks do block, but every lock_shared()
+and unlock_shared() takes the mutex. Here the uncontended path is one CAS on one 32 bit word (like the LockFree locks),
+and the contended path blocks in the kernel (futex, see Futex.h) until it is woken (like the condition variable locks).
+
+state_ (32 bits):
+	bits  0..15 : number of active readers
+	bits 16..29 : number of waiting writers
+	bit  30     : a writer is active
+Wait words: the readers block on readersSeq_ and the writers on writersSeq_. A waker changes state_ first, then increments the wait word
+and wakes the threads blocked on it. A waiter reads the wait word before it re-checks state_, so if the wake comes in between,
+futexWait() returns immediately because the word has changed (no lost wakeup).
+numReadersWaiting_ tells unlock() whether any reader has to be woken (the waiting writers are counted in state_ itself).
+
+WritePref: the new readers block as soon as a writer is waiting. unlock() hands over to the next waiting writer, and wakes the readers
+           only if no writer is waiting. Readers can starve under continuous writes.
+NoPref:    the new readers block only while a writer is active. unlock() wakes all the waiting readers and one waiting writer, they race.
+*/
+
+namespace mm {
+
+	namespace readWriteLock_Futex_v1 {
+
+		template<bool writerPreferred>
+		class SharedMutex
+		{
+		public:
+			SharedMutex()
+				: state_{ 0 },
+				readersSeq_{ 0 },
+				numReadersWaiting_{ 0 },
+				writersSeq_{ 0 }
+			{
+			}
+
+			SharedMutex(const SharedMutex&) = delete;
+			SharedMutex& operator=(const SharedMutex&) = delete;
+
+			void lock_shared()
+			{
+				uint32_t state = state_.load(std::memory_order_relaxed);
+				while (true)
+				{
+					if (!isReaderBlocked(state))
+					{
+						if (getReaders(state) == maxReaders)
+						{
+							std::this_thread::yield(); //Too many readers, very rare
+							state = state_.load(std::memory_order_relaxed);
+						}
+						else if (state_.compare_exchange_weak(state, state + readerUnit, std::memory_order_acquire, std::memory_order_relaxed))
+							return;
+						continue;
+					}
+
+					const uint32_t seq = readersSeq_.load(std::memory_order_seq_cst);
+					numReadersWaiting_.fetch_add(1, std::memory_order_seq_cst);
+					state = state_.load(std::memory_order_seq_cst);
+					if (isReaderBlocked(state))
+					{
+						futexWait(readersSeq_, seq);
+						state = state_.load(std::memory_order_relaxed);
+					}
+					numReadersWaiting_.fetch_sub(1, std::memory_order_relaxed);
+				}
+			}
+
+			void unlock_shared()
+			{
+				const uint32_t state = state_.fetch_sub(readerUnit, std::memory_order_seq_cst) - readerUnit;
+				if (getReaders(state) == 0 && getWritersWaiting(state) > 0)
+					wake(writersSeq_, false); //Last reader out, let a writer in
+			}
+
+			void lock()
+			{
+				uint32_t state = 0;
+				if (state_.compare_exchange_strong(state, writerActive, std::memory_order_acquire, std::memory_order_relaxed))
+					return;
+
+				state = state_.fetch_add(writerWaitingUnit, std::memory_order_seq_cst) + writerWaitingUnit;
+				while (true)
+				{
+					if ((state & (writerActive | readersMask)) == 0)
+					{
+						if (state_.compare_exchange_weak(state, state - writerWaitingUnit + writerActive, std::memory_order_acquire, std::memory_order_relaxed))
+							return;
+						continue;
+					}
+
+					const uint32_t seq = writersSeq_.load(std::memory_order_seq_cst);
+					state = state_.load(std::memory_order_seq_cst);
+					if ((state & (writerActive | readersMask)) != 0)
+					{
+						futexWait(writersSeq_, seq);
+						state = state_.load(std::memory_order_relaxed);
+					}
+				}
+			}
+
+			void unlock()
+			{
+				const uint32_t state = state_.fetch_sub(writerActive, std::memory_order_seq_cst) - writerActive;
+				const bool writersWaiting = getWritersWaiting(state) > 0;
+				if (writersWaiting)
+					wake(writersSeq_, false);
+				if ((!writerPreferred || !writersWaiting) && numReadersWaiting_.load(std::memory_order_seq_cst) > 0)
+					wake(readersSeq_, true);
+			}
+
+			bool try_lock_shared()
+			{
+				uint32_t state = state_.load(std::memory_order_relaxed);
+				while (!isReaderBlocked(state) && getReaders(state) < maxReaders)
+				{
+					if (state_.compare_exchange_weak(state, state + readerUnit, std::memory_order_acquire, std::memory_order_relaxed))
+						return true;
+				}
+				return false;
+			}
+
+			//Same as lock_shared(), but blocks by futexWaitFor() for the time left. A waiting reader is not counted in state_, nothing to undo.
+			bool try_lock_shared_until(LockDeadline deadline)
+			{
+				uint32_t state = state_.load(std::memory_order_relaxed);
+				while (true)
+				{
+					const std::chrono::nanoseconds timeLeft = deadline - std::chrono::steady_clock::now();
+					if (!isReaderBlocked(state))
+					{
+						if (getReaders(state) == maxReaders)
+						{
+							if (timeLeft <= std::chrono::nanoseconds::zero())
+								return false;
+							std::this_thread::yield(); //Too many readers, very rare
+							state = state_.load(std::memory_order_relaxed);
+						}
+						else if (state_.compare_exchange_weak(state, state + readerUnit, std::memory_order_acquire, std::memory_order_relaxed))
+							return true;
+						continue;
+					}
+
+					if (timeLeft <= std::chrono::nanoseconds::zero())
+						return false;
+
+					const uint32_t seq = readersSeq_.load(std::memory_order_seq_cst);
+					numReadersWaiting_.fetch_add(1, std::memory_order_seq_cst);
+					state = state_.load(std::memory_order_seq_cst);
+					if (isReaderBlocked(state))
+					{
+						futexWaitFor(readersSeq_, seq, timeLeft);
+						state = state_.load(std::memory_order_relaxed);
+					}
+					numReadersWaiting_.fetch_sub(1, std::memory_order_relaxed);
+				}
+			}
+
+			bool try_lock()
+			{
+				uint32_t state = 0;
+				return state_.compare_exchange_strong(state, writerActive, std::memory_order_acquire, std::memory_order_relaxed);
+			}
+
+			//Same as lock(), but blocks by futexWaitFor() for the time left. A writer which gives up removes itself from the waiting writers.
+			bool try_lock_until(LockDeadline deadline)
+			{
+				uint32_t state = 0;
+				if (state_.compare_exchange_strong(state, writerActive, std::memory_order_acquire, std::memory_order_relaxed))
+					return true;
+
+				state = state_.fetch_add(writerWaitingUnit, std::memory_order_seq_cst) + writerWaitingUnit;
+				while (true)
+				{
+					if ((state & (writerActive | readersMask)) == 0)
+					{
+						if (state_.compare_exchange_weak(state, state - writerWaitingUnit + writerActive, std::memory_order_acquire, std::memory_order_relaxed))
+							return true;
+						continue;
+					}
+
+					const std::chrono::nanoseconds timeLeft = deadline - std::chrono::steady_clock::now();
+					if (timeLeft <= std::chrono::nanoseconds::zero())
+					{
+						stopWaitingWriter();
+						return false;
+					}
+
+					const uint32_t seq = writersSeq_.load(std::memory_order_seq_cst);
+					state = state_.load(std::memory_order_seq_cst);
+					if ((state & (writerActive | readersMask)) != 0)
+					{
+						futexWaitFor(writersSeq_, seq, timeLeft);
+						state = state_.load(std::memory_order_relaxed);
+					}
+				}
+			}
+
+		private:
+			static constexpr const uint32_t readerUnit{ 1 };
+			static constexpr const uint32_t readersMask{ 0xFFFF };
+			static constexpr const uint32_t maxReaders{ readersMask };
+			static constexpr const uint32_t writerWaitingUnit{ 1 << 16 };
+			static constexpr const uint32_t writersWaitingMask{ 0x3FFF << 16 };
+			static constexpr const uint32_t writerActive{ 1 << 30 };
+
+			static uint32_t getReaders(uint32_t state) { return state & readersMask; }
+			static uint32_t getWritersWaiting(uint32_t state) { return (state & writersWaitingMask) >> 16; }
+
+			static bool isReaderBlocked(uint32_t state)
+			{
+				return (state & writerActive) != 0 || (writerPreferred && getWritersWaiting(state) > 0);
+			}
+
+			void stopWaitingWriter()
+			{
+				const uint32_t state = state_.fetch_sub(writerWaitingUnit, std::memory_order_seq_cst) - writerWaitingUnit;
+				//It may have been woken as the next writer, pass it on
+				if (getWritersWaiting(state) > 0 && (state & (writerActive | readersMask)) == 0)
+					wake(writersSeq_, false);
+				//WritePref: the readers may be blocked only because this writer was waiting
+				if (writerPreferred && getWritersWaiting(state) == 0 && (state & writerActive) == 0 && numReadersWaiting_.load(std::memory_order_seq_cst) > 0)
+					wake(readersSeq_, true);
+			}
+
+			static void wake(std::atomic<uint32_t>& seq, bool all)
+			{
+				seq.fetch_add(1, std::memory_order_seq_cst);
+				if (all)
+					futexWakeAll(seq);
+				else
+					futexWakeOne(seq);
+			}
+
+			std::atomic<uint32_t> state_;
+			char pad0[64 - sizeof(std::atomic<uint32_t>)];
+			std::atomic<uint32_t> readersSeq_;
+			std::atomic<uint32_t> numReadersWaiting_;
+			char pad1[64 - 2 * sizeof(std::atomic<uint32_t>)];
+			std::atomic<uint32_t> writersSeq_;
+			char pad2[64 - sizeof(std::atomic<uint32_t>)];
+		};
+
+		template<bool writerPreferred>
+		class ReadWriteLock
+		{
+		public:
+			void acquireReadLock()
+			{
+				m_.lock_shared();
+			}
+
+			void releaseReadLock()
+			{
+				m_.unlock_shared();
+			}
+
+			void acquireWriteLock()
+			{
+				m_.lock();
+			}
+
+			void releaseWriteLock()
+			{
+				m_.unlock();
+			}
+
+			bool tryAcquireReadLock()
+			{
+				return m_.try_lock_shared();
+			}
+
+			bool tryAcquireWriteLock()
+			{
+				return m_.try_lock();
+			}
+
+			bool tryAcquireReadLockUntil(LockDeadline deadline)
+			{
+				return m_.try_lock_shared_until(deadline);
+			}
+
+			bool tryAcquireWriteLockUntil(LockDeadline deadline)
+			{
+				return m_.try_lock_until(deadline);
+			}
+
+		private:
+			SharedMutex<writerPreferred> m_;
+		};
+
+	}
+
+	namespace readWriteLock_WritePref_Futex_v1 {
+		using SharedMutex = readWriteLock_Futex_v1::SharedMutex<true>;
+		using ReadWriteLock = readWriteLock_Futex_v1::ReadWriteLock<true>;
+	}
+
+	namespace readWriteLock_NoPref_Futex_v1 {
+		using SharedMutex = readWriteLock_Futex_v1::SharedMutex<false>;
+		using ReadWriteLock = readWriteLock_Futex_v1::ReadWriteLock<false>;
+	}
+
+}
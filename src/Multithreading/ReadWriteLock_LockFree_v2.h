@@ -14,6 +14,7 @@
 #include <atomic>
 
 #include "MM_UnitTestFramework/MM_UnitTestFramework.h"
+#include "TryLockUntil.h"
 
 //THIS IS NOT REALLY A READ-WRITE LOCK. It's added just to demonstrate the lock free synchronization.
 
@@ -56,6 +57,29 @@ namespace mm {
 				readersOrWritterActive_.store(false, std::memory_order_release);
 			}
 
+			//One attempt. The lock free locks have nothing to block on, the timed versions retry until the deadline.
+			bool try_lock_shared()
+			{
+				bool expected = false;
+				return readersOrWritterActive_.compare_exchange_strong(expected, true, std::memory_order_seq_cst);
+			}
+
+			bool try_lock_shared_until(LockDeadline deadline)
+			{
+				return retryUntil(deadline, [this]() { return try_lock_shared(); });
+			}
+
+			bool try_lock()
+			{
+				bool expected = false;
+				return readersOrWritterActive_.compare_exchange_strong(expected, true, std::memory_order_seq_cst);
+			}
+
+			bool try_lock_until(LockDeadline deadline)
+			{
+				return retryUntil(deadline, [this]() { return try_lock(); });
+			}
+
 		private:
 			std::atomic<bool> readersOrWritterActive_{ false };
 		};
@@ -97,6 +121,26 @@ namespace mm {
 				m_.unlock();
 			}
 
+			bool tryAcquireReadLock()
+			{
+				return m_.try_lock_shared();
+			}
+
+			bool tryAcquireWriteLock()
+			{
+				return m_.try_lock();
+			}
+
+			bool tryAcquireReadLockUntil(LockDeadline deadline)
+			{
+				return m_.try_lock_shared_until(deadline);
+			}
+
+			bool tryAcquireWriteLockUntil(LockDeadline deadline)
+			{
+				return m_.try_lock_until(deadline);
+			}
+
 		private:
 			SharedMutex m_;
 		};
@@ -14,6 +14,7 @@
 #include <atomic>
 
 #include "MM_UnitTestFramework/MM_UnitTestFramework.h"
+#include "TryLockUntil.h"
 
 namespace mm {
 
@@ -57,6 +58,35 @@ namespace mm {
 				//equivalent to numReaderWriters_.fetch_sub(writerMask, std::memory_order_seq_cst);
 			}
 
+			//One attempt: the CAS is repeated only if another reader changed the count at the same time, not while a writer holds the lock.
+			//The lock free locks have nothing to block on, the timed versions retry until the deadline.
+			bool try_lock_shared()
+			{
+				FlagType expected = numActiveReadersWriters_.load(std::memory_order_acquire);
+				while (expected <= maxConcurrentReadersAllowed)
+				{
+					if (numActiveReadersWriters_.compare_exchange_weak(expected, expected + 1, std::memory_order_seq_cst))
+						return true;
+				}
+				return false;
+			}
+
+			bool try_lock_shared_until(LockDeadline deadline)
+			{
+				return retryUntil(deadline, [this]() { return try_lock_shared(); });
+			}
+
+			bool try_lock()
+			{
+				FlagType expected = 0;
+				return numActiveReadersWriters_.compare_exchange_strong(expected, writerMask, std::memory_order_seq_cst);
+			}
+
+			bool try_lock_until(LockDeadline deadline)
+			{
+				return retryUntil(deadline, [this]() { return try_lock(); });
+			}
+
 		private:
 			using FlagType = unsigned int;
 			std::atomic<FlagType> numActiveReadersWriters_{ 0 };
@@ -122,6 +152,26 @@ namespace mm {
 				m_.unlock();
 			}
 
+			bool tryAcquireReadLock()
+			{
+				return m_.try_lock_shared();
+			}
+
+			bool tryAcquireWriteLock()
+			{
+				return m_.try_lock();
+			}
+
+			bool tryAcquireReadLockUntil(LockDeadline deadline)
+			{
+				return m_.try_lock_shared_until(deadline);
+			}
+
+			bool tryAcquireWriteLockUntil(LockDeadline deadline)
+			{
+				return m_.try_lock_until(deadline);
+			}
+
 		private:
 			SharedMutex m_;
 		};
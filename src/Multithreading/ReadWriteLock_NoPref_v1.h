@@ -15,6 +15,8 @@
 #include "SemaphoreUsingConditionVariable.h"
 
 #include "MM_UnitTestFramework/MM_UnitTestFramework.h"
+#include "SpinPolicy.h"
+#include "TryLockUntil.h"
 
 //Reference: https://en.wikipedia.org/wiki/Readers%E2%80%93writers_problem
 
@@ -22,19 +24,21 @@ namespace mm {
 
 	namespace readWriteLock_NoPref_v1 {
 
+		template<typename SpinPolicy = NoSpinPolicy>
 		class SharedMutex
 		{
 		public:
 			void lock_shared()
 			{
-				serviceQueue_.P();
+				spinThenAcquire(readerSpinPolicy_, serviceQueue_);
 
-				std::unique_lock<std::mutex> lock{ mu_ };
+				std::unique_lock<std::mutex> lock{ mu_, std::defer_lock };
+				spinThenLock(readerSpinPolicy_, lock);
 
 				++numReadersActive_;
 
 				if (numReadersActive_ == 1)
-					resource_.P();
+					spinThenAcquire(readerSpinPolicy_, resource_);
 
 				serviceQueue_.V();
 
@@ -43,7 +47,8 @@ namespace mm {
 
 			void unlock_shared()
 			{
-				std::unique_lock<std::mutex> lock{ mu_ };
+				std::unique_lock<std::mutex> lock{ mu_, std::defer_lock };
+				spinThenLock(readerSpinPolicy_, lock);
 
 				--numReadersActive_;
 
@@ -55,9 +60,9 @@ namespace mm {
 
 			void lock()
 			{
-				serviceQueue_.P();
+				spinThenAcquire(writerSpinPolicy_, serviceQueue_);
 
-				resource_.P();
+				spinThenAcquire(writerSpinPolicy_, resource_);
 				
 				serviceQueue_.V();
 			}
@@ -67,7 +72,68 @@ namespace mm {
 				resource_.V();
 			}
 
+			//A deadline which has already passed makes it a single non-blocking attempt (see TryLockUntil.h)
+			bool try_lock_shared()
+			{
+				return try_lock_shared_until(LockDeadline{});
+			}
+
+			bool try_lock()
+			{
+				return try_lock_until(LockDeadline{});
+			}
+
+			bool try_lock_shared_until(LockDeadline deadline)
+			{
+				if (!serviceQueue_.try_acquire_until(deadline))
+					return false;
+
+				std::unique_lock<std::mutex> lock{ mu_, std::defer_lock };
+				if (!lockUntil(lock, deadline))
+				{
+					serviceQueue_.V();
+					return false;
+				}
+
+				++numReadersActive_;
+
+				bool acquired = true;
+				if (numReadersActive_ == 1 && !resource_.try_acquire_until(deadline))
+				{
+					--numReadersActive_;
+					acquired = false;
+				}
+
+				serviceQueue_.V();
+
+				lock.unlock();
+				return acquired;
+			}
+
+			bool try_lock_until(LockDeadline deadline)
+			{
+				if (!serviceQueue_.try_acquire_until(deadline))
+					return false;
+
+				const bool acquired = resource_.try_acquire_until(deadline);
+
+				serviceQueue_.V();
+				return acquired;
+			}
+
+			const SpinPolicy& getReaderSpinPolicy() const
+			{
+				return readerSpinPolicy_;
+			}
+
+			const SpinPolicy& getWriterSpinPolicy() const
+			{
+				return writerSpinPolicy_;
+			}
+
 		private:
+			SpinPolicy readerSpinPolicy_; //lock_shared(), unlock_shared()
+			SpinPolicy writerSpinPolicy_; //lock(), unlock()
 			std::mutex mu_;
 			SemaphoreUsingConditionVariable::SemaphoreUsingConditionVariable resource_{ 1 };
 			SemaphoreUsingConditionVariable::SemaphoreUsingConditionVariable serviceQueue_{ 1 };
@@ -89,6 +155,7 @@ namespace mm {
 		4 -    R4    W4         R4    W4		   R4    W4         R4    W4			   R4    W4         R4    W4		   R4    W4         R4    W4
 		*/
 
+		template<typename SpinPolicy = NoSpinPolicy>
 		class ReadWriteLock
 		{
 		public:
@@ -112,8 +179,38 @@ namespace mm {
 				m_.unlock();
 			}
 
+			bool tryAcquireReadLock()
+			{
+				return m_.try_lock_shared();
+			}
+
+			bool tryAcquireWriteLock()
+			{
+				return m_.try_lock();
+			}
+
+			bool tryAcquireReadLockUntil(LockDeadline deadline)
+			{
+				return m_.try_lock_shared_until(deadline);
+			}
+
+			bool tryAcquireWriteLockUntil(LockDeadline deadline)
+			{
+				return m_.try_lock_until(deadline);
+			}
+
+			const SpinPolicy& getReaderSpinPolicy() const
+			{
+				return m_.getReaderSpinPolicy();
+			}
+
+			const SpinPolicy& getWriterSpinPolicy() const
+			{
+				return m_.getWriterSpinPolicy();
+			}
+
 		private:
-			SharedMutex m_;
+			SharedMutex<SpinPolicy> m_;
 		};
 
 	}
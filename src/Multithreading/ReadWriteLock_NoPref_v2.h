@@ -15,6 +15,8 @@
 //#include "SemaphoreUsingConditionVariable.h"
 
 #include "MM_UnitTestFramework/MM_UnitTestFramework.h"
+#include "SpinPolicy.h"
+#include "TryLockUntil.h"
 
 //Reference: https://en.wikipedia.org/wiki/Readers%E2%80%93writers_problem
 
@@ -22,34 +24,45 @@ namespace mm {
 
 	namespace readWriteLock_NoPref_v2 {
 
+		template<typename SpinPolicy = NoSpinPolicy>
 		class SharedMutex
 		{
 		public:
 			void lock_shared()
 			{
 				//serviceQueue_.P();
-				std::unique_lock<std::mutex> lock(serviceQueueMu_);
-				while (serviceQueueCount_ == 0) // Handle spurious wake-ups.
-					serviceQueueCv_.wait(lock);
+				std::unique_lock<std::mutex> lock(serviceQueueMu_, std::defer_lock);
+				if (!readerSpinPolicy_.spinUntil([&]() { return tryLockIf(lock, [this]() { return serviceQueueCount_ > 0; }); }))
+				{
+					lock.lock();
+					while (serviceQueueCount_ == 0) // Handle spurious wake-ups.
+						serviceQueueCv_.wait(lock);
+				}
 				--serviceQueueCount_;
 				lock.unlock();
 
-				std::unique_lock<std::mutex> lock2{ mu_ };
+				std::unique_lock<std::mutex> lock2{ mu_, std::defer_lock };
+				spinThenLock(readerSpinPolicy_, lock2);
 
 				++numReadersActive_;
 
 				if (numReadersActive_ == 1)
 				{
 					//resource_.P();
-					std::unique_lock<std::mutex> lock3(resourceMu_);
-					while (resourceCount_ == 0) // Handle spurious wake-ups.
-						resourceCv_.wait(lock3);
+					std::unique_lock<std::mutex> lock3(resourceMu_, std::defer_lock);
+					if (!readerSpinPolicy_.spinUntil([&]() { return tryLockIf(lock3, [this]() { return resourceCount_ > 0; }); }))
+					{
+						lock3.lock();
+						while (resourceCount_ == 0) // Handle spurious wake-ups.
+							resourceCv_.wait(lock3);
+					}
 					--resourceCount_;
 					lock3.unlock();
 				}
 
 				//serviceQueue_.V();
-				std::unique_lock<std::mutex> lock4(serviceQueueMu_);
+				std::unique_lock<std::mutex> lock4(serviceQueueMu_, std::defer_lock);
+				spinThenLock(readerSpinPolicy_, lock4);
 				++serviceQueueCount_;
 				lock4.unlock();
 
@@ -60,14 +73,16 @@ namespace mm {
 
 			void unlock_shared()
 			{
-				std::unique_lock<std::mutex> lock{ mu_ };
+				std::unique_lock<std::mutex> lock{ mu_, std::defer_lock };
+				spinThenLock(readerSpinPolicy_, lock);
 
 				--numReadersActive_;
 
 				if (numReadersActive_ == 0)
 				{
 					//resource_.V();
-					std::unique_lock<std::mutex> lock2(resourceMu_);
+					std::unique_lock<std::mutex> lock2(resourceMu_, std::defer_lock);
+					spinThenLock(readerSpinPolicy_, lock2);
 					++resourceCount_;
 					lock2.unlock();
 
@@ -80,21 +95,30 @@ namespace mm {
 			void lock()
 			{
 				//serviceQueue_.P();
-				std::unique_lock<std::mutex> lock(serviceQueueMu_);
-				while (serviceQueueCount_ == 0) // Handle spurious wake-ups.
-					serviceQueueCv_.wait(lock);
+				std::unique_lock<std::mutex> lock(serviceQueueMu_, std::defer_lock);
+				if (!writerSpinPolicy_.spinUntil([&]() { return tryLockIf(lock, [this]() { return serviceQueueCount_ > 0; }); }))
+				{
+					lock.lock();
+					while (serviceQueueCount_ == 0) // Handle spurious wake-ups.
+						serviceQueueCv_.wait(lock);
+				}
 				--serviceQueueCount_;
 				lock.unlock();
 
 				//resource_.P();
-				std::unique_lock<std::mutex> lock2(resourceMu_);
-				while (resourceCount_ == 0) // Handle spurious wake-ups.
-					resourceCv_.wait(lock2);
+				std::unique_lock<std::mutex> lock2(resourceMu_, std::defer_lock);
+				if (!writerSpinPolicy_.spinUntil([&]() { return tryLockIf(lock2, [this]() { return resourceCount_ > 0; }); }))
+				{
+					lock2.lock();
+					while (resourceCount_ == 0) // Handle spurious wake-ups.
+						resourceCv_.wait(lock2);
+				}
 				--resourceCount_;
 				lock2.unlock();
 				
 				//serviceQueue_.V();
-				std::unique_lock<std::mutex> lock3(serviceQueueMu_);
+				std::unique_lock<std::mutex> lock3(serviceQueueMu_, std::defer_lock);
+				spinThenLock(writerSpinPolicy_, lock3);
 				++serviceQueueCount_;
 				lock3.unlock();
 
@@ -104,14 +128,106 @@ namespace mm {
 			void unlock()
 			{
 				//resource_.V();
-				std::unique_lock<std::mutex> lock(resourceMu_);
+				std::unique_lock<std::mutex> lock(resourceMu_, std::defer_lock);
+				spinThenLock(writerSpinPolicy_, lock);
 				++resourceCount_;
 				lock.unlock();
 
 				resourceCv_.notify_one();
 			}
 
+			//A deadline which has already passed makes it a single non-blocking attempt (see TryLockUntil.h)
+			bool try_lock_shared()
+			{
+				return try_lock_shared_until(LockDeadline{});
+			}
+
+			bool try_lock()
+			{
+				return try_lock_until(LockDeadline{});
+			}
+
+			bool try_lock_shared_until(LockDeadline deadline)
+			{
+				//serviceQueue_.try_acquire_until(deadline);
+				std::unique_lock<std::mutex> lock(serviceQueueMu_, std::defer_lock);
+				if (!lockIfUntil(lock, serviceQueueCv_, deadline, [this]() { return serviceQueueCount_ > 0; }))
+					return false;
+				--serviceQueueCount_;
+				lock.unlock();
+
+				bool acquired = true;
+				std::unique_lock<std::mutex> lock2{ mu_, std::defer_lock };
+				if (lockUntil(lock2, deadline))
+				{
+					++numReadersActive_;
+
+					if (numReadersActive_ == 1)
+					{
+						//resource_.try_acquire_until(deadline);
+						std::unique_lock<std::mutex> lock3(resourceMu_, std::defer_lock);
+						if (lockIfUntil(lock3, resourceCv_, deadline, [this]() { return resourceCount_ > 0; }))
+							--resourceCount_;
+						else
+						{
+							--numReadersActive_;
+							acquired = false;
+						}
+					}
+				}
+				else
+					acquired = false;
+
+				//serviceQueue_.V();
+				lock.lock();
+				++serviceQueueCount_;
+				lock.unlock();
+
+				serviceQueueCv_.notify_one();
+				return acquired;
+			}
+
+			bool try_lock_until(LockDeadline deadline)
+			{
+				//serviceQueue_.try_acquire_until(deadline);
+				std::unique_lock<std::mutex> lock(serviceQueueMu_, std::defer_lock);
+				if (!lockIfUntil(lock, serviceQueueCv_, deadline, [this]() { return serviceQueueCount_ > 0; }))
+					return false;
+				--serviceQueueCount_;
+				lock.unlock();
+
+				//resource_.try_acquire_until(deadline);
+				bool acquired = false;
+				std::unique_lock<std::mutex> lock2(resourceMu_, std::defer_lock);
+				if (lockIfUntil(lock2, resourceCv_, deadline, [this]() { return resourceCount_ > 0; }))
+				{
+					--resourceCount_;
+					lock2.unlock();
+					acquired = true;
+				}
+
+				//serviceQueue_.V();
+				lock.lock();
+				++serviceQueueCount_;
+				lock.unlock();
+
+				serviceQueueCv_.notify_one();
+				return acquired;
+			}
+
+			const SpinPolicy& getReaderSpinPolicy() const
+			{
+				return readerSpinPolicy_;
+			}
+
+			const SpinPolicy& getWriterSpinPolicy() const
+			{
+				return writerSpinPolicy_;
+			}
+
 		private:
+			SpinPolicy readerSpinPolicy_; //lock_shared(), unlock_shared()
+			SpinPolicy writerSpinPolicy_; //lock(), unlock()
 			std::mutex mu_;
 			//SemaphoreUsingConditionVariable::SemaphoreUsingConditionVariable resource_{ 1 };
 			std::mutex resourceMu_;
@@ -140,6 +256,7 @@ namespace mm {
 		4 -    R4    W4         R4    W4		   R4    W4         R4    W4			   R4    W4         R4    W4		   R4    W4         R4    W4
 		*/
 
+		template<typename SpinPolicy = NoSpinPolicy>
 		class ReadWriteLock
 		{
 		public:
@@ -163,8 +280,38 @@ namespace mm {
 				m_.unlock();
 			}
 
+			bool tryAcquireReadLock()
+			{
+				return m_.try_lock_shared();
+			}
+
+			bool tryAcquireWriteLock()
+			{
+				return m_.try_lock();
+			}
+
+			bool tryAcquireReadLockUntil(LockDeadline deadline)
+			{
+				return m_.try_lock_shared_until(deadline);
+			}
+
+			bool tryAcquireWriteLockUntil(LockDeadline deadline)
+			{
+				return m_.try_lock_until(deadline);
+			}
+
+			const SpinPolicy& getReaderSpinPolicy() const
+			{
+				return m_.getReaderSpinPolicy();
+			}
+
+			const SpinPolicy& getWriterSpinPolicy() const
+			{
+				return m_.getWriterSpinPolicy();
+			}
+
 		private:
-			SharedMutex m_;
+			SharedMutex<SpinPolicy> m_;
 		};
 
 	}
@@ -13,26 +13,33 @@
 #include <condition_variable>
 
 #include "MM_UnitTestFramework/MM_UnitTestFramework.h"
+#include "SpinPolicy.h"
+#include "TryLockUntil.h"
 
 namespace mm {
 
 	namespace readWriteLock_NoPref_v4 {
 
+		template<typename SpinPolicy = NoSpinPolicy>
 		class SharedMutex
 		{
 		public:
 			void lock_shared()
 			{
-				std::unique_lock<std::mutex> lock{ mu_ };
+				std::unique_lock<std::mutex> lock{ mu_, std::defer_lock };
+				if (!readerSpinPolicy_.spinUntil([&]() { return tryLockIf(lock, [this]() { return numWritersActive_ == 0 && !writterWokenUp_; }); }))
+				{
+					lock.lock();
 
-				++numReadersWaiting_;
+					++numReadersWaiting_;
 
-				//Assuming cv honours the sequence in which the threads are waiting on queue, if writer was woken up, do not allow readers because some writer was waiting in sequence on cv
-				//while (writterActive_ || writterWokenUp_)
-				while (numWritersActive_ > 0 || writterWokenUp_)
-					cv_.wait(lock);
+					//Assuming cv honours the sequence in which the threads are waiting on queue, if writer was woken up, do not allow readers because some writer was waiting in sequence on cv
+					//while (writterActive_ || writterWokenUp_)
+					while (numWritersActive_ > 0 || writterWokenUp_)
+						cv_.wait(lock);
 
-				--numReadersWaiting_;
+					--numReadersWaiting_;
+				}
 				++numReadersActive_;
 
 				lock.unlock();
@@ -40,7 +47,8 @@ namespace mm {
 
 			void unlock_shared()
 			{
-				std::unique_lock<std::mutex> lock{ mu_ };
+				std::unique_lock<std::mutex> lock{ mu_, std::defer_lock };
+				spinThenLock(readerSpinPolicy_, lock);
 
 				--numReadersActive_;
 
@@ -53,20 +61,24 @@ namespace mm {
 
 			void lock()
 			{
-				std::unique_lock<std::mutex> lock{ mu_ };
+				std::unique_lock<std::mutex> lock{ mu_, std::defer_lock };
+				if (!writerSpinPolicy_.spinUntil([&]() { return tryLockIf(lock, [this]() { return numReadersActive_ == 0 && numWritersActive_ < numConcurrentWritersAllowed; }); }))
+				{
+					lock.lock();
 
-				++numWritersWaiting_;
+					++numWritersWaiting_;
 
-				//while (numReadersActive_ > 0 || writterActive_)
-				while (numReadersActive_ > 0 || numWritersActive_ >= numConcurrentWritersAllowed)
-				{
-					cv_.wait(lock);
-					writterWokenUp_ = true;
-				}
+					//while (numReadersActive_ > 0 || writterActive_)
+					while (numReadersActive_ > 0 || numWritersActive_ >= numConcurrentWritersAllowed)
+					{
+						cv_.wait(lock);
+						writterWokenUp_ = true;
+					}
 
-				writterWokenUp_ = false;
+					writterWokenUp_ = false;
 
-				--numWritersWaiting_;
+					--numWritersWaiting_;
+				}
 				++numWritersActive_;
 				//writterActive_ = true;
 
@@ -75,7 +87,8 @@ namespace mm {
 
 			void unlock()
 			{
-				std::unique_lock<std::mutex> lock{ mu_ };
+				std::unique_lock<std::mutex> lock{ mu_, std::defer_lock };
+				spinThenLock(writerSpinPolicy_, lock);
 
 				--numWritersActive_;
 				//writterActive_ = false;
@@ -92,7 +105,83 @@ namespace mm {
 				}
 			}
 
+			//A deadline which has already passed makes it a single non-blocking attempt (see TryLockUntil.h)
+			bool try_lock_shared()
+			{
+				return try_lock_shared_until(LockDeadline{});
+			}
+
+			bool try_lock()
+			{
+				return try_lock_until(LockDeadline{});
+			}
+
+			bool try_lock_shared_until(LockDeadline deadline)
+			{
+				std::unique_lock<std::mutex> lock{ mu_, std::defer_lock };
+				if (!lockUntil(lock, deadline))
+					return false;
+
+				if (numWritersActive_ > 0 || writterWokenUp_)
+				{
+					++numReadersWaiting_;
+					const bool acquired = cv_.wait_until(lock, deadline, [this]() { return numWritersActive_ == 0 && !writterWokenUp_; });
+					--numReadersWaiting_;
+					if (!acquired)
+						return false;
+				}
+				++numReadersActive_;
+
+				return true;
+			}
+
+			bool try_lock_until(LockDeadline deadline)
+			{
+				std::unique_lock<std::mutex> lock{ mu_, std::defer_lock };
+				if (!lockUntil(lock, deadline))
+					return false;
+
+				if (numReadersActive_ > 0 || numWritersActive_ >= numConcurrentWritersAllowed)
+				{
+					++numWritersWaiting_;
+
+					while (numReadersActive_ > 0 || numWritersActive_ >= numConcurrentWritersAllowed)
+					{
+						if (cv_.wait_until(lock, deadline) == std::cv_status::timeout
+							&& (numReadersActive_ > 0 || numWritersActive_ >= numConcurrentWritersAllowed))
+						{
+							//Gives up. The readers which are held back for this writer (writterWokenUp_) must re-check.
+							writterWokenUp_ = false;
+							--numWritersWaiting_;
+							lock.unlock();
+							cv_.notify_all();
+							return false;
+						}
+						writterWokenUp_ = true;
+					}
+
+					writterWokenUp_ = false;
+
+					--numWritersWaiting_;
+				}
+				++numWritersActive_;
+
+				return true;
+			}
+
+			const SpinPolicy& getReaderSpinPolicy() const
+			{
+				return readerSpinPolicy_;
+			}
+
+			const SpinPolicy& getWriterSpinPolicy() const
+			{
+				return writerSpinPolicy_;
+			}
+
 		private:
+			SpinPolicy readerSpinPolicy_; //lock_shared(), unlock_shared()
+			SpinPolicy writerSpinPolicy_; //lock(), unlock()
 			std::mutex mu_;
 			std::condition_variable cv_;
 
@@ -131,6 +220,7 @@ namespace mm {
 		4 -    R4    W4         R4    W4		   R4    W4         R4    W4			   R4    W4         R4    W4		   R4    W4         R4    W4
 		*/
 
+		template<typename SpinPolicy = NoSpinPolicy>
 		class ReadWriteLock
 		{
 		public:
@@ -154,8 +244,38 @@ namespace mm {
 				m_.unlock();
 			}
 
+			bool tryAcquireReadLock()
+			{
+				return m_.try_lock_shared();
+			}
+
+			bool tryAcquireWriteLock()
+			{
+				return m_.try_lock();
+			}
+
+			bool tryAcquireReadLockUntil(LockDeadline deadline)
+			{
+				return m_.try_lock_shared_until(deadline);
+			}
+
+			bool tryAcquireWriteLockUntil(LockDeadline deadline)
+			{
+				return m_.try_lock_until(deadline);
+			}
+
+			const SpinPolicy& getReaderSpinPolicy() const
+			{
+				return m_.getReaderSpinPolicy();
+			}
+
+			const SpinPolicy& getWriterSpinPolicy() const
+			{
+				return m_.getWriterSpinPolicy();
+			}
+
 		private:
-			SharedMutex m_;
+			SharedMutex<SpinPolicy> m_;
 		};
 
 	}
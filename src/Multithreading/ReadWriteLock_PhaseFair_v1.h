@@ -0,0 +1,199 @@
+#pragma once
+
+#include <iostream>
+#include <thread>
+#include <atomic>
+
+#include "MM_UnitTestFramework/MM_UnitTestFramework.h"
+#include "TryLockUntil.h"
+
+/*
+Phase fair ticket read-write lock (PF-T).
+Reference: Brandenburg, Anderson, "Spin-Based Reader-Writer Synchronization for Multiprocessor Real-Time Systems" (Real-Time Systems 2010)
+
+The read preferred locks starve the writers and the write preferred locks starve the readers under sustained load,
+and the no preference locks do not bound the wait of either side. Phase fair: reader phases and writer phases alternate.
+	- A writer waits for at most one reader phase (the readers which are active when it arrives) and for the writers ahead of it (FIFO tickets).
+	- A reader waits for at most one writer phase (the writer which is active or first in line when it arrives).
+	- All the readers which arrive during a writer phase enter together in the next reader phase.
+
+Counters:
+	rin_  : number of readers arrived, in units of readerIncrement (upper bits), and the writer bits (lower 2 bits):
+	        presentBit = a writer is present, phaseIdBit = the phase id of that writer (alternates, so a reader can tell a writer phase from the next one).
+	rout_ : number of readers departed, in units of readerIncrement (lower 2 bits are always 0).
+	win_  : writer tickets taken. wout_ : writer tickets done.
+Each waiter spins on a read only check of one counter (no RMW in the loop):
+	reader: arrive (fetch_add rin_). If a writer is present, wait until the writer bits change (the writer phase is over).
+	writer: take a ticket (fetch_add win_), wait until wout_ reaches it, then set the writer bits in rin_. The old value of rin_ tells how many
+	        readers have arrived before it, wait until rout_ reaches that count (they have departed).
+The counters are unsigned and compared for equality only, so they can wrap around.
+*/
+
+namespace mm {
+
+	namespace readWriteLock_PhaseFair_v1 {
+
+		class SharedMutex
+		{
+		public:
+			SharedMutex()
+				: rin_{ 0 },
+				rout_{ 0 },
+				win_{ 0 },
+				wout_{ 0 }
+			{
+			}
+
+			SharedMutex(const SharedMutex&) = delete;
+			SharedMutex& operator=(const SharedMutex&) = delete;
+
+			void lock_shared()
+			{
+				const unsigned int writerBits = rin_.fetch_add(readerIncrement, std::memory_order_acquire) & writerBitsMask;
+				if (writerBits == 0)
+					return;
+
+				//Wait for the end of the writer phase which was current on arrival
+				while (writerBits == (rin_.load(std::memory_order_acquire) & writerBitsMask))
+					std::this_thread::yield();
+			}
+
+			void unlock_shared()
+			{
+				rout_.fetch_add(readerIncrement, std::memory_order_release);
+			}
+
+			void lock()
+			{
+				const unsigned int ticket = win_.fetch_add(1, std::memory_order_relaxed);
+				while (ticket != wout_.load(std::memory_order_acquire))
+					std::this_thread::yield();
+
+				//Block the new readers, and wait for the readers which arrived before
+				const unsigned int writerBits = presentBit | (ticket & phaseIdBit);
+				const unsigned int readersArrived = rin_.fetch_add(writerBits, std::memory_order_acquire);
+				while (readersArrived != rout_.load(std::memory_order_acquire))
+					std::this_thread::yield();
+			}
+
+			void unlock()
+			{
+				//Start the reader phase, then let the next writer in
+				rin_.fetch_and(~writerBitsMask, std::memory_order_release);
+				wout_.fetch_add(1, std::memory_order_release);
+			}
+
+			//An arrived reader can not leave before its writer phase is over (rout_ would let the writer in too early), and a writer can not
+			//give back its ticket: a reader which arrived in the previous writer phase waits for the writer bits to change, and if a ticket
+			//is skipped, the next writer sets the same phase id again and that reader waits for ever.
+			//So the try and timed versions take their turn only when they do not have to wait for it:
+			//	reader: a CAS on rin_ while no writer is present.
+			//	writer: a CAS on win_ while no writer is present or waiting and no reader is active. The readers which arrive between that check
+			//	        and setting the writer bits are waited for (their critical sections are short).
+			//While they retry they are not queued, so they do not get the phase fair bounds.
+			bool try_lock_shared()
+			{
+				unsigned int rin = rin_.load(std::memory_order_relaxed);
+				while ((rin & writerBitsMask) == 0)
+				{
+					if (rin_.compare_exchange_weak(rin, rin + readerIncrement, std::memory_order_acquire, std::memory_order_relaxed))
+						return true;
+				}
+				return false;
+			}
+
+			bool try_lock_shared_until(LockDeadline deadline)
+			{
+				return retryUntil(deadline, [this]() { return try_lock_shared(); });
+			}
+
+			bool try_lock()
+			{
+				return try_lock_until(LockDeadline{});
+			}
+
+			bool try_lock_until(LockDeadline deadline)
+			{
+				unsigned int ticket = 0;
+				if (!retryUntil(deadline, [this, &ticket]() {
+					ticket = wout_.load(std::memory_order_acquire);
+					if (rin_.load(std::memory_order_acquire) != rout_.load(std::memory_order_acquire))
+						return false;
+					return win_.compare_exchange_strong(ticket, ticket + 1, std::memory_order_relaxed);
+				}))
+					return false;
+
+				const unsigned int writerBits = presentBit | (ticket & phaseIdBit);
+				const unsigned int readersArrived = rin_.fetch_add(writerBits, std::memory_order_acquire);
+				while (readersArrived != rout_.load(std::memory_order_acquire))
+					std::this_thread::yield();
+				return true;
+			}
+
+		private:
+			static constexpr const unsigned int readerIncrement{ 0x100 };
+			static constexpr const unsigned int writerBitsMask{ 0x3 };
+			static constexpr const unsigned int presentBit{ 0x2 };
+			static constexpr const unsigned int phaseIdBit{ 0x1 };
+
+			//The readers modify rin_ and rout_, the writers modify win_ and wout_. Each one in its own cache line.
+			std::atomic<unsigned int> rin_;
+			char pad0[64 - sizeof(std::atomic<unsigned int>)];
+			std::atomic<unsigned int> rout_;
+			char pad1[64 - sizeof(std::atomic<unsigned int>)];
+			std::atomic<unsigned int> win_;
+			char pad2[64 - sizeof(std::atomic<unsigned int>)];
+			std::atomic<unsigned int> wout_;
+			char pad3[64 - sizeof(std::atomic<unsigned int>)];
+		};
+
+		class ReadWriteLock
+		{
+		public:
+			void acquireReadLock()
+			{
+				m_.lock_shared();
+			}
+
+			void releaseReadLock()
+			{
+				m_.unlock_shared();
+			}
+
+			void acquireWriteLock()
+			{
+				m_.lock();
+			}
+
+			void releaseWriteLock()
+			{
+				m_.unlock();
+			}
+
+			bool tryAcquireReadLock()
+			{
+				return m_.try_lock_shared();
+			}
+
+			bool tryAcquireWriteLock()
+			{
+				return m_.try_lock();
+			}
+
+			bool tryAcquireReadLockUntil(LockDeadline deadline)
+			{
+				return m_.try_lock_shared_until(deadline);
+			}
+
+			bool tryAcquireWriteLockUntil(LockDeadline deadline)
+			{
+				return m_.try_lock_until(deadline);
+			}
+
+		private:
+			SharedMutex m_;
+		};
+
+	}
+
+}
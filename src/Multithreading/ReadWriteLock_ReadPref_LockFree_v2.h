@@ -14,6 +14,7 @@
 #include <atomic>
 
 #include "MM_UnitTestFramework/MM_UnitTestFramework.h"
+#include "TryLockUntil.h"
 
 namespace mm {
 
@@ -57,6 +58,41 @@ namespace mm {
 				numActiveReadersWriters_.fetch_sub(writerMask, std::memory_order_seq_cst);
 			}
 
+			//One attempt: the CAS is repeated only if another reader changed the count at the same time, not while a writer holds the lock.
+			//The lock free locks have nothing to block on, the timed versions retry until the deadline.
+			bool try_lock_shared()
+			{
+				int expected = numActiveReadersWriters_.load(std::memory_order_acquire);
+				while (expected <= maxConcurrentReadersAllowed)
+				{
+					if (numActiveReadersWriters_.compare_exchange_weak(expected, expected + 1, std::memory_order_seq_cst))
+						return true;
+				}
+				return false;
+			}
+
+			//Counted as a waiting reader while it retries, so that the new writers let it go first (same as lock_shared())
+			bool try_lock_shared_until(LockDeadline deadline)
+			{
+				++numReadersWaiting_;
+				const bool acquired = retryUntil(deadline, [this]() { return try_lock_shared(); });
+				--numReadersWaiting_;
+				return acquired;
+			}
+
+			bool try_lock()
+			{
+				if (numReadersWaiting_.load(std::memory_order_acquire) > 0)
+					return false;
+				int expected = 0;
+				return numActiveReadersWriters_.compare_exchange_strong(expected, writerMask, std::memory_order_seq_cst);
+			}
+
+			bool try_lock_until(LockDeadline deadline)
+			{
+				return retryUntil(deadline, [this]() { return try_lock(); });
+			}
+
 		private:
 			/*
 
@@ -109,6 +145,26 @@ namespace mm {
 				m_.unlock();
 			}
 
+			bool tryAcquireReadLock()
+			{
+				return m_.try_lock_shared();
+			}
+
+			bool tryAcquireWriteLock()
+			{
+				return m_.try_lock();
+			}
+
+			bool tryAcquireReadLockUntil(LockDeadline deadline)
+			{
+				return m_.try_lock_shared_until(deadline);
+			}
+
+			bool tryAcquireWriteLockUntil(LockDeadline deadline)
+			{
+				return m_.try_lock_until(deadline);
+			}
+
 		private:
 			SharedMutex m_;
 		};
@@ -15,6 +15,8 @@
 #include "SemaphoreUsingConditionVariable.h"
 
 #include "MM_UnitTestFramework/MM_UnitTestFramework.h"
+#include "SpinPolicy.h"
+#include "TryLockUntil.h"
 
 //Reference: https://en.wikipedia.org/wiki/Readers%E2%80%93writer_lock
 
@@ -22,24 +24,27 @@ namespace mm {
 
 	namespace readWriteLock_ReadPref_v1 {
 
+		template<typename SpinPolicy = NoSpinPolicy>
 		class SharedMutex
 		{
 		public:
 			void lock_shared()
 			{
-				std::unique_lock<std::mutex> lock{ muReader_ };
+				std::unique_lock<std::mutex> lock{ muReader_, std::defer_lock };
+				spinThenLock(readerSpinPolicy_, lock);
 
 				++numReadersActive_;
 
 				if (numReadersActive_ == 1)
-					semWriter_.P();
+					spinThenAcquire(readerSpinPolicy_, semWriter_);
 
 				lock.unlock();
 			}
 
 			void unlock_shared()
 			{
-				std::unique_lock<std::mutex> lock{ muReader_ };
+				std::unique_lock<std::mutex> lock{ muReader_, std::defer_lock };
+				spinThenLock(readerSpinPolicy_, lock);
 				--numReadersActive_;
 
 				if (numReadersActive_ == 0)
@@ -50,7 +55,7 @@ namespace mm {
 
 			void lock()
 			{
-				semWriter_.P();
+				spinThenAcquire(writerSpinPolicy_, semWriter_);
 			}
 
 			void unlock()
@@ -58,7 +63,52 @@ namespace mm {
 				semWriter_.V();
 			}
 
+			//A deadline which has already passed makes it a single non-blocking attempt (see TryLockUntil.h)
+			bool try_lock_shared()
+			{
+				return try_lock_shared_until(LockDeadline{});
+			}
+
+			bool try_lock()
+			{
+				return try_lock_until(LockDeadline{});
+			}
+
+			bool try_lock_shared_until(LockDeadline deadline)
+			{
+				std::unique_lock<std::mutex> lock{ muReader_, std::defer_lock };
+				if (!lockUntil(lock, deadline))
+					return false;
+
+				++numReadersActive_;
+
+				if (numReadersActive_ == 1 && !semWriter_.try_acquire_until(deadline))
+				{
+					--numReadersActive_;
+					return false;
+				}
+
+				return true;
+			}
+
+			bool try_lock_until(LockDeadline deadline)
+			{
+				return semWriter_.try_acquire_until(deadline);
+			}
+
+			const SpinPolicy& getReaderSpinPolicy() const
+			{
+				return readerSpinPolicy_;
+			}
+
+			const SpinPolicy& getWriterSpinPolicy() const
+			{
+				return writerSpinPolicy_;
+			}
+
 		private:
+			SpinPolicy readerSpinPolicy_; //lock_shared(), unlock_shared()
+			SpinPolicy writerSpinPolicy_; //lock(), unlock()
 			std::mutex muReader_;
 			constexpr static const int numParallelWriters_{ 1 };
 			SemaphoreUsingConditionVariable::SemaphoreUsingConditionVariable semWriter_{ numParallelWriters_ };
@@ -80,6 +130,7 @@ namespace mm {
 		4 -    R4    W4         R4    W4		   R4    W4         R4    W4			   R4    W4         R4    W4		   R4    W4         R4    W4
 		*/
 
+		template<typename SpinPolicy = NoSpinPolicy>
 		class ReadWriteLock
 		{
 		public:
@@ -103,8 +154,38 @@ namespace mm {
 				m_.unlock();
 			}
 
+			bool tryAcquireReadLock()
+			{
+				return m_.try_lock_shared();
+			}
+
+			bool tryAcquireWriteLock()
+			{
+				return m_.try_lock();
+			}
+
+			bool tryAcquireReadLockUntil(LockDeadline deadline)
+			{
+				return m_.try_lock_shared_until(deadline);
+			}
+
+			bool tryAcquireWriteLockUntil(LockDeadline deadline)
+			{
+				return m_.try_lock_until(deadline);
+			}
+
+			const SpinPolicy& getReaderSpinPolicy() const
+			{
+				return m_.getReaderSpinPolicy();
+			}
+
+			const SpinPolicy& getWriterSpinPolicy() const
+			{
+				return m_.getWriterSpinPolicy();
+			}
+
 		private:
-			SharedMutex m_;
+			SharedMutex<SpinPolicy> m_;
 		};
 
 	}
@@ -15,6 +15,8 @@
 //#include "SemaphoreUsingConditionVariable.h"
 
 #include "MM_UnitTestFramework/MM_UnitTestFramework.h"
+#include "SpinPolicy.h"
+#include "TryLockUntil.h"
 
 //Reference: https://en.wikipedia.org/wiki/Readers%E2%80%93writer_lock
 
@@ -22,21 +24,27 @@ namespace mm {
 
 	namespace readWriteLock_ReadPref_v2 {
 
+		template<typename SpinPolicy = NoSpinPolicy>
 		class SharedMutex
 		{
 		public:
 			void lock_shared()
 			{
-				std::unique_lock<std::mutex> lock{ muReader_ };
+				std::unique_lock<std::mutex> lock{ muReader_, std::defer_lock };
+				spinThenLock(readerSpinPolicy_, lock);
 
 				++numReadersActive_;
 
 				if (numReadersActive_ == 1)
 				{
 					//semWriter_.P();
-					std::unique_lock<std::mutex> lock2(writerMu_);
-					while (writerCount_ == 0) // Handle spurious wake-ups.
-						writerCv_.wait(lock2);
+					std::unique_lock<std::mutex> lock2(writerMu_, std::defer_lock);
+					if (!readerSpinPolicy_.spinUntil([&]() { return tryLockIf(lock2, [this]() { return writerCount_ > 0; }); }))
+					{
+						lock2.lock();
+						while (writerCount_ == 0) // Handle spurious wake-ups.
+							writerCv_.wait(lock2);
+					}
 					--writerCount_;
 					lock2.unlock();
 				}
@@ -46,13 +54,15 @@ namespace mm {
 
 			void unlock_shared()
 			{
-				std::unique_lock<std::mutex> lock{ muReader_ };
+				std::unique_lock<std::mutex> lock{ muReader_, std::defer_lock };
+				spinThenLock(readerSpinPolicy_, lock);
 				--numReadersActive_;
 
 				if (numReadersActive_ == 0)
 				{
 					//semWriter_.V();
-					std::unique_lock<std::mutex> lock2(writerMu_);
+					std::unique_lock<std::mutex> lock2(writerMu_, std::defer_lock);
+					spinThenLock(readerSpinPolicy_, lock2);
 					++writerCount_;
 					lock2.unlock();
 
@@ -65,9 +75,13 @@ namespace mm {
 			void lock()
 			{
 				//semWriter_.P();
-				std::unique_lock<std::mutex> lock(writerMu_);
-				while (writerCount_ == 0) // Handle spurious wake-ups.
-					writerCv_.wait(lock);
+				std::unique_lock<std::mutex> lock(writerMu_, std::defer_lock);
+				if (!writerSpinPolicy_.spinUntil([&]() { return tryLockIf(lock, [this]() { return writerCount_ > 0; }); }))
+				{
+					lock.lock();
+					while (writerCount_ == 0) // Handle spurious wake-ups.
+						writerCv_.wait(lock);
+				}
 				--writerCount_;
 				lock.unlock();
 			}
@@ -75,14 +89,71 @@ namespace mm {
 			void unlock()
 			{
 				//semWriter_.V();
-				std::unique_lock<std::mutex> lock(writerMu_);
+				std::unique_lock<std::mutex> lock(writerMu_, std::defer_lock);
+				spinThenLock(writerSpinPolicy_, lock);
 				++writerCount_;
 				lock.unlock();
 
 				writerCv_.notify_one();
 			}
 
+			//A deadline which has already passed makes it a single non-blocking attempt (see TryLockUntil.h)
+			bool try_lock_shared()
+			{
+				return try_lock_shared_until(LockDeadline{});
+			}
+
+			bool try_lock()
+			{
+				return try_lock_until(LockDeadline{});
+			}
+
+			bool try_lock_shared_until(LockDeadline deadline)
+			{
+				std::unique_lock<std::mutex> lock{ muReader_, std::defer_lock };
+				if (!lockUntil(lock, deadline))
+					return false;
+
+				++numReadersActive_;
+
+				if (numReadersActive_ == 1)
+				{
+					//semWriter_.try_acquire_until(deadline);
+					std::unique_lock<std::mutex> lock2(writerMu_, std::defer_lock);
+					if (!lockIfUntil(lock2, writerCv_, deadline, [this]() { return writerCount_ > 0; }))
+					{
+						--numReadersActive_;
+						return false;
+					}
+					--writerCount_;
+				}
+
+				return true;
+			}
+
+			bool try_lock_until(LockDeadline deadline)
+			{
+				//semWriter_.try_acquire_until(deadline);
+				std::unique_lock<std::mutex> lock(writerMu_, std::defer_lock);
+				if (!lockIfUntil(lock, writerCv_, deadline, [this]() { return writerCount_ > 0; }))
+					return false;
+				--writerCount_;
+				return true;
+			}
+
+			const SpinPolicy& getReaderSpinPolicy() const
+			{
+				return readerSpinPolicy_;
+			}
+
+			const SpinPolicy& getWriterSpinPolicy() const
+			{
+				return writerSpinPolicy_;
+			}
+
 		private:
+			SpinPolicy readerSpinPolicy_; //lock_shared(), unlock_shared()
+			SpinPolicy writerSpinPolicy_; //lock(), unlock()
 			std::mutex muReader_;
 			constexpr static const int numParallelWriters_{ 1 };
 			//SemaphoreUsingConditionVariable::SemaphoreUsingConditionVariable semWriter_{ numParallelWriters_ };
@@ -107,6 +178,7 @@ namespace mm {
 		4 -    R4    W4         R4    W4		   R4    W4         R4    W4			   R4    W4         R4    W4		   R4    W4         R4    W4
 		*/
 
+		template<typename SpinPolicy = NoSpinPolicy>
 		class ReadWriteLock
 		{
 		public:
@@ -130,8 +202,38 @@ namespace mm {
 				m_.unlock();
 			}
 
+			bool tryAcquireReadLock()
+			{
+				return m_.try_lock_shared();
+			}
+
+			bool tryAcquireWriteLock()
+			{
+				return m_.try_lock();
+			}
+
+			bool tryAcquireReadLockUntil(LockDeadline deadline)
+			{
+				return m_.try_lock_shared_until(deadline);
+			}
+
+			bool tryAcquireWriteLockUntil(LockDeadline deadline)
+			{
+				return m_.try_lock_until(deadline);
+			}
+
+			const SpinPolicy& getReaderSpinPolicy() const
+			{
+				return m_.getReaderSpinPolicy();
+			}
+
+			const SpinPolicy& getWriterSpinPolicy() const
+			{
+				return m_.getWriterSpinPolicy();
+			}
+
 		private:
-			SharedMutex m_;
+			SharedMutex<SpinPolicy> m_;
 		};
 
 	}
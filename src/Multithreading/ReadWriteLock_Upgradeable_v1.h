@@ -0,0 +1,148 @@
+#pragma once
+
+#include <iostream>
+#include <mutex>
+#include <chrono>
+
+#include "MM_UnitTestFramework/MM_UnitTestFramework.h"
+#include "TryLockUntil.h"
+
+/*
+Upgradeable read lock on top of any ReadWriteLock in this repo.
+
+Check-then-modify: read the data, and modify it only if needed. With the plain locks the caller has to take the write lock for the check,
+which serializes all the callers even if most of them find that nothing has to change. With a read lock it cannot modify without releasing
+the read lock first, and then someone else may have modified the data in between.
+
+Upgrade lock mode:
+	- acquireUpgradeLock(): shared with the readers, but exclusive among the upgraders and the writers (at most one upgrader at a time).
+	- upgradeToWriteLock(): turns the upgrade lock into the write lock. No other writer can modify the data in between, so the
+	                        result of the check done under the upgrade lock is still valid after the upgrade.
+	- releaseUpgradeLock() if it did not upgrade, releaseWriteLock() if it did.
+
+Implementation: upgradeMutex_ is held by the upgrader and by the writer (for the whole time of their lock). The upgrader holds the read lock of
+the base lock, and upgrades by releasing it and acquiring the write lock of the base lock. Readers may come in between, but they do not modify,
+and every writer has to wait for upgradeMutex_ first. This works with every base lock, and can not deadlock (the upgrader never holds
+the read lock of the base lock while it waits for its write lock).
+The readers use the base lock directly, they do not touch upgradeMutex_.
+*/
+
+namespace mm {
+
+	namespace readWriteLock_Upgradeable_v1 {
+
+		template<typename BaseReadWriteLock>
+		class ReadWriteLock
+		{
+		public:
+			void acquireReadLock()
+			{
+				base_.acquireReadLock();
+			}
+
+			void releaseReadLock()
+			{
+				base_.releaseReadLock();
+			}
+
+			void acquireWriteLock()
+			{
+				upgradeMutex_.lock();
+				base_.acquireWriteLock();
+			}
+
+			void releaseWriteLock()
+			{
+				base_.releaseWriteLock();
+				upgradeMutex_.unlock();
+			}
+
+			void acquireUpgradeLock()
+			{
+				upgradeMutex_.lock();
+				base_.acquireReadLock();
+			}
+
+			void releaseUpgradeLock()
+			{
+				base_.releaseReadLock();
+				upgradeMutex_.unlock();
+			}
+
+			bool tryAcquireReadLock()
+			{
+				return base_.tryAcquireReadLock();
+			}
+
+			bool tryAcquireReadLockUntil(LockDeadline deadline)
+			{
+				return base_.tryAcquireReadLockUntil(deadline);
+			}
+
+			bool tryAcquireWriteLock()
+			{
+				if (!upgradeMutex_.try_lock())
+					return false;
+				if (base_.tryAcquireWriteLock())
+					return true;
+				upgradeMutex_.unlock();
+				return false;
+			}
+
+			bool tryAcquireWriteLockUntil(LockDeadline deadline)
+			{
+				if (!upgradeMutex_.try_lock_until(deadline))
+					return false;
+				if (base_.tryAcquireWriteLockUntil(deadline))
+					return true;
+				upgradeMutex_.unlock();
+				return false;
+			}
+
+			bool tryAcquireUpgradeLock()
+			{
+				if (!upgradeMutex_.try_lock())
+					return false;
+				if (base_.tryAcquireReadLock())
+					return true;
+				upgradeMutex_.unlock();
+				return false;
+			}
+
+			bool tryAcquireUpgradeLockUntil(LockDeadline deadline)
+			{
+				if (!upgradeMutex_.try_lock_until(deadline))
+					return false;
+				if (base_.tryAcquireReadLockUntil(deadline))
+					return true;
+				upgradeMutex_.unlock();
+				return false;
+			}
+
+			//The caller must hold the upgrade lock. It holds the write lock after this call (release it by releaseWriteLock()).
+			void upgradeToWriteLock()
+			{
+				base_.releaseReadLock();
+				base_.acquireWriteLock();
+			}
+
+			//The caller must hold the write lock. It holds the upgrade lock after this call (release it by releaseUpgradeLock()).
+			void downgradeToUpgradeLock()
+			{
+				base_.releaseWriteLock();
+				base_.acquireReadLock();
+			}
+
+			BaseReadWriteLock& getBase()
+			{
+				return base_;
+			}
+
+		private:
+			std::timed_mutex upgradeMutex_;
+			BaseReadWriteLock base_;
+		};
+
+	}
+
+}
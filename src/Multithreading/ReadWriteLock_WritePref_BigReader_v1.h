@@ -0,0 +1,197 @@
+#pragma once
+
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <atomic>
+
+#include "MM_UnitTestFramework/MM_UnitTestFramework.h"
+#include "TryLockUntil.h"
+
+/*
+Big-reader lock (brlock), also known as distributed reader indicator or per-CPU reader-writer lock.
+Reference: Linux kernel brlock / lglock, and Hsieh, Weihl, "Scalable Reader-Writer Locks for Parallel Systems" (1992)
+
+All other read-write locks in this repo have one reader counter (or one mutex) which every reader modifies.
+On many cores the cache line of that counter moves from core to core on every lock_shared() and unlock_shared(), even if there is no writer.
+Here each reader increments only the counter of its own slot. Each slot is in its own cache line, so the readers on different cores
+do not share any cache line which they write. The writers pay for it: they have to scan all the slots.
+
+Slots:
+There is one slot per hardware thread. Each thread gets a slot index once (round robin) and always uses the same slot.
+If there are more threads than slots, some threads share a slot, so the slot has a counter, not a flag.
+unlock_shared() must be called by the same thread which called lock_shared().
+
+Reader:  increment own slot, then check writerActive_. If a writer is active, undo the increment and wait until the writer is done.
+Writer:  set writerActive_ (only one writer at a time), then wait until all the slots are zero.
+Both the increment and the check are seq_cst (Dekker style): either the reader sees writerActive_ or the writer sees the reader's slot.
+New readers back off as soon as a writer sets writerActive_, so it is write preferred.
+
+Use it for read mostly data. A write is O(number of slots).
+*/
+
+namespace mm {
+
+	namespace readWriteLock_WritePref_BigReader_v1 {
+
+		class SharedMutex
+		{
+		public:
+			SharedMutex()
+				: numSlots_{ std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1 },
+				slots_{ new Slot[numSlots_] },
+				writerActive_{ false }
+			{
+			}
+
+			SharedMutex(const SharedMutex&) = delete;
+			SharedMutex& operator=(const SharedMutex&) = delete;
+
+			void lock_shared()
+			{
+				std::atomic<int>& readers = slots_[getThreadIndex() % numSlots_].numReaders_;
+				while (true)
+				{
+					readers.fetch_add(1, std::memory_order_seq_cst);
+					if (!writerActive_.load(std::memory_order_seq_cst))
+						return;
+
+					//A writer is active or waiting for the readers, let it go first
+					readers.fetch_sub(1, std::memory_order_release);
+					while (writerActive_.load(std::memory_order_acquire))
+						std::this_thread::yield();
+				}
+			}
+
+			void unlock_shared()
+			{
+				slots_[getThreadIndex() % numSlots_].numReaders_.fetch_sub(1, std::memory_order_release);
+			}
+
+			void lock()
+			{
+				while (writerActive_.exchange(true, std::memory_order_seq_cst))
+					std::this_thread::yield();
+
+				for (unsigned int i = 0; i < numSlots_; ++i)
+				{
+					while (slots_[i].numReaders_.load(std::memory_order_seq_cst) > 0)
+						std::this_thread::yield();
+				}
+			}
+
+			void unlock()
+			{
+				writerActive_.store(false, std::memory_order_release);
+			}
+
+			bool try_lock_shared()
+			{
+				std::atomic<int>& readers = slots_[getThreadIndex() % numSlots_].numReaders_;
+				readers.fetch_add(1, std::memory_order_seq_cst);
+				if (!writerActive_.load(std::memory_order_seq_cst))
+					return true;
+
+				readers.fetch_sub(1, std::memory_order_release);
+				return false;
+			}
+
+			bool try_lock_shared_until(LockDeadline deadline)
+			{
+				return retryUntil(deadline, [this]() { return try_lock_shared(); });
+			}
+
+			bool try_lock()
+			{
+				return try_lock_until(LockDeadline{});
+			}
+
+			//Gives up writerActive_ again if the readers do not leave before the deadline
+			bool try_lock_until(LockDeadline deadline)
+			{
+				if (!retryUntil(deadline, [this]() { return !writerActive_.exchange(true, std::memory_order_seq_cst); }))
+					return false;
+
+				for (unsigned int i = 0; i < numSlots_; ++i)
+				{
+					if (!retryUntil(deadline, [this, i]() { return slots_[i].numReaders_.load(std::memory_order_seq_cst) == 0; }))
+					{
+						writerActive_.store(false, std::memory_order_release);
+						return false;
+					}
+				}
+				return true;
+			}
+
+		private:
+			struct Slot
+			{
+				std::atomic<int> numReaders_{ 0 };
+				char pad[64 - sizeof(std::atomic<int>)];
+			};
+
+			//Index of the calling thread, assigned once per thread
+			static unsigned int getThreadIndex()
+			{
+				static std::atomic<unsigned int> nextThreadIndex{ 0 };
+				thread_local const unsigned int threadIndex = nextThreadIndex.fetch_add(1, std::memory_order_relaxed);
+				return threadIndex;
+			}
+
+			const unsigned int numSlots_;
+			std::unique_ptr<Slot[]> slots_;
+			char pad0[64];
+			std::atomic<bool> writerActive_; //read by every reader, written only by writers
+			char pad1[64 - sizeof(std::atomic<bool>)];
+		};
+
+		class ReadWriteLock
+		{
+		public:
+			void acquireReadLock()
+			{
+				m_.lock_shared();
+			}
+
+			void releaseReadLock()
+			{
+				m_.unlock_shared();
+			}
+
+			void acquireWriteLock()
+			{
+				m_.lock();
+			}
+
+			void releaseWriteLock()
+			{
+				m_.unlock();
+			}
+
+			bool tryAcquireReadLock()
+			{
+				return m_.try_lock_shared();
+			}
+
+			bool tryAcquireWriteLock()
+			{
+				return m_.try_lock();
+			}
+
+			bool tryAcquireReadLockUntil(LockDeadline deadline)
+			{
+				return m_.try_lock_shared_until(deadline);
+			}
+
+			bool tryAcquireWriteLockUntil(LockDeadline deadline)
+			{
+				return m_.try_lock_until(deadline);
+			}
+
+		private:
+			SharedMutex m_;
+		};
+
+	}
+
+}
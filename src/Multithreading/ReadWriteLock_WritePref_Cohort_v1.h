@@ -0,0 +1,195 @@
+#pragma once
+
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <atomic>
+
+#include "MM_UnitTestFramework/MM_UnitTestFramework.h"
+#include "NumaTopology.h"
+#include "CohortLock_v1.h"
+#include "SpinPolicy.h"
+#include "TryLockUntil.h"
+
+/*
+NUMA-aware read-write lock.
+Reference: Calciu, Dice, Lev, Luchangco, Marathe, Shavit, "NUMA-Aware Reader-Writer Locks" (PPoPP 2013), C-RW-WP variant
+
+The writers serialize among themselves by a cohort lock (see CohortLock_v1.h), so the write lock stays on one node for a batch of writers.
+The readers never touch the cohort lock: each reader increments the reader counter of its own node (one cache line per node, like the
+per-thread slots of the big-reader lock), so the readers of one node share no cache line which they write with the readers of another node.
+
+Reader: increment the counter of the current node, then check writerActive_. If a writer is active, undo the increment and wait until it is done.
+Writer: acquire the cohort lock, set writerActive_, then wait until there are no readers.
+Both the increment and the check are seq_cst (Dekker style), as in the big-reader lock. New readers back off as soon as a writer sets
+writerActive_, so it is write preferred.
+
+A reader may be moved to a cpu of another node inside its critical section, and then decrements the counter of that node.
+So a single counter may be off, and the writer waits until the sum of all the counters is zero instead of until each one is zero.
+The sum can not be zero while a reader is inside: each reader which got in incremented its counter before the writer set writerActive_,
+so the writer sees that increment, and it sees the decrement of the reader only after the reader has left. A reader which backs off
+decrements the same counter which it incremented.
+*/
+
+namespace mm {
+
+	namespace readWriteLock_WritePref_Cohort_v1 {
+
+		class SharedMutex
+		{
+		public:
+			explicit SharedMutex(const NumaTopology& topology = NumaTopology::getDefault(), unsigned int maxLocalHandoffs = cohortLock_v1::CohortLock::defaultMaxLocalHandoffs)
+				: writers_{ topology, maxLocalHandoffs },
+				numNodes_{ writers_.getTopology().getNumNodes() },
+				readers_{ new ReaderCounter[numNodes_] },
+				writerActive_{ false }
+			{
+			}
+
+			SharedMutex(const SharedMutex&) = delete;
+			SharedMutex& operator=(const SharedMutex&) = delete;
+
+			void lock_shared()
+			{
+				while (!try_lock_shared())
+					spinWaitUntil([this]() { return !writerActive_.load(std::memory_order_relaxed); });
+			}
+
+			void unlock_shared()
+			{
+				readers_[getCurrentNode()].numReaders_.fetch_sub(1, std::memory_order_release);
+			}
+
+			void lock()
+			{
+				writers_.lock();
+				writerActive_.store(true, std::memory_order_seq_cst);
+				spinWaitUntil([this]() { return !hasReaders(); });
+			}
+
+			void unlock()
+			{
+				writerActive_.store(false, std::memory_order_release);
+				writers_.unlock();
+			}
+
+			bool try_lock_shared()
+			{
+				std::atomic<int>& readers = readers_[getCurrentNode()].numReaders_;
+				readers.fetch_add(1, std::memory_order_seq_cst);
+				if (!writerActive_.load(std::memory_order_seq_cst))
+					return true;
+
+				//A writer is active or waiting for the readers, let it go first
+				readers.fetch_sub(1, std::memory_order_release);
+				return false;
+			}
+
+			bool try_lock_shared_until(LockDeadline deadline)
+			{
+				return retryUntil(deadline, [this]() { return try_lock_shared(); });
+			}
+
+			bool try_lock()
+			{
+				return try_lock_until(LockDeadline{});
+			}
+
+			//Gives up writerActive_ and the cohort lock again if the readers do not leave before the deadline
+			bool try_lock_until(LockDeadline deadline)
+			{
+				if (!writers_.try_lock_until(deadline))
+					return false;
+
+				writerActive_.store(true, std::memory_order_seq_cst);
+				if (retryUntil(deadline, [this]() { return !hasReaders(); }))
+					return true;
+
+				writerActive_.store(false, std::memory_order_release);
+				writers_.unlock();
+				return false;
+			}
+
+			cohortLock_v1::CohortLockStats getStats() const
+			{
+				return writers_.getStats();
+			}
+
+		private:
+			struct ReaderCounter
+			{
+				std::atomic<int> numReaders_{ 0 };
+				char pad[64 - sizeof(std::atomic<int>)];
+			};
+
+			unsigned int getCurrentNode() const
+			{
+				return writers_.getTopology().getCurrentNode();
+			}
+
+			bool hasReaders() const
+			{
+				int sum = 0;
+				for (unsigned int i = 0; i < numNodes_; ++i)
+					sum += readers_[i].numReaders_.load(std::memory_order_seq_cst);
+				return sum != 0;
+			}
+
+			cohortLock_v1::CohortLock writers_;
+			const unsigned int numNodes_;
+			std::unique_ptr<ReaderCounter[]> readers_;
+			char pad0[64];
+			std::atomic<bool> writerActive_;
+			char pad1[64 - sizeof(std::atomic<bool>)];
+		};
+
+		class ReadWriteLock
+		{
+		public:
+			void acquireReadLock()
+			{
+				m_.lock_shared();
+			}
+
+			void releaseReadLock()
+			{
+				m_.unlock_shared();
+			}
+
+			void acquireWriteLock()
+			{
+				m_.lock();
+			}
+
+			void releaseWriteLock()
+			{
+				m_.unlock();
+			}
+
+			bool tryAcquireReadLock()
+			{
+				return m_.try_lock_shared();
+			}
+
+			bool tryAcquireWriteLock()
+			{
+				return m_.try_lock();
+			}
+
+			bool tryAcquireReadLockUntil(LockDeadline deadline)
+			{
+				return m_.try_lock_shared_until(deadline);
+			}
+
+			bool tryAcquireWriteLockUntil(LockDeadline deadline)
+			{
+				return m_.try_lock_until(deadline);
+			}
+
+		private:
+			SharedMutex m_;
+		};
+
+	}
+
+}
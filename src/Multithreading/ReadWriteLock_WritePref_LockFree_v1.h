@@ -14,6 +14,7 @@
 #include <atomic>
 
 #include "MM_UnitTestFramework/MM_UnitTestFramework.h"
+#include "TryLockUntil.h"
 
 namespace mm {
 
@@ -60,6 +61,39 @@ namespace mm {
 				numActiveReadersWriters_.fetch_sub(writerMask, std::memory_order_seq_cst);
 			}
 
+			//One attempt. The lock free locks have nothing to block on, the timed versions retry until the deadline.
+			bool try_lock_shared()
+			{
+				if (numWritersWaiting_.load(std::memory_order_acquire) > 0)
+					return false;
+				if (numActiveReadersWriters_.fetch_add(1, std::memory_order_seq_cst) <= maxConcurrentReadersAllowed)
+					return true;
+				--numActiveReadersWriters_;
+				return false;
+			}
+
+			bool try_lock_shared_until(LockDeadline deadline)
+			{
+				return retryUntil(deadline, [this]() { return try_lock_shared(); });
+			}
+
+			bool try_lock()
+			{
+				if (numActiveReadersWriters_.fetch_add(writerMask, std::memory_order_seq_cst) == 0)
+					return true;
+				numActiveReadersWriters_.fetch_sub(writerMask, std::memory_order_seq_cst);
+				return false;
+			}
+
+			//Counted as a waiting writer while it retries, so that the new readers let it go first (same as lock())
+			bool try_lock_until(LockDeadline deadline)
+			{
+				++numWritersWaiting_;
+				const bool acquired = retryUntil(deadline, [this]() { return try_lock(); });
+				--numWritersWaiting_;
+				return acquired;
+			}
+
 		private:
 			/*
 
@@ -112,6 +146,26 @@ namespace mm {
 				m_.unlock();
 			}
 
+			bool tryAcquireReadLock()
+			{
+				return m_.try_lock_shared();
+			}
+
+			bool tryAcquireWriteLock()
+			{
+				return m_.try_lock();
+			}
+
+			bool tryAcquireReadLockUntil(LockDeadline deadline)
+			{
+				return m_.try_lock_shared_until(deadline);
+			}
+
+			bool tryAcquireWriteLockUntil(LockDeadline deadline)
+			{
+				return m_.try_lock_until(deadline);
+			}
+
 		private:
 			SharedMutex m_;
 		};
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <iostream>
+#include <thread>
+#include <atomic>
+
+#include "MM_UnitTestFramework/MM_UnitTestFramework.h"
+#include "ScalableNonZeroIndicator.h"
+#include "TryLockUntil.h"
+
+/*
+Write preferred read-write lock with SNZI reader indicator.
+Same protocol as readWriteLock_WritePref_BigReader_v1, but the readers arrive at a SNZI tree (see ScalableNonZeroIndicator.h)
+instead of incrementing a per thread slot:
+	- Readers modify only the cache line of their leaf, unless the leaf changes between zero and non-zero.
+	- Writers check only the root of the tree (one load), instead of scanning all the slots.
+	- Memory is the size of the tree, which does not depend on the number of threads.
+
+Reader:  arrive at own leaf, then check writerActive_. If a writer is active, depart and wait until the writer is done.
+Writer:  set writerActive_ (only one writer at a time), then wait until the root of the tree is zero.
+Both sides use seq_cst (Dekker style), so either the reader sees writerActive_ or the writer sees the root non-zero.
+unlock_shared() must be called by the same thread which called lock_shared() (it departs from the same leaf).
+*/
+
+namespace mm {
+
+	namespace readWriteLock_WritePref_SNZI_v1 {
+
+		class SharedMutex
+		{
+		public:
+			SharedMutex()
+				: writerActive_{ false }
+			{
+			}
+
+			SharedMutex(const SharedMutex&) = delete;
+			SharedMutex& operator=(const SharedMutex&) = delete;
+
+			void lock_shared()
+			{
+				const unsigned int leaf = getThreadIndex();
+				while (true)
+				{
+					readers_.arrive(leaf);
+					if (!writerActive_.load(std::memory_order_seq_cst))
+						return;
+
+					//A writer is active or waiting for the readers, let it go first
+					readers_.depart(leaf);
+					while (writerActive_.load(std::memory_order_acquire))
+						std::this_thread::yield();
+				}
+			}
+
+			void unlock_shared()
+			{
+				readers_.depart(getThreadIndex());
+			}
+
+			void lock()
+			{
+				while (writerActive_.exchange(true, std::memory_order_seq_cst))
+					std::this_thread::yield();
+
+				while (readers_.query())
+					std::this_thread::yield();
+			}
+
+			void unlock()
+			{
+				writerActive_.store(false, std::memory_order_release);
+			}
+
+			bool try_lock_shared()
+			{
+				const unsigned int leaf = getThreadIndex();
+				readers_.arrive(leaf);
+				if (!writerActive_.load(std::memory_order_seq_cst))
+					return true;
+
+				readers_.depart(leaf);
+				return false;
+			}
+
+			bool try_lock_shared_until(LockDeadline deadline)
+			{
+				return retryUntil(deadline, [this]() { return try_lock_shared(); });
+			}
+
+			bool try_lock()
+			{
+				return try_lock_until(LockDeadline{});
+			}
+
+			//Gives up writerActive_ again if the readers do not leave before the deadline
+			bool try_lock_until(LockDeadline deadline)
+			{
+				if (!retryUntil(deadline, [this]() { return !writerActive_.exchange(true, std::memory_order_seq_cst); }))
+					return false;
+
+				if (!retryUntil(deadline, [this]() { return !readers_.query(); }))
+				{
+					writerActive_.store(false, std::memory_order_release);
+					return false;
+				}
+				return true;
+			}
+
+		private:
+			//Index of the calling thread, assigned once per thread
+			static unsigned int getThreadIndex()
+			{
+				static std::atomic<unsigned int> nextThreadIndex{ 0 };
+				thread_local const unsigned int threadIndex = nextThreadIndex.fetch_add(1, std::memory_order_relaxed);
+				return threadIndex;
+			}
+
+			ScalableNonZeroIndicator readers_;
+			char pad0[64];
+			std::atomic<bool> writerActive_; //read by every reader, written only by writers
+			char pad1[64 - sizeof(std::atomic<bool>)];
+		};
+
+		class ReadWriteLock
+		{
+		public:
+			void acquireReadLock()
+			{
+				m_.lock_shared();
+			}
+
+			void releaseReadLock()
+			{
+				m_.unlock_shared();
+			}
+
+			void acquireWriteLock()
+			{
+				m_.lock();
+			}
+
+			void releaseWriteLock()
+			{
+				m_.unlock();
+			}
+
+			bool tryAcquireReadLock()
+			{
+				return m_.try_lock_shared();
+			}
+
+			bool tryAcquireWriteLock()
+			{
+				return m_.try_lock();
+			}
+
+			bool tryAcquireReadLockUntil(LockDeadline deadline)
+			{
+				return m_.try_lock_shared_until(deadline);
+			}
+
+			bool tryAcquireWriteLockUntil(LockDeadline deadline)
+			{
+				return m_.try_lock_until(deadline);
+			}
+
+		private:
+			SharedMutex m_;
+		};
+
+	}
+
+}
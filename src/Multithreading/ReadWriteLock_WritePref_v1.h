@@ -15,6 +15,8 @@
 #include "SemaphoreUsingConditionVariable.h"
 
 #include "MM_UnitTestFramework/MM_UnitTestFramework.h"
+#include "SpinPolicy.h"
+#include "TryLockUntil.h"
 
 //Reference: https://en.wikipedia.org/wiki/Readers%E2%80%93writer_lock
 
@@ -22,19 +24,21 @@ namespace mm {
 
 	namespace readWriteLock_WritePref_v1 {
 
+		template<typename SpinPolicy = NoSpinPolicy>
 		class SharedMutex
 		{
 		public:
 			void lock_shared()
 			{
-				readTry_.P();
+				spinThenAcquire(readerSpinPolicy_, readTry_);
 
-				std::unique_lock<std::mutex> lock{ muReader_ };
+				std::unique_lock<std::mutex> lock{ muReader_, std::defer_lock };
+				spinThenLock(readerSpinPolicy_, lock);
 
 				++numReadersActive_;
 
 				if (numReadersActive_ == 1)
-					resource_.P();
+					spinThenAcquire(readerSpinPolicy_, resource_);
 
 				lock.unlock();
 				readTry_.V();
@@ -42,7 +46,8 @@ namespace mm {
 
 			void unlock_shared()
 			{
-				std::unique_lock<std::mutex> lock{ muReader_ };
+				std::unique_lock<std::mutex> lock{ muReader_, std::defer_lock };
+				spinThenLock(readerSpinPolicy_, lock);
 				--numReadersActive_;
 
 				if (numReadersActive_ == 0)
@@ -53,23 +58,25 @@ namespace mm {
 
 			void lock()
 			{
-				std::unique_lock<std::mutex> lock{ muWriter_ };
+				std::unique_lock<std::mutex> lock{ muWriter_, std::defer_lock };
+				spinThenLock(writerSpinPolicy_, lock);
 
 				++numWritersActive_;
 
 				if (numWritersActive_ == 1)
-					readTry_.P();
+					spinThenAcquire(writerSpinPolicy_, readTry_);
 
 				lock.unlock();
 
-				resource_.P();
+				spinThenAcquire(writerSpinPolicy_, resource_);
 			}
 
 			void unlock()
 			{
 				resource_.V();
 
-				std::unique_lock<std::mutex> lock{ muWriter_ };
+				std::unique_lock<std::mutex> lock{ muWriter_, std::defer_lock };
+				spinThenLock(writerSpinPolicy_, lock);
 
 				--numWritersActive_;
 
@@ -79,7 +86,86 @@ namespace mm {
 				lock.unlock();
 			}
 
+			//A deadline which has already passed makes it a single non-blocking attempt (see TryLockUntil.h)
+			bool try_lock_shared()
+			{
+				return try_lock_shared_until(LockDeadline{});
+			}
+
+			bool try_lock()
+			{
+				return try_lock_until(LockDeadline{});
+			}
+
+			bool try_lock_shared_until(LockDeadline deadline)
+			{
+				if (!readTry_.try_acquire_until(deadline))
+					return false;
+
+				std::unique_lock<std::mutex> lock{ muReader_, std::defer_lock };
+				if (!lockUntil(lock, deadline))
+				{
+					readTry_.V();
+					return false;
+				}
+
+				++numReadersActive_;
+
+				bool acquired = true;
+				if (numReadersActive_ == 1 && !resource_.try_acquire_until(deadline))
+				{
+					--numReadersActive_;
+					acquired = false;
+				}
+
+				lock.unlock();
+				readTry_.V();
+				return acquired;
+			}
+
+			bool try_lock_until(LockDeadline deadline)
+			{
+				std::unique_lock<std::mutex> lock{ muWriter_, std::defer_lock };
+				if (!lockUntil(lock, deadline))
+					return false;
+
+				++numWritersActive_;
+
+				if (numWritersActive_ == 1 && !readTry_.try_acquire_until(deadline))
+				{
+					--numWritersActive_;
+					return false;
+				}
+
+				lock.unlock();
+
+				if (resource_.try_acquire_until(deadline))
+					return true;
+
+				//Undo, same as unlock() without resource_.V(). Must not give up here, so it blocks on muWriter_.
+				lock.lock();
+
+				--numWritersActive_;
+
+				if (numWritersActive_ == 0)
+					readTry_.V();
+
+				return false;
+			}
+
+			const SpinPolicy& getReaderSpinPolicy() const
+			{
+				return readerSpinPolicy_;
+			}
+
+			const SpinPolicy& getWriterSpinPolicy() const
+			{
+				return writerSpinPolicy_;
+			}
+
 		private:
+			SpinPolicy readerSpinPolicy_; //lock_shared(), unlock_shared()
+			SpinPolicy writerSpinPolicy_; //lock(), unlock()
 			std::mutex muReader_;
 			std::mutex muWriter_;
 
@@ -104,6 +190,7 @@ namespace mm {
 		4 -    R4    W4         R4    W4		   R4    W4         R4    W4			   R4    W4         R4    W4		   R4    W4         R4    W4
 		*/
 
+		template<typename SpinPolicy = NoSpinPolicy>
 		class ReadWriteLock
 		{
 		public:
@@ -127,8 +214,38 @@ namespace mm {
 				m_.unlock();
 			}
 
+			bool tryAcquireReadLock()
+			{
+				return m_.try_lock_shared();
+			}
+
+			bool tryAcquireWriteLock()
+			{
+				return m_.try_lock();
+			}
+
+			bool tryAcquireReadLockUntil(LockDeadline deadline)
+			{
+				return m_.try_lock_shared_until(deadline);
+			}
+
+			bool tryAcquireWriteLockUntil(LockDeadline deadline)
+			{
+				return m_.try_lock_until(deadline);
+			}
+
+			const SpinPolicy& getReaderSpinPolicy() const
+			{
+				return m_.getReaderSpinPolicy();
+			}
+
+			const SpinPolicy& getWriterSpinPolicy() const
+			{
+				return m_.getWriterSpinPolicy();
+			}
+
 		private:
-			SharedMutex m_;
+			SharedMutex<SpinPolicy> m_;
 		};
 
 	}
@@ -15,6 +15,8 @@
 //#include "SemaphoreUsingConditionVariable.h"
 
 #include "MM_UnitTestFramework/MM_UnitTestFramework.h"
+#include "SpinPolicy.h"
+#include "TryLockUntil.h"
 
 //Reference: https://en.wikipedia.org/wiki/Readers%E2%80%93writer_lock
 
@@ -22,28 +24,38 @@ namespace mm {
 
 	namespace readWriteLock_WritePref_v2 {
 
+		template<typename SpinPolicy = NoSpinPolicy>
 		class SharedMutex
 		{
 		public:
 			void lock_shared()
 			{
 				//readTry_.P();
-				std::unique_lock<std::mutex> lock(readTryMu_);
-				while (readTryCount_ == 0) // Handle spurious wake-ups.
-					readTryCv_.wait(lock);
+				std::unique_lock<std::mutex> lock(readTryMu_, std::defer_lock);
+				if (!readerSpinPolicy_.spinUntil([&]() { return tryLockIf(lock, [this]() { return readTryCount_ > 0; }); }))
+				{
+					lock.lock();
+					while (readTryCount_ == 0) // Handle spurious wake-ups.
+						readTryCv_.wait(lock);
+				}
 				--readTryCount_;
 				lock.unlock();
 
-				std::unique_lock<std::mutex> lock2{ muReader_ };
+				std::unique_lock<std::mutex> lock2{ muReader_, std::defer_lock };
+				spinThenLock(readerSpinPolicy_, lock2);
 
 				++numReadersActive_;
 
 				if (numReadersActive_ == 1)
 				{
 					//resource_.P();
-					std::unique_lock<std::mutex> lock3(resourceMu_);
-					while (resourceCount_ == 0) // Handle spurious wake-ups.
-						resourceCv_.wait(lock3);
+					std::unique_lock<std::mutex> lock3(resourceMu_, std::defer_lock);
+					if (!readerSpinPolicy_.spinUntil([&]() { return tryLockIf(lock3, [this]() { return resourceCount_ > 0; }); }))
+					{
+						lock3.lock();
+						while (resourceCount_ == 0) // Handle spurious wake-ups.
+							resourceCv_.wait(lock3);
+					}
 					--resourceCount_;
 					lock3.unlock();
 				}
@@ -51,7 +63,8 @@ namespace mm {
 				lock2.unlock();
 
 				//readTry_.V();
-				std::unique_lock<std::mutex> lock4(readTryMu_);
+				std::unique_lock<std::mutex> lock4(readTryMu_, std::defer_lock);
+				spinThenLock(readerSpinPolicy_, lock4);
 				++readTryCount_;
 				lock4.unlock();
 
@@ -60,13 +73,15 @@ namespace mm {
 
 			void unlock_shared()
 			{
-				std::unique_lock<std::mutex> lock{ muReader_ };
+				std::unique_lock<std::mutex> lock{ muReader_, std::defer_lock };
+				spinThenLock(readerSpinPolicy_, lock);
 				--numReadersActive_;
 
 				if (numReadersActive_ == 0)
 				{
 					//resource_.V();
-					std::unique_lock<std::mutex> lock2(resourceMu_);
+					std::unique_lock<std::mutex> lock2(resourceMu_, std::defer_lock);
+					spinThenLock(readerSpinPolicy_, lock2);
 					++resourceCount_;
 					lock2.unlock();
 
@@ -78,16 +93,21 @@ namespace mm {
 
 			void lock()
 			{
-				std::unique_lock<std::mutex> lock{ muWriter_ };
+				std::unique_lock<std::mutex> lock{ muWriter_, std::defer_lock };
+				spinThenLock(writerSpinPolicy_, lock);
 
 				++numWritersActive_;
 
 				if (numWritersActive_ == 1)
 				{
 					//readTry_.P();
-					std::unique_lock<std::mutex> lock2(readTryMu_);
-					while (readTryCount_ == 0) // Handle spurious wake-ups.
-						readTryCv_.wait(lock2);
+					std::unique_lock<std::mutex> lock2(readTryMu_, std::defer_lock);
+					if (!writerSpinPolicy_.spinUntil([&]() { return tryLockIf(lock2, [this]() { return readTryCount_ > 0; }); }))
+					{
+						lock2.lock();
+						while (readTryCount_ == 0) // Handle spurious wake-ups.
+							readTryCv_.wait(lock2);
+					}
 					--readTryCount_;
 					lock2.unlock();
 				}
@@ -95,9 +115,13 @@ namespace mm {
 				lock.unlock();
 
 				//resource_.P();
-				std::unique_lock<std::mutex> lock3(resourceMu_);
-				while (resourceCount_ == 0) // Handle spurious wake-ups.
-					resourceCv_.wait(lock3);
+				std::unique_lock<std::mutex> lock3(resourceMu_, std::defer_lock);
+				if (!writerSpinPolicy_.spinUntil([&]() { return tryLockIf(lock3, [this]() { return resourceCount_ > 0; }); }))
+				{
+					lock3.lock();
+					while (resourceCount_ == 0) // Handle spurious wake-ups.
+						resourceCv_.wait(lock3);
+				}
 				--resourceCount_;
 				lock3.unlock();
 			}
@@ -105,20 +129,23 @@ namespace mm {
 			void unlock()
 			{
 				//resource_.V();
-				std::unique_lock<std::mutex> lock(resourceMu_);
+				std::unique_lock<std::mutex> lock(resourceMu_, std::defer_lock);
+				spinThenLock(writerSpinPolicy_, lock);
 				++resourceCount_;
 				lock.unlock();
 
 				resourceCv_.notify_one();
 
-				std::unique_lock<std::mutex> lock2{ muWriter_ };
+				std::unique_lock<std::mutex> lock2{ muWriter_, std::defer_lock };
+				spinThenLock(writerSpinPolicy_, lock2);
 
 				--numWritersActive_;
 
 				if (numWritersActive_ == 0)
 				{
 					//readTry_.V();
-					std::unique_lock<std::mutex> lock3(readTryMu_);
+					std::unique_lock<std::mutex> lock3(readTryMu_, std::defer_lock);
+					spinThenLock(writerSpinPolicy_, lock3);
 					++readTryCount_;
 					lock3.unlock();
 
@@ -128,7 +155,120 @@ namespace mm {
 				lock2.unlock();
 			}
 
+			//A deadline which has already passed makes it a single non-blocking attempt (see TryLockUntil.h)
+			bool try_lock_shared()
+			{
+				return try_lock_shared_until(LockDeadline{});
+			}
+
+			bool try_lock()
+			{
+				return try_lock_until(LockDeadline{});
+			}
+
+			bool try_lock_shared_until(LockDeadline deadline)
+			{
+				//readTry_.try_acquire_until(deadline);
+				std::unique_lock<std::mutex> lock(readTryMu_, std::defer_lock);
+				if (!lockIfUntil(lock, readTryCv_, deadline, [this]() { return readTryCount_ > 0; }))
+					return false;
+				--readTryCount_;
+				lock.unlock();
+
+				bool acquired = true;
+				std::unique_lock<std::mutex> lock2{ muReader_, std::defer_lock };
+				if (!lockUntil(lock2, deadline))
+					acquired = false;
+				else
+				{
+					++numReadersActive_;
+
+					if (numReadersActive_ == 1)
+					{
+						//resource_.try_acquire_until(deadline);
+						std::unique_lock<std::mutex> lock3(resourceMu_, std::defer_lock);
+						if (lockIfUntil(lock3, resourceCv_, deadline, [this]() { return resourceCount_ > 0; }))
+							--resourceCount_;
+						else
+						{
+							--numReadersActive_;
+							acquired = false;
+						}
+					}
+
+					lock2.unlock();
+				}
+
+				//readTry_.V();
+				lock.lock();
+				++readTryCount_;
+				lock.unlock();
+
+				readTryCv_.notify_one();
+				return acquired;
+			}
+
+			bool try_lock_until(LockDeadline deadline)
+			{
+				std::unique_lock<std::mutex> lock{ muWriter_, std::defer_lock };
+				if (!lockUntil(lock, deadline))
+					return false;
+
+				++numWritersActive_;
+
+				if (numWritersActive_ == 1)
+				{
+					//readTry_.try_acquire_until(deadline);
+					std::unique_lock<std::mutex> lock2(readTryMu_, std::defer_lock);
+					if (!lockIfUntil(lock2, readTryCv_, deadline, [this]() { return readTryCount_ > 0; }))
+					{
+						--numWritersActive_;
+						return false;
+					}
+					--readTryCount_;
+				}
+
+				lock.unlock();
+
+				//resource_.try_acquire_until(deadline);
+				std::unique_lock<std::mutex> lock3(resourceMu_, std::defer_lock);
+				if (lockIfUntil(lock3, resourceCv_, deadline, [this]() { return resourceCount_ > 0; }))
+				{
+					--resourceCount_;
+					return true;
+				}
+
+				//Undo, same as unlock() without resource_.V(). Must not give up here, so it blocks on muWriter_.
+				lock.lock();
+
+				--numWritersActive_;
+
+				if (numWritersActive_ == 0)
+				{
+					//readTry_.V();
+					std::unique_lock<std::mutex> lock4(readTryMu_);
+					++readTryCount_;
+					lock4.unlock();
+
+					readTryCv_.notify_one();
+				}
+
+				return false;
+			}
+
+			const SpinPolicy& getReaderSpinPolicy() const
+			{
+				return readerSpinPolicy_;
+			}
+
+			const SpinPolicy& getWriterSpinPolicy() const
+			{
+				return writerSpinPolicy_;
+			}
+
 		private:
+			SpinPolicy readerSpinPolicy_; //lock_shared(), unlock_shared()
+			SpinPolicy writerSpinPolicy_; //lock(), unlock()
 			std::mutex muReader_;
 			std::mutex muWriter_;
 
@@ -160,6 +300,7 @@ namespace mm {
 		4 -    R4    W4         R4    W4		   R4    W4         R4    W4			   R4    W4         R4    W4		   R4    W4         R4    W4
 		*/
 
+		template<typename SpinPolicy = NoSpinPolicy>
 		class ReadWriteLock
 		{
 		public:
@@ -183,8 +324,38 @@ namespace mm {
 				m_.unlock();
 			}
 
+			bool tryAcquireReadLock()
+			{
+				return m_.try_lock_shared();
+			}
+
+			bool tryAcquireWriteLock()
+			{
+				return m_.try_lock();
+			}
+
+			bool tryAcquireReadLockUntil(LockDeadline deadline)
+			{
+				return m_.try_lock_shared_until(deadline);
+			}
+
+			bool tryAcquireWriteLockUntil(LockDeadline deadline)
+			{
+				return m_.try_lock_until(deadline);
+			}
+
+			const SpinPolicy& getReaderSpinPolicy() const
+			{
+				return m_.getReaderSpinPolicy();
+			}
+
+			const SpinPolicy& getWriterSpinPolicy() const
+			{
+				return m_.getWriterSpinPolicy();
+			}
+
 		private:
-			SharedMutex m_;
+			SharedMutex<SpinPolicy> m_;
 		};
 
 	}
@@ -13,6 +13,7 @@
 #include <condition_variable>
 
 #include "MM_UnitTestFramework/MM_UnitTestFramework.h"
+#include "TryLockUntil.h"
 
 namespace mm {
 
@@ -42,6 +43,27 @@ namespace mm {
 				m_.unlock();
 			}
 
+			bool tryAcquireReadLock()
+			{
+				return m_.try_lock();
+			}
+
+			bool tryAcquireWriteLock()
+			{
+				return m_.try_lock();
+			}
+
+			//std::mutex has no try_lock_until(), retry try_lock() until the deadline
+			bool tryAcquireReadLockUntil(LockDeadline deadline)
+			{
+				return retryUntil(deadline, [this]() { return m_.try_lock(); });
+			}
+
+			bool tryAcquireWriteLockUntil(LockDeadline deadline)
+			{
+				return retryUntil(deadline, [this]() { return m_.try_lock(); });
+			}
+
 		private:
 			std::mutex m_;
 		};
@@ -74,6 +96,27 @@ namespace mm {
 				m_.unlock();
 			}
 
+			bool tryAcquireReadLock()
+			{
+				return m_.try_lock_shared();
+			}
+
+			bool tryAcquireWriteLock()
+			{
+				return m_.try_lock();
+			}
+
+			//std::shared_mutex has no timed functions (std::shared_timed_mutex has, but it is not the lock measured here), retry until the deadline
+			bool tryAcquireReadLockUntil(LockDeadline deadline)
+			{
+				return retryUntil(deadline, [this]() { return m_.try_lock_shared(); });
+			}
+
+			bool tryAcquireWriteLockUntil(LockDeadline deadline)
+			{
+				return retryUntil(deadline, [this]() { return m_.try_lock(); });
+			}
+
 		private:
 			std::shared_mutex m_;
 		};
@@ -9,6 +9,10 @@ using namespace std;
 using namespace std::chrono_literals;
 
 #include "MM_UnitTestFramework/MM_UnitTestFramework.h"
+#include "Spinlock.h"
+#include "CohortLock_v1.h"
+#include "Spinlock_MCS_v1.h"
+#include "Spinlock_CLH_v1.h"
 
 namespace mm {
 
@@ -42,6 +46,14 @@ namespace mm {
 		globalVal += increment;
 	}
 
+	//Test-and-test-and-set spinlock with pause hints and exponential backoff (see Spinlock.h), a drop-in replacement of std::mutex
+	Spinlock spinlock;
+	void syncronizeUsingSpinlock(int increment)
+	{
+		std::lock_guard<Spinlock> lock(spinlock);
+		globalVal += increment;
+	}
+
 	std::atomic<bool> my_mutex_replacement(false);
 	void syncronizeUsingAtomicVariable_unsafe(int increment)
 	{
@@ -172,6 +184,41 @@ namespace mm {
 		lock6.store(false, std::memory_order_release);
 	}
 
+	/*
+	NUMA-aware lock (see CohortLock_v1.h): the lock is passed between the threads of the same NUMA node before it moves to another node.
+	On a single node machine use a simulated topology to see the cohorts at work.
+	*/
+	cohortLock_v1::CohortLock cohortLock;
+	void syncronizeUsingCohortLock(int increment)
+	{
+		std::lock_guard<cohortLock_v1::CohortLock> lock(cohortLock);
+		globalVal += increment;
+	}
+
+	cohortLock_v1::CohortLock simulatedCohortLock{ NumaTopology{ 4 } };
+	void syncronizeUsingSimulatedCohortLock(int increment)
+	{
+		std::lock_guard<cohortLock_v1::CohortLock> lock(simulatedCohortLock);
+		globalVal += increment;
+	}
+
+	/*
+	Queue spinlocks: the waiters form a FIFO queue and each one spins on its own cache line, instead of all of them on one shared flag
+	as in syncronizeUsingAtomicVariable_safe_v1..v6. A release wakes only the next waiter.
+	*/
+	spinlock_MCS_v1::McsLock mcsLock;
+	void syncronizeUsingMcsLock(int increment)
+	{
+		spinlock_MCS_v1::ScopedLock lock(mcsLock);
+		globalVal += increment;
+	}
+
+	spinlock_CLH_v1::ClhLock clhLock;
+	void syncronizeUsingClhLock(int increment)
+	{
+		spinlock_CLH_v1::ScopedLock lock(clhLock);
+		globalVal += increment;
+	}
 
 	void threadFunction(int increment, int version)
 	{
@@ -203,6 +250,21 @@ namespace mm {
 			case 8:
 				syncronizeUsingAtomicVariable_safe_v6(increment);
 				break;
+			case 9:
+				syncronizeUsingCohortLock(increment);
+				break;
+			case 10:
+				syncronizeUsingSimulatedCohortLock(increment);
+				break;
+			case 11:
+				syncronizeUsingMcsLock(increment);
+				break;
+			case 12:
+				syncronizeUsingClhLock(increment);
+				break;
+			case 13:
+				syncronizeUsingSpinlock(increment);
+				break;
 			}
 				
 			//std::this_thread::sleep_for(2ms);
@@ -231,6 +293,8 @@ namespace mm {
 
 		//use mutex
 		test(1);
+		//use TTAS spinlock
+		test(13);
 		//use atomic variable (unsafe)
 		test(2);
 		//use atomic variable (safe)
@@ -240,6 +304,16 @@ namespace mm {
 		test(6);
 		test(7);
 		test(8);
+		//use cohort lock
+		test(9);
+		cout << "   " << cohortLock.getTopology().toString() << ", local handoffs: " << cohortLock.getStats().localHandoffs
+			<< ", global releases: " << cohortLock.getStats().globalReleases;
+		test(10);
+		cout << "   " << simulatedCohortLock.getTopology().toString() << ", local handoffs: " << simulatedCohortLock.getStats().localHandoffs
+			<< ", global releases: " << simulatedCohortLock.getStats().globalReleases;
+		//use queue spinlocks
+		test(11);
+		test(12);
 	}
 
 /*
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <cstdint>
+#include <atomic>
+
+/*
+SNZI: Scalable Non-Zero Indicator.
+Reference: Ellen, Lev, Luchangco, Moir, "SNZI: Scalable NonZero Indicators" (PODC 2007)
+
+It is a counter which supports only arrive() (+1), depart() (-1) and query() (is it non-zero?).
+query() is all that a read-write lock needs from its reader counter: the writer only needs to know whether there is any reader.
+
+The counter is a tree. The threads arrive and depart at the leaves. A node tells its parent only about its own transitions 0 -> non-zero
+and non-zero -> 0, so most of the arrivals and departures modify only the cache line of the leaf. The root is a plain counter, which changes
+only when one of its children changes between zero and non-zero, and query() reads only the root.
+
+Memory is O(number of nodes), the tree does not grow with the number of threads. Threads which share a leaf share its cache line.
+
+Node state: one 64 bit atomic, the count in the lower 32 bits and a version in the upper 32 bits.
+The count is stored doubled, so that the intermediate value 1/2 can be represented (as 1):
+	arrive() at a node with count 0 sets it to 1/2 and arrives at the parent, and only then sets 1/2 -> 1.
+	Other threads which see 1/2 help: they arrive at the parent and try to set 1/2 -> 1 themselves. If they fail, they depart from the parent
+	again (undo). The version prevents ABA on the 0 -> 1/2 -> 1 transition.
+So the parent is always non-zero before any arrive() at the child returns.
+
+depart() must be called at the same leaf as the matching arrive().
+*/
+
+#define CACHE_LINE_SIZE 64
+
+namespace mm {
+
+	class ScalableNonZeroIndicator
+	{
+	public:
+		explicit ScalableNonZeroIndicator(unsigned int numLeaves = std::thread::hardware_concurrency(), unsigned int fanOut = 4)
+			: numLeaves_{ numLeaves > 0 ? numLeaves : 1 },
+			root_a{ 0 }
+		{
+			if (fanOut < 2)
+				fanOut = 2;
+
+			//Build the tree level by level, leaves first. The parent of the topmost node is the root counter (noParent).
+			std::vector<unsigned int> parents;
+			unsigned int levelBegin = 0;
+			unsigned int levelSize = numLeaves_;
+			parents.resize(levelSize, noParent);
+			while (levelSize > 1)
+			{
+				unsigned int nextLevelBegin = levelBegin + levelSize;
+				unsigned int nextLevelSize = (levelSize + fanOut - 1) / fanOut;
+				for (unsigned int i = 0; i < levelSize; ++i)
+					parents[levelBegin + i] = nextLevelBegin + i / fanOut;
+				parents.resize(nextLevelBegin + nextLevelSize, noParent);
+				levelBegin = nextLevelBegin;
+				levelSize = nextLevelSize;
+			}
+
+			numNodes_ = static_cast<unsigned int>(parents.size());
+			nodes_.reset(new Node[numNodes_]);
+			for (unsigned int i = 0; i < numNodes_; ++i)
+				nodes_[i].parent_ = parents[i];
+		}
+
+		ScalableNonZeroIndicator(const ScalableNonZeroIndicator&) = delete;
+		ScalableNonZeroIndicator& operator=(const ScalableNonZeroIndicator&) = delete;
+
+		void arrive(unsigned int leaf)
+		{
+			arriveAt(leaf % numLeaves_);
+		}
+
+		void depart(unsigned int leaf)
+		{
+			departFrom(leaf % numLeaves_);
+		}
+
+		//true if there is at least one thread which has arrived and not departed yet
+		bool query() const
+		{
+			return root_a.load(std::memory_order_seq_cst) > 0;
+		}
+
+		unsigned int getNumLeaves() const
+		{
+			return numLeaves_;
+		}
+
+		unsigned int getNumNodes() const
+		{
+			return numNodes_;
+		}
+
+	private:
+		enum : unsigned int { noParent = ~0u }; //enum, because std::vector::resize() takes it by reference
+		static const uint64_t half = 1;  //count 1/2
+		static const uint64_t one = 2;   //count 1
+		static const int versionShift = 32;
+		static const uint64_t countMask = (uint64_t{ 1 } << versionShift) - 1;
+
+		struct Node
+		{
+			std::atomic<uint64_t> state_a{ 0 };
+			unsigned int parent_{ noParent };
+			char pad[CACHE_LINE_SIZE - sizeof(std::atomic<uint64_t>) - sizeof(unsigned int)];
+		};
+
+		static uint64_t getCount(uint64_t state) { return state & countMask; }
+		static uint64_t getVersion(uint64_t state) { return state >> versionShift; }
+		static uint64_t makeState(uint64_t count, uint64_t version) { return (version << versionShift) | count; }
+
+		void arriveAtParent(unsigned int parent)
+		{
+			if (parent == noParent)
+				root_a.fetch_add(1, std::memory_order_seq_cst);
+			else
+				arriveAt(parent);
+		}
+
+		void departFromParent(unsigned int parent)
+		{
+			if (parent == noParent)
+				root_a.fetch_sub(1, std::memory_order_seq_cst);
+			else
+				departFrom(parent);
+		}
+
+		void arriveAt(unsigned int index)
+		{
+			Node& node = nodes_[index];
+			bool success = false;
+			int undoArrivals = 0;
+			while (!success)
+			{
+				uint64_t state = node.state_a.load(std::memory_order_seq_cst);
+				if (getCount(state) >= one)
+				{
+					//Already non-zero, parent is not touched
+					if (node.state_a.compare_exchange_strong(state, makeState(getCount(state) + one, getVersion(state)), std::memory_order_seq_cst))
+						success = true;
+				}
+				else if (getCount(state) == 0)
+				{
+					uint64_t halfState = makeState(half, getVersion(state) + 1);
+					if (node.state_a.compare_exchange_strong(state, halfState, std::memory_order_seq_cst))
+					{
+						success = true;
+						state = halfState;
+					}
+				}
+
+				if (getCount(state) == half)
+				{
+					//Make sure the parent is non-zero before the count becomes 1 (this thread or a helper)
+					arriveAtParent(node.parent_);
+					if (!node.state_a.compare_exchange_strong(state, makeState(one, getVersion(state)), std::memory_order_seq_cst))
+						++undoArrivals;
+				}
+			}
+
+			for (; undoArrivals > 0; --undoArrivals)
+				departFromParent(node.parent_);
+		}
+
+		void departFrom(unsigned int index)
+		{
+			Node& node = nodes_[index];
+			uint64_t state = node.state_a.load(std::memory_order_seq_cst);
+			while (!node.state_a.compare_exchange_weak(state, makeState(getCount(state) - one, getVersion(state)), std::memory_order_seq_cst))
+			{
+			}
+
+			if (getCount(state) == one)
+				departFromParent(node.parent_); //This node became zero
+		}
+
+		const unsigned int numLeaves_;
+		unsigned int numNodes_;
+		std::unique_ptr<Node[]> nodes_; //leaves are [0, numLeaves_)
+		char pad0[CACHE_LINE_SIZE];
+		std::atomic<int64_t> root_a;
+		char pad1[CACHE_LINE_SIZE - sizeof(std::atomic<int64_t>)];
+	};
+}
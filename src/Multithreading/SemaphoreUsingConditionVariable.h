@@ -12,6 +12,7 @@
 #include <shared_mutex>
 #include <condition_variable>
 #include <atomic>
+#include <chrono>
 
 #include "MM_UnitTestFramework/MM_UnitTestFramework.h"
 
@@ -64,6 +65,15 @@ namespace mm {
 				return true;
 			}
 
+			bool try_acquire_until(std::chrono::steady_clock::time_point deadline) {
+				std::unique_lock<decltype(mutex_)> lock(mutex_);
+				if (!condition_.wait_until(lock, deadline, [this]() { return count_ > 0; }))
+					return false;
+
+				--count_;
+				return true;
+			}
+
 			void release() {
 				std::unique_lock<decltype(mutex_)> lock(mutex_);
 				++count_;
@@ -16,4 +16,7 @@ while (!head.compare_exchange_strong(old_h,new_n);
 
 Atomic variable is a pointer to (non-atomic) memory
 
+This push_front() is fine, but pop_front() written the same way has ABA problem and can not delete the popped node.
+See MultiProducersMultiConsumersUnlimitedLockFreeStack_v1.h for the complete stack (tagged pointer + free list).
+
 */
\ No newline at end of file
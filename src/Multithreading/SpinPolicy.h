@@ -0,0 +1,211 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <cstdint>
+#include <atomic>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/*
+Spin policies for the blocking (mutex + condition variable / semaphore) read-write locks.
+
+The blocking locks always park the thread in the kernel when the lock is busy, and the lock free locks always spin.
+For critical sections of ~100 ns neither is right: parking costs a few microseconds, and spinning burns whole time slices when the holder is
+preempted. With a spin policy, an acquirer first spins for a bounded number of iterations (calling a non-blocking tryAcquire() with exponential
+backoff between the tries) and parks only if the lock is still busy after that.
+
+The lock passes its non-blocking attempt to spinUntil(tryAcquire), which returns true if tryAcquire() succeeded while spinning.
+If it returns false, the lock takes its usual blocking path.
+A lock has two policy instances: one for the waits of lock_shared()/unlock_shared() and one for the waits of lock()/unlock().
+A reader often waits for a writer to leave a whole critical section, while a writer waits for every reader, so the two sides need
+different spin limits, and one shared moving average would mix them.
+
+NoSpinPolicy:       spinUntil() returns false immediately, the lock behaves exactly as without a policy (the default).
+AdaptiveSpinPolicy: the spin limit tunes itself, similar to glibc PTHREAD_MUTEX_ADAPTIVE_NP. The number of iterations a successful spin needed
+                    measures how long the lock is held, without reading any clock. The policy keeps a moving average of it and
+                    spins up to 2 * average + minSpinLimit (at most maxSpinLimit) iterations:
+                    - short hold times: spins succeed quickly, the limit stays small
+                    - hold times close to the limit: the average moves up, the limit follows
+                    - long hold times: the spins fail, the average is reduced on each failure and the thread parks early
+                    On a single core machine spinning can never succeed while the holder is not running, so it never spins there.
+*/
+
+namespace mm {
+
+	//Tells the core that this is a spin-wait loop (x86 pause, ARM yield). Much cheaper than std::this_thread::yield().
+	inline void cpuRelax()
+	{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+		_mm_pause();
+#elif defined(_MSC_VER) && (defined(_M_ARM) || defined(_M_ARM64))
+		__yield();
+#elif defined(__x86_64__) || defined(__i386__)
+		__builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+		asm volatile("yield" ::: "memory");
+#else
+		std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+	}
+
+	//Waits until condition() is true: spins with cpuRelax() for a while, then yields, so that an oversubscribed machine still makes progress.
+	//For the spinning locks which wait on a flag of their own (ticket, MCS, CLH).
+	template<typename Condition>
+	void spinWaitUntil(Condition condition)
+	{
+		enum : int { maxSpinsBeforeYield = 64 };
+		for (int spins = 0; !condition(); ++spins)
+		{
+			if (spins < maxSpinsBeforeYield)
+				cpuRelax();
+			else
+				std::this_thread::yield();
+		}
+	}
+
+	struct SpinPolicyStats
+	{
+		SpinPolicyStats()
+			: spinAcquires{ 0 },
+			parkedAcquires{ 0 },
+			spinIterations{ 0 },
+			spinLimit{ 0 }
+		{}
+
+		size_t spinAcquires;    //number of times tryAcquire() succeeded while spinning
+		size_t parkedAcquires;  //number of times the spin limit was reached and the lock took its blocking path
+		size_t spinIterations;  //total number of spin iterations (including the backoff iterations)
+		size_t spinLimit;       //current spin limit
+	};
+
+	class NoSpinPolicy
+	{
+	public:
+		template<typename TryAcquire>
+		bool spinUntil(TryAcquire)
+		{
+			return false;
+		}
+
+		SpinPolicyStats getStats() const
+		{
+			return SpinPolicyStats{};
+		}
+	};
+
+	class AdaptiveSpinPolicy
+	{
+	public:
+		AdaptiveSpinPolicy()
+			: averageSpins_a{ 0 },
+			spinAcquires_a{ 0 },
+			parkedAcquires_a{ 0 },
+			spinIterations_a{ 0 }
+		{
+		}
+
+		AdaptiveSpinPolicy(const AdaptiveSpinPolicy&) = delete;
+		AdaptiveSpinPolicy& operator=(const AdaptiveSpinPolicy&) = delete;
+
+		template<typename TryAcquire>
+		bool spinUntil(TryAcquire tryAcquire)
+		{
+			if (isSingleCore())
+				return false;
+
+			const uint32_t average = averageSpins_a.load(std::memory_order_relaxed);
+			const uint32_t limit = getSpinLimit(average);
+			uint32_t spins = 0;
+			uint32_t backoff = 1;
+			while (true)
+			{
+				if (tryAcquire())
+				{
+					//Moving average with weight 1/8, as glibc. Lost updates due to races are fine, it is only a hint.
+					averageSpins_a.store(static_cast<uint32_t>(static_cast<int64_t>(average) + (static_cast<int64_t>(spins) - average) / 8), std::memory_order_relaxed);
+					spinAcquires_a.fetch_add(1, std::memory_order_relaxed);
+					spinIterations_a.fetch_add(spins, std::memory_order_relaxed);
+					return true;
+				}
+
+				if (spins >= limit)
+					break;
+
+				for (uint32_t i = 0; i < backoff; ++i)
+					cpuRelax();
+				spins += backoff;
+				backoff = backoff < maxBackoff ? backoff * 2 : maxBackoff;
+			}
+
+			averageSpins_a.store(average - average / 4, std::memory_order_relaxed);
+			parkedAcquires_a.fetch_add(1, std::memory_order_relaxed);
+			spinIterations_a.fetch_add(spins, std::memory_order_relaxed);
+			return false;
+		}
+
+		SpinPolicyStats getStats() const
+		{
+			SpinPolicyStats stats;
+			stats.spinAcquires = spinAcquires_a.load(std::memory_order_relaxed);
+			stats.parkedAcquires = parkedAcquires_a.load(std::memory_order_relaxed);
+			stats.spinIterations = spinIterations_a.load(std::memory_order_relaxed);
+			stats.spinLimit = isSingleCore() ? 0 : getSpinLimit(averageSpins_a.load(std::memory_order_relaxed));
+			return stats;
+		}
+
+	private:
+		static constexpr const uint32_t minSpinLimit{ 16 };
+		static constexpr const uint32_t maxSpinLimit{ 4096 };
+		static constexpr const uint32_t maxBackoff{ 64 };
+
+		static uint32_t getSpinLimit(uint32_t averageSpins)
+		{
+			const uint32_t limit = 2 * averageSpins + minSpinLimit;
+			return limit < maxSpinLimit ? limit : maxSpinLimit;
+		}
+
+		static bool isSingleCore()
+		{
+			static const bool singleCore = std::thread::hardware_concurrency() == 1;
+			return singleCore;
+		}
+
+		std::atomic<uint32_t> averageSpins_a;
+		std::atomic<size_t> spinAcquires_a;
+		std::atomic<size_t> parkedAcquires_a;
+		std::atomic<size_t> spinIterations_a;
+	};
+
+	//Locks the mutex of lock (which must not own it yet): spins on try_lock() first, then blocks.
+	template<typename SpinPolicy, typename Mutex>
+	void spinThenLock(SpinPolicy& spinPolicy, std::unique_lock<Mutex>& lock)
+	{
+		if (!spinPolicy.spinUntil([&lock]() { return lock.try_lock(); }))
+			lock.lock();
+	}
+
+	//Acquires the semaphore: spins on try_acquire() first, then blocks.
+	template<typename SpinPolicy, typename Semaphore>
+	void spinThenAcquire(SpinPolicy& spinPolicy, Semaphore& semaphore)
+	{
+		if (!spinPolicy.spinUntil([&semaphore]() { return semaphore.try_acquire(); }))
+			semaphore.acquire();
+	}
+
+	//Non-blocking attempt for the condition variable locks: returns true (and keeps the mutex locked) only if
+	//the mutex is free and condition() is true under it, else leaves the mutex unlocked.
+	template<typename Mutex, typename Condition>
+	bool tryLockIf(std::unique_lock<Mutex>& lock, Condition condition)
+	{
+		if (!lock.try_lock())
+			return false;
+		if (condition())
+			return true;
+		lock.unlock();
+		return false;
+	}
+
+}
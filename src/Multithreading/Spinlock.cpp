@@ -1,6 +1,11 @@
+#include "Spinlock.h"
+
 /*
 Reference: https://webkit.org/blog/6161/locking-in-webkit/
 
+The simple spinlock from the article is below. mm::Spinlock (Spinlock.h) is the same lock made test-and-test-and-set, with pause hints and
+bounded exponential backoff with jitter.
+
 class Spinlock {
 public:
 	Spinlock()
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <iostream>
+#include <thread>
+#include <functional>
+#include <cstdint>
+#include <atomic>
+
+#include "MM_UnitTestFramework/MM_UnitTestFramework.h"
+#include "SpinPolicy.h"
+
+/*
+Test-and-test-and-set (TTAS) spinlock with exponential backoff.
+Reference: https://webkit.org/blog/6161/locking-in-webkit/ (see Spinlock.cpp), Anderson, "The Performance of Spin Lock Alternatives for
+Shared-Memory Multiprocessors" (1990)
+
+The atomic spinlocks in ReplaceMutexByAtomic.cpp (syncronizeUsingAtomicVariable_safe_v1..v6) loop on exchange() / test_and_set().
+Each iteration is a read-modify-write, which needs the cache line in exclusive state, so the waiters keep taking the line away from each other
+(and from the holder, which needs it for unlock()) even though none of them can succeed.
+Here a waiter:
+	- tries exchange() only when a plain load() has seen the lock free (test-and-test-and-set). While the lock is held, the waiters only read
+	  their shared copy of the cache line, and there is no coherence traffic until unlock().
+	- after a failed exchange() (another waiter was faster), waits for a random number of cpuRelax() (x86 pause / ARM yield) iterations before
+	  it looks again. The upper bound doubles after each failure (bounded exponential backoff), so that the waiters which were woken by the
+	  same unlock() spread out instead of colliding again. The randomness (jitter) keeps them from staying in step.
+	- yields once the backoff has reached its maximum, so that the holder gets a core on an oversubscribed machine.
+
+BasicLockable (lock() / unlock()) and Lockable (try_lock()), so it works with std::lock_guard and std::unique_lock.
+Not fair, and not recursive.
+*/
+
+namespace mm {
+
+	class Spinlock
+	{
+	public:
+		Spinlock()
+			: locked_{ false }
+		{
+		}
+
+		Spinlock(const Spinlock&) = delete;
+		Spinlock& operator=(const Spinlock&) = delete;
+
+		void lock()
+		{
+			uint32_t backoff = minBackoff;
+			while (locked_.exchange(true, std::memory_order_acquire))
+			{
+				do
+				{
+					const uint32_t spins = backoff / 2 + getRandom() % (backoff / 2 + 1);
+					for (uint32_t i = 0; i < spins; ++i)
+						cpuRelax();
+
+					if (backoff < maxBackoff)
+						backoff *= 2;
+					else
+						std::this_thread::yield();
+				} while (locked_.load(std::memory_order_relaxed));
+			}
+		}
+
+		bool try_lock()
+		{
+			return !locked_.load(std::memory_order_relaxed) && !locked_.exchange(true, std::memory_order_acquire);
+		}
+
+		void unlock()
+		{
+			locked_.store(false, std::memory_order_release);
+		}
+
+	private:
+		enum : uint32_t
+		{
+			minBackoff = 4,
+			maxBackoff = 1024
+		};
+
+		//xorshift32, one state per thread, no shared cache line
+		static uint32_t getRandom()
+		{
+			thread_local uint32_t state = static_cast<uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id())) | 1;
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			return state;
+		}
+
+		std::atomic<bool> locked_;
+		char pad0[64 - sizeof(std::atomic<bool>)];
+	};
+
+}
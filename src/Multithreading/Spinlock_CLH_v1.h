@@ -0,0 +1,154 @@
+#pragma once
+
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+#include "MM_UnitTestFramework/MM_UnitTestFramework.h"
+#include "SpinPolicy.h"
+
+/*
+CLH queue spinlock.
+Reference: Craig, "Building FIFO and Priority-Queuing Spin Locks from Atomic Swap" (1993), Magnussen, Landin, Hagersten, "Queue Locks on Cache Coherent Multiprocessors" (1994)
+
+Like the MCS lock (see Spinlock_MCS_v1.h) the waiters form a FIFO queue and each waiter spins on its own cache line, but the queue is implicit:
+	lock():   set locked_ of own node, make it the new tail (one exchange), and spin on locked_ of the predecessor node (the old tail).
+	unlock(): clear locked_ of own node. Only the successor spins on it, it is woken by a single cache miss.
+There is no next pointer, so unlock() never has to wait for a successor to link itself in (the MCS lock has to), and both lock() and unlock()
+are wait-free apart from the spinning itself.
+
+The price is that a node is still read by the successor after unlock(), so it can not live on the stack of its thread.
+Instead the thread takes over the node of its predecessor, which nobody reads any more, and gives its own node to the queue:
+	- the lock starts with one unlocked dummy node as the tail, and deletes the tail node when it is destroyed
+	- each thread keeps a few nodes in a thread_local free list. lock() takes a node from it (allocates one if it is empty), and
+	  unlock() puts the node of the predecessor into it. The list is deleted when the thread exits.
+So, once the free lists are warm, the lock does not allocate, and a thread can hold several CLH locks at the same time.
+
+Scoped node API: lock() returns the node (a handle) which has to be passed to unlock(), and ScopedLock does both:
+	{
+		spinlock_CLH_v1::ScopedLock lock{ clhLock };
+		...
+	}
+Waiters spin by spinWaitUntil() (see SpinPolicy.h), so they yield once they have spun for a while.
+The FIFO hand-over has the same problem on an oversubscribed machine as the MCS lock (see Spinlock_MCS_v1.h).
+*/
+
+namespace mm {
+
+	namespace spinlock_CLH_v1 {
+
+		class ClhLock
+		{
+		public:
+			//One cache line per node, so that a waiter spinning on its predecessor node does not share the cache line with any other waiter
+			struct Node
+			{
+				Node()
+					: locked_{ false },
+					predecessor_{ nullptr }
+				{}
+
+				Node(const Node&) = delete;
+				Node& operator=(const Node&) = delete;
+
+				std::atomic<bool> locked_;
+				Node* predecessor_; //Accessed only by the thread which owns the node
+				char pad[64 - sizeof(std::atomic<bool>) - sizeof(Node*)];
+			};
+
+			ClhLock()
+				: tail_{ new Node{} }
+			{
+			}
+
+			//No thread may hold or wait for the lock
+			~ClhLock()
+			{
+				delete tail_.load(std::memory_order_acquire);
+			}
+
+			ClhLock(const ClhLock&) = delete;
+			ClhLock& operator=(const ClhLock&) = delete;
+
+			Node* lock()
+			{
+				Node* node = getFreeNodes().take();
+				node->locked_.store(true, std::memory_order_relaxed);
+				Node* predecessor = tail_.exchange(node, std::memory_order_acq_rel);
+				spinWaitUntil([predecessor]() { return !predecessor->locked_.load(std::memory_order_acquire); });
+				node->predecessor_ = predecessor;
+				return node;
+			}
+
+			void unlock(Node* node)
+			{
+				Node* predecessor = node->predecessor_;
+				node->locked_.store(false, std::memory_order_release);
+				getFreeNodes().put(predecessor);
+			}
+
+		private:
+			class FreeNodes
+			{
+			public:
+				~FreeNodes()
+				{
+					for (Node* node : nodes_)
+						delete node;
+				}
+
+				Node* take()
+				{
+					if (nodes_.empty())
+						return new Node{};
+					Node* node = nodes_.back();
+					nodes_.pop_back();
+					return node;
+				}
+
+				void put(Node* node)
+				{
+					nodes_.push_back(node);
+				}
+
+			private:
+				std::vector<Node*> nodes_;
+			};
+
+			static FreeNodes& getFreeNodes()
+			{
+				thread_local FreeNodes freeNodes;
+				return freeNodes;
+			}
+
+			std::atomic<Node*> tail_;
+			char pad0[64 - sizeof(std::atomic<Node*>)];
+		};
+
+		class ScopedLock
+		{
+		public:
+			explicit ScopedLock(ClhLock& lock)
+				: lock_{ lock },
+				node_{ lock_.lock() }
+			{
+			}
+
+			~ScopedLock()
+			{
+				lock_.unlock(node_);
+			}
+
+			ScopedLock(const ScopedLock&) = delete;
+			ScopedLock& operator=(const ScopedLock&) = delete;
+
+		private:
+			ClhLock& lock_;
+			ClhLock::Node* node_;
+		};
+
+	}
+
+}
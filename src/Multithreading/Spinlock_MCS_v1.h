@@ -0,0 +1,134 @@
+#pragma once
+
+#include <iostream>
+#include <thread>
+#include <atomic>
+
+#include "MM_UnitTestFramework/MM_UnitTestFramework.h"
+#include "SpinPolicy.h"
+
+/*
+MCS queue spinlock.
+Reference: Mellor-Crummey, Scott, "Algorithms for Scalable Synchronization on Shared-Memory Multiprocessors" (1991)
+
+The test-and-set spinlocks (ReplaceMutexByAtomic.cpp) make every waiter spin on the one lock flag. Each release invalidates the flag in the cache
+of every waiter, and all of them race for it again, so the cost of a hand-over grows with the number of waiters.
+Here the waiters form a queue of nodes (a linked list), and each waiter spins only on the flag of its own node, in its own cache line:
+	lock(node):   node becomes the new tail (one exchange). If there was a predecessor, link node behind it and spin on node.locked_.
+	unlock(node): if there is a successor, clear its locked_ flag: only that one waiter is woken, in FIFO order, by a single cache miss.
+	              If there is none, set the tail back to nullptr (CAS). If the CAS fails, a successor is just linking itself in, wait for the link.
+The lock itself is one pointer (the tail).
+
+The node must stay alive and must not be moved from lock() until unlock(), and must be passed to both. It can live on the stack of the thread:
+	ScopedLock holds its own node, so it is the easiest way to use the lock:
+		{
+			spinlock_MCS_v1::ScopedLock lock{ mcsLock };
+			...
+		}
+The lock is not BasicLockable (lock() and unlock() need the node), so it can not be used with std::lock_guard.
+
+try_lock(node) takes the lock only if the queue is empty.
+Waiters spin by spinWaitUntil() (see SpinPolicy.h), so they yield once they have spun for a while.
+
+Oversubscription: the lock is handed to one particular waiter, and nobody else can take it until that waiter gets a core. With many more
+runnable threads than cores (e.g. 1000 threads on a few cores) this is much slower than a test-and-set lock, which is taken by whichever
+thread happens to run. Queue locks scale with the number of cores, not with the number of threads.
+*/
+
+namespace mm {
+
+	namespace spinlock_MCS_v1 {
+
+		class McsLock
+		{
+		public:
+			//One cache line per node, so that a waiter spinning on its own node does not share the cache line with any other waiter
+			struct Node
+			{
+				Node()
+					: next_{ nullptr },
+					locked_{ false }
+				{}
+
+				Node(const Node&) = delete;
+				Node& operator=(const Node&) = delete;
+
+				std::atomic<Node*> next_;
+				std::atomic<bool> locked_;
+				char pad[64 - sizeof(std::atomic<Node*>) - sizeof(std::atomic<bool>)];
+			};
+
+			McsLock()
+				: tail_{ nullptr }
+			{
+			}
+
+			McsLock(const McsLock&) = delete;
+			McsLock& operator=(const McsLock&) = delete;
+
+			void lock(Node& node)
+			{
+				node.next_.store(nullptr, std::memory_order_relaxed);
+				node.locked_.store(true, std::memory_order_relaxed);
+				Node* predecessor = tail_.exchange(&node, std::memory_order_acq_rel);
+				if (predecessor == nullptr)
+					return;
+
+				predecessor->next_.store(&node, std::memory_order_release);
+				spinWaitUntil([&node]() { return !node.locked_.load(std::memory_order_acquire); });
+			}
+
+			bool try_lock(Node& node)
+			{
+				node.next_.store(nullptr, std::memory_order_relaxed);
+				node.locked_.store(false, std::memory_order_relaxed);
+				Node* expected = nullptr;
+				//acq_rel: node becomes visible to the next locker, which links itself into it
+				return tail_.compare_exchange_strong(expected, &node, std::memory_order_acq_rel, std::memory_order_relaxed);
+			}
+
+			void unlock(Node& node)
+			{
+				Node* successor = node.next_.load(std::memory_order_acquire);
+				if (successor == nullptr)
+				{
+					Node* expected = &node;
+					if (tail_.compare_exchange_strong(expected, nullptr, std::memory_order_release, std::memory_order_relaxed))
+						return;
+
+					//A successor has already swapped itself in as the tail, but has not linked itself behind node yet
+					spinWaitUntil([&node, &successor]() { return (successor = node.next_.load(std::memory_order_acquire)) != nullptr; });
+				}
+				successor->locked_.store(false, std::memory_order_release);
+			}
+
+		private:
+			std::atomic<Node*> tail_;
+			char pad0[64 - sizeof(std::atomic<Node*>)];
+		};
+
+		class ScopedLock
+		{
+		public:
+			explicit ScopedLock(McsLock& lock)
+				: lock_{ lock }
+			{
+				lock_.lock(node_);
+			}
+
+			~ScopedLock()
+			{
+				lock_.unlock(node_);
+			}
+
+			ScopedLock(const ScopedLock&) = delete;
+			ScopedLock& operator=(const ScopedLock&) = delete;
+
+		private:
+			McsLock& lock_;
+			McsLock::Node node_;
+		};
+
+	}
+
+}
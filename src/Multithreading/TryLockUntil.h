@@ -0,0 +1,58 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
+
+/*
+Helpers for the try and deadline based acquisition of the read-write locks:
+	tryAcquireReadLock() / tryAcquireWriteLock():                     one non-blocking attempt, returns false if the lock is busy.
+	tryAcquireReadLockUntil(deadline) / tryAcquireWriteLockUntil(deadline): waits at most until deadline, returns false if the lock is still busy.
+A caller which gets false does not hold the lock, and can skip the work or fall back (e.g. serve stale data instead of queueing behind a writer).
+
+The deadlines are steady_clock time points (LockDeadline), so that a change of the wall clock does not shorten or extend a wait.
+A deadline which has already passed (e.g. LockDeadline{}) makes every helper below a single non-blocking attempt.
+
+retryUntil(deadline, tryAcquire): calls tryAcquire() until it succeeds or the deadline passes, yielding in between.
+                                  For the spinning locks, which have nothing to block on.
+lockUntil(lock, deadline):        locks a std::mutex (it has no try_lock_until()) by retryUntil(). Used for the internal mutexes of the
+                                  blocking locks.
+lockIfUntil(lock, cv, deadline, condition): the timed counterpart of tryLockIf() (see SpinPolicy.h) for the condition variable locks: locks the mutex
+                                  and waits on cv (wait_until) until condition() is true. Returns true with the mutex locked, else false with it unlocked.
+*/
+
+namespace mm {
+
+	using LockDeadline = std::chrono::steady_clock::time_point;
+
+	template<typename TryAcquire>
+	bool retryUntil(LockDeadline deadline, TryAcquire tryAcquire)
+	{
+		while (!tryAcquire())
+		{
+			if (std::chrono::steady_clock::now() >= deadline)
+				return false;
+			std::this_thread::yield();
+		}
+		return true;
+	}
+
+	template<typename Mutex>
+	bool lockUntil(std::unique_lock<Mutex>& lock, LockDeadline deadline)
+	{
+		return retryUntil(deadline, [&lock]() { return lock.try_lock(); });
+	}
+
+	template<typename Condition>
+	bool lockIfUntil(std::unique_lock<std::mutex>& lock, std::condition_variable& cv, LockDeadline deadline, Condition condition)
+	{
+		if (!lockUntil(lock, deadline))
+			return false;
+		if (cv.wait_until(lock, deadline, condition))
+			return true;
+		lock.unlock();
+		return false;
+	}
+
+}
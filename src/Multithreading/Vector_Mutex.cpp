@@ -3,5 +3,7 @@ Reference:
 CppCon 2017: Fedor Pikus Read, Copy, Update, then what? RCU for non-kernel programmers
 https://www.youtube.com/watch?v=rxQ5K9lo034
 
+See Rcu_QSBR_v1.h for the user space RCU (QSBR) and RcuThreadsafeHashMap in ReadWriteLockTesting.cpp for its usage.
+
 
 */
\ No newline at end of file
@@ -13,11 +13,22 @@ namespace mm {
 	MM_DEFINE_FLAG(false, Multithreading_ReentrantLock_1);
 	MM_DEFINE_FLAG(false, Multithreading_spmc_fifo_queue);
 	MM_DEFINE_FLAG(false, Multithreading_mpmcu_queue); //TODO: test new algo
+	MM_DEFINE_FLAG(false, Multithreading_mpmcu_queue_consume_all);
+	MM_DEFINE_FLAG(false, Multithreading_mpmcu_queue_watermark);
 	MM_DEFINE_FLAG(false, CacheStatusManager_v1);
+	MM_DEFINE_FLAG(false, CacheStatusManager_v1_StripedCache);
+	MM_DEFINE_FLAG(false, CacheStatusManager_v1_Wakeups);
+	MM_DEFINE_FLAG(false, CacheStatusManager_v1_Eviction);
+	MM_DEFINE_FLAG(false, CacheStatusManager_v1_Ttl);
 	MM_DEFINE_FLAG(false, SemaphoreUsingConditionVariable);
 	MM_DEFINE_FLAG(false, ConditionVariableUsingSemaphore);
 	//MM_DEFINE_FLAG(true, ConditionVariableUsingMutex);
 	MM_DEFINE_FLAG(true, ReadWriteLock);
+	MM_DEFINE_FLAG(false, ReadWriteLock_RcuHashMap);
+	MM_DEFINE_FLAG(false, ReadWriteLock_Upgradeable);
+	MM_DEFINE_FLAG(false, ReadWriteLock_TryAcquire);
+	MM_DEFINE_FLAG(false, ReadWriteLock_FlatCombining);
+	MM_DEFINE_FLAG(false, ReadWriteLock_Bravo);
 }
 
 int main(int argc, char* argv[])